@@ -31,7 +31,9 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <errno.h>
 
 #include "log.h"
+#include "kconfig.h"
 #include "dmcli.h"
+#include "dmcli_bus.h"
 
 /*****************************************************************************/
 
@@ -42,8 +44,11 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 /*****************************************************************************/
 
-bool
-dmcli_eRT_getv(const char *path, char *dest, size_t destsz, bool empty_ok)
+/*
+ * Fallback path, spawns the dmcli tool for a single parameter
+ */
+static bool
+dmcli_eRT_getv_popen(const char *path, char *dest, size_t destsz, bool empty_ok)
 {
     char        cmd[DMCLI_ERT_MAX_CMD];
     FILE        *f1;
@@ -83,3 +88,54 @@ dmcli_eRT_getv(const char *path, char *dest, size_t destsz, bool empty_ok)
 
     return true;
 }
+
+bool
+dmcli_eRT_getv(const char *path, char *dest, size_t destsz, bool empty_ok)
+{
+    dmcli_param_t   param = {
+        .path       = path,
+        .dest       = dest,
+        .destsz     = destsz,
+        .empty_ok   = empty_ok,
+    };
+
+    return dmcli_eRT_getv_multi(&param, 1) == 1;
+}
+
+/*
+ * Fetch several parameters at once. The CCSP bus is used when available,
+ * parameters it can't provide are read via the dmcli tool unless they are
+ * marked bus_only. Returns the number of parameters that were fetched, each
+ * one is marked with its valid flag.
+ */
+int
+dmcli_eRT_getv_multi(dmcli_param_t *params, int num)
+{
+    int     valid = 0;
+    int     i;
+
+    for (i = 0; i < num; i++)
+    {
+        if (strlen(params[i].path) > DMCLI_MAX_PATH) {
+            LOGE("dmcli_eRT_getv(%s) - Path too long, %d bytes max", params[i].path, DMCLI_MAX_PATH);
+            return 0;
+        }
+        params[i].valid = false;
+    }
+
+#ifdef CONFIG_RDK_DMCLI_CCSP_BUS
+    valid = dmcli_bus_getv_multi(params, num);
+    if (valid == num) return valid;
+#endif
+
+    for (i = 0; i < num; i++)
+    {
+        if (params[i].valid || params[i].bus_only) continue;
+
+        params[i].valid = dmcli_eRT_getv_popen(params[i].path, params[i].dest,
+                                               params[i].destsz, params[i].empty_ok);
+        if (params[i].valid) valid++;
+    }
+
+    return valid;
+}
@@ -0,0 +1,309 @@
+/*
+Copyright (c) 2017, Plume Design Inc. All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+   1. Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+   2. Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+   3. Neither the name of the Plume Design Inc. nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL Plume Design Inc. BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+/*
+ * dmcli_bus.c
+ *
+ * Read TR-181 parameters over a persistent CCSP message bus connection
+ * instead of spawning the dmcli tool for each lookup.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <stdbool.h>
+#include <unistd.h>
+#include <time.h>
+
+#include <ccsp/ansc_platform.h>
+#include <ccsp/ccsp_message_bus.h>
+#include <ccsp/ccsp_base_api.h>
+
+#include "log.h"
+#include "util.h"
+#include "memutil.h"
+#include "ds_tree.h"
+#include "dmcli_bus.h"
+
+/*****************************************************************************/
+
+#define MODULE_ID LOG_MODULE_ID_OSA
+
+#define DMCLI_BUS_COMPONENT_FMT     "ccsp.opensync.dmcli.%d"
+#define DMCLI_BUS_CR_NAME           "eRT.com.cisco.spvtg.ccsp.CR"
+#define DMCLI_BUS_SUBSYSTEM         "eRT."
+#define DMCLI_BUS_RETRY_INTERVAL    10      // Seconds between bus connect attempts
+
+/*****************************************************************************/
+
+// Component owning an object namespace, as resolved by the registrar
+typedef struct
+{
+    char            ns[DMCLI_MAX_PATH];
+    char            comp[DMCLI_MAX_PATH];
+    char            dbus_path[DMCLI_MAX_PATH];
+    ds_tree_node_t  node;
+} dmcli_bus_owner_t;
+
+static void        *dmcli_bus_handle = NULL;
+static time_t       dmcli_bus_last_attempt = 0;
+static ds_tree_t    dmcli_bus_owners = DS_TREE_INIT((ds_key_cmp_t *)strcmp, dmcli_bus_owner_t, node);
+
+/*
+ * The connector keeps its own bus connection in processes it is linked
+ * into. Reuse it there rather than registering a second component.
+ */
+extern ANSC_HANDLE  ccsp_bus_handle __attribute__((weak));
+
+static bool dmcli_bus_connect(void)
+{
+    char    component[64];
+    time_t  now;
+    int     ret;
+
+    if (dmcli_bus_handle != NULL) return true;
+
+    if (&ccsp_bus_handle != NULL && ccsp_bus_handle != NULL)
+    {
+        LOGI("dmcli_bus_connect() - using the connector bus handle");
+        dmcli_bus_handle = ccsp_bus_handle;
+        return true;
+    }
+
+    // Don't hammer the bus if it isn't up yet, callers fall back to dmcli
+    now = time(NULL);
+    if (dmcli_bus_last_attempt != 0 &&
+        now - dmcli_bus_last_attempt < DMCLI_BUS_RETRY_INTERVAL)
+    {
+        return false;
+    }
+    dmcli_bus_last_attempt = now;
+
+    snprintf(component, sizeof(component), DMCLI_BUS_COMPONENT_FMT, (int)getpid());
+    ret = CCSP_Message_Bus_Init(
+            component,
+            CCSP_MSG_BUS_CFG,
+            &dmcli_bus_handle,
+            (CCSP_MESSAGE_BUS_MALLOC)Ansc_AllocateMemory_Callback,
+            Ansc_FreeMemory_Callback);
+    if (ret != 0)
+    {
+        LOGW("dmcli_bus_connect() - bus initialization failed, error %d", ret);
+        dmcli_bus_handle = NULL;
+        return false;
+    }
+
+    LOGI("dmcli_bus_connect() - connected as %s", component);
+    return true;
+}
+
+/*
+ * All parameters of an object are served by the same component, so the
+ * owner is looked up once per object path ("Device.DeviceInfo.").
+ */
+static void dmcli_bus_namespace(const char *path, char *ns, size_t nssz)
+{
+    const char *dot = strrchr(path, '.');
+    size_t len = dot != NULL ? (size_t)(dot - path) + 1 : strlen(path);
+
+    if (len >= nssz) len = nssz - 1;
+    memcpy(ns, path, len);
+    ns[len] = '\0';
+}
+
+static bool dmcli_bus_discover(
+        const char *path,
+        char *comp, size_t compsz,
+        char *dbus_path, size_t dbus_pathsz)
+{
+    componentStruct_t   **components = NULL;
+    dmcli_bus_owner_t   *owner;
+    char                ns[DMCLI_MAX_PATH];
+    int                 size = 0;
+    int                 ret;
+
+    dmcli_bus_namespace(path, ns, sizeof(ns));
+    owner = ds_tree_find(&dmcli_bus_owners, ns);
+    if (owner != NULL)
+    {
+        strscpy(comp, owner->comp, compsz);
+        strscpy(dbus_path, owner->dbus_path, dbus_pathsz);
+        return true;
+    }
+
+    ret = CcspBaseIf_discComponentSupportingNamespace(
+            dmcli_bus_handle,
+            DMCLI_BUS_CR_NAME,
+            path,
+            DMCLI_BUS_SUBSYSTEM,
+            &components,
+            &size);
+    if (ret != CCSP_SUCCESS || size < 1)
+    {
+        LOGD("dmcli_bus_discover(%s) - no component found, error %d", path, ret);
+        if (components != NULL) free_componentStruct_t(dmcli_bus_handle, size, components);
+        return false;
+    }
+
+    owner = CALLOC(1, sizeof(*owner));
+    STRSCPY(owner->ns, ns);
+    STRSCPY(owner->comp, components[0]->componentName);
+    STRSCPY(owner->dbus_path, components[0]->dbusPath);
+    ds_tree_insert(&dmcli_bus_owners, owner, owner->ns);
+    free_componentStruct_t(dmcli_bus_handle, size, components);
+
+    strscpy(comp, owner->comp, compsz);
+    strscpy(dbus_path, owner->dbus_path, dbus_pathsz);
+
+    return true;
+}
+
+// Forget the owners cached for a component, e.g. after it restarted
+static void dmcli_bus_forget(const char *comp)
+{
+    dmcli_bus_owner_t   *owner;
+    ds_tree_iter_t      iter;
+
+    ds_tree_foreach_iter(&dmcli_bus_owners, owner, &iter)
+    {
+        if (strcmp(owner->comp, comp) != 0) continue;
+        ds_tree_iremove(&iter);
+        FREE(owner);
+    }
+}
+
+/*
+ * Fetch all parameters served by component params[first].comp in a single
+ * bus call and mark the ones that were returned as valid.
+ */
+static void dmcli_bus_getv_component(
+        dmcli_param_t *params,
+        int num,
+        char (*comps)[DMCLI_MAX_PATH],
+        char (*dbus_paths)[DMCLI_MAX_PATH],
+        bool *done,
+        int first)
+{
+    parameterValStruct_t    **vals = NULL;
+    char                    **names;
+    int                     *idx;
+    int                     cnt = 0;
+    int                     nvals = 0;
+    int                     ret;
+    int                     i;
+    int                     j;
+
+    names = CALLOC(num, sizeof(*names));
+    idx = CALLOC(num, sizeof(*idx));
+
+    for (i = first; i < num; i++)
+    {
+        if (done[i] || strcmp(comps[i], comps[first]) != 0) continue;
+        names[cnt] = (char *)params[i].path;
+        idx[cnt] = i;
+        done[i] = true;
+        cnt++;
+    }
+
+    ret = CcspBaseIf_getParameterValues(
+            dmcli_bus_handle,
+            comps[first],
+            dbus_paths[first],
+            names,
+            cnt,
+            &nvals,
+            &vals);
+    if (ret != CCSP_Message_Bus_OK)
+    {
+        LOGW("dmcli_bus_getv() - %s: get of %d parameter(s) failed, error %d",
+             comps[first], cnt, ret);
+        dmcli_bus_forget(comps[first]);
+        goto exit;
+    }
+
+    for (j = 0; j < nvals; j++)
+    {
+        for (i = 0; i < cnt; i++)
+        {
+            dmcli_param_t *p = &params[idx[i]];
+
+            if (p->valid || strcmp(vals[j]->parameterName, p->path) != 0) continue;
+
+            strscpy(p->dest, vals[j]->parameterValue ? vals[j]->parameterValue : "", p->destsz);
+            p->valid = p->empty_ok || strlen(p->dest) > 0;
+            break;
+        }
+    }
+
+exit:
+    if (vals != NULL) free_parameterValStruct_t(dmcli_bus_handle, nvals, vals);
+    FREE(idx);
+    FREE(names);
+}
+
+int dmcli_bus_getv_multi(dmcli_param_t *params, int num)
+{
+    char    (*comps)[DMCLI_MAX_PATH];
+    char    (*dbus_paths)[DMCLI_MAX_PATH];
+    bool    *done;
+    int     valid = 0;
+    int     i;
+
+    if (num <= 0 || !dmcli_bus_connect()) return 0;
+
+    comps = CALLOC(num, sizeof(*comps));
+    dbus_paths = CALLOC(num, sizeof(*dbus_paths));
+    done = CALLOC(num, sizeof(*done));
+
+    // Resolve the component owning each parameter
+    for (i = 0; i < num; i++)
+    {
+        if (params[i].valid ||
+            !dmcli_bus_discover(params[i].path,
+                                comps[i], sizeof(comps[i]),
+                                dbus_paths[i], sizeof(dbus_paths[i])))
+        {
+            done[i] = true;
+        }
+    }
+
+    // Issue one get per component
+    for (i = 0; i < num; i++)
+    {
+        if (done[i]) continue;
+        dmcli_bus_getv_component(params, num, comps, dbus_paths, done, i);
+    }
+
+    for (i = 0; i < num; i++)
+    {
+        if (params[i].valid) valid++;
+    }
+
+    FREE(done);
+    FREE(dbus_paths);
+    FREE(comps);
+
+    return valid;
+}
@@ -36,6 +36,17 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #define DMCLI_ERT_MESH_STATE        CONFIG_RDK_DM_MESH_STATE
 #define DMCLI_ERT_MESH_URL          CONFIG_RDK_DM_MESH_URL
 
+typedef struct
+{
+    const char     *path;           // TR-181 parameter name
+    char           *dest;           // Value destination buffer
+    size_t          destsz;
+    bool            empty_ok;       // Accept empty value
+    bool            bus_only;       // Prefetch, don't fall back to the dmcli tool
+    bool            valid;          // Set when the value was fetched
+} dmcli_param_t;
+
 extern bool     dmcli_eRT_getv(const char *path, char *dest, size_t destsz, bool empty_ok);
+extern int      dmcli_eRT_getv_multi(dmcli_param_t *params, int num);
 
 #endif /* DMCLI_H_INCLUDED */
@@ -34,6 +34,17 @@ UNIT_CFLAGS := -I$(UNIT_PATH)/inc
 UNIT_LDFLAGS := $(SDK_LIB_DIR)
 
 UNIT_EXPORT_CFLAGS := $(UNIT_CFLAGS)
+
+ifeq ($(CONFIG_RDK_DMCLI_CCSP_BUS),y)
+UNIT_SRC    += dmcli_bus.c
+# CCSP flags are needed only by the bus backend, don't export them
+UNIT_CFLAGS += -I${STAGING_INCDIR}/dbus-1.0
+UNIT_CFLAGS += -I${STAGING_LIBDIR}/dbus-1.0/include
+UNIT_CFLAGS += -I${STAGING_INCDIR}/ccsp
+UNIT_CFLAGS += -D_ANSC_LINUX -D_ANSC_USER -D_ANSC_LITTLE_ENDIAN_
+UNIT_LDFLAGS += -lccsp_common
+endif
+
 UNIT_EXPORT_LDFLAGS := $(UNIT_LDFLAGS)
 
 UNIT_DEPS := src/lib/common
@@ -35,7 +35,7 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <sys/types.h>
 #include <errno.h>
 #include <fcntl.h>
-#include <regex.h>
+#include <ctype.h>
 
 #include "ds_dlist.h"
 #include "ds_tree.h"
@@ -44,7 +44,6 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "util.h"
 #include "daemon.h"
 #include "os_file.h"
-#include "os_regex.h"
 
 #include "osn_dhcp.h"
 #include "kconfig.h"
@@ -74,8 +73,48 @@ struct osn_dhcp_server
 
     /* IP pool range list */
     ds_tree_t                       ds_range_list;
+
+    /* Current leases, indexed by MAC and IP address */
+    ds_tree_t                       ds_lease_index;
+    /* Number of added, changed or removed leases since the last dispatch */
+    int                             ds_lease_changes;
+};
+
+/*
+ * Lease index key -- same identity as used by dnsmasq, a client may hold
+ * more than one lease if it presents different client IDs
+ */
+struct dhcp_lease_key
+{
+    osn_mac_addr_t                  lk_hwaddr;
+    osn_ip_addr_t                   lk_ipaddr;
 };
 
+/*
+ * Cached lease entry
+ */
+struct dhcp_lease_node
+{
+    struct dhcp_lease_key           ln_key;
+    struct osn_dhcp_server_lease    ln_lease;
+    unsigned int                    ln_gen;         /* Parse generation last seen in */
+    ds_tree_node_t                  ln_tnode;
+};
+
+/* Lease key comparison function */
+static int dhcp_lease_key_cmp(const void *_a, const void *_b)
+{
+    int rc;
+
+    const struct dhcp_lease_key *a = _a;
+    const struct dhcp_lease_key *b = _b;
+
+    rc = osn_mac_addr_cmp(&a->lk_hwaddr, &b->lk_hwaddr);
+    if (rc != 0) return rc;
+
+    return osn_ip_addr_cmp(&a->lk_ipaddr, &b->lk_ipaddr);
+}
+
 /*
  * IP range structure
  */
@@ -104,10 +143,11 @@ int dhcp_range_cmp(const void *_a, const void *_b)
  * Static functions
  */
 static bool               dhcp_server_init(osn_dhcp_server_t *self, const char *ifname);
-static bool               lease_exists(struct osn_dhcp_server_status *st, struct osn_dhcp_server_lease *dl);
 static bool               dhcp_server_lease_parse_line(struct osn_dhcp_server_lease *dl, const char *line);
 static osn_dhcp_server_t* dhcp_server_find_by_lease(struct osn_dhcp_server_lease *dl);
-static void               dhcp_server_lease_add(osn_dhcp_server_t *self, struct osn_dhcp_server_lease *dl);
+static void               dhcp_server_lease_update(osn_dhcp_server_t *self, struct osn_dhcp_server_lease *dl);
+static void               dhcp_server_lease_flush(osn_dhcp_server_t *self, bool all);
+static void               dhcp_server_status_dispatch_changed(void);
 static void               dhcp_lease_onchange(struct ev_loop *loop, ev_stat *w, int revent);
 static void               dhcp_lease_init(struct ev_loop *loop, struct ev_debounce *ev, int revent);
 
@@ -117,6 +157,7 @@ static void               dhcp_lease_init(struct ev_loop *loop, struct ev_deboun
 static ds_dlist_t   dhcp_server_list = DS_DLIST_INIT(osn_dhcp_server_t, ds_dnode);
 static ev_debounce  dhcp_lease_init_debounce;
 static ev_stat      dhcp_lease_watcher;
+static unsigned int dhcp_lease_gen;
 
 /*
  * ===========================================================================
@@ -148,6 +189,10 @@ bool osn_dhcp_server_del(osn_dhcp_server_t *self)
         FREE(dr);
     }
 
+    /* Free lease cache */
+    dhcp_server_lease_flush(self, true);
+    FREE(self->ds_status.ds_leases);
+
     /* Remove the DHCP server object instance from the global list */
     ds_dlist_remove(&dhcp_server_list, self);
 
@@ -279,6 +324,9 @@ static bool dhcp_server_init(osn_dhcp_server_t *self, const char *ifname)
     /* Initialize IP range list */
     ds_tree_init(&self->ds_range_list, dhcp_range_cmp, struct dhcp_range, dr_tnode);
 
+    /* Initialize lease index */
+    ds_tree_init(&self->ds_lease_index, dhcp_lease_key_cmp, struct dhcp_lease_node, ln_tnode);
+
     if (ds_dlist_is_empty(&dhcp_server_list))
     {
         /* Initialize the DHCP leases file watcher */
@@ -302,18 +350,35 @@ static bool dhcp_server_init(osn_dhcp_server_t *self, const char *ifname)
 }
 
 /*
- * Clear leases associated with the server instance -- lease information
- * is cached using the osn_dhcp_server_status structure
+ * Rebuild the lease array reported through the status callback from the
+ * lease index -- lease information is cached using the
+ * osn_dhcp_server_status structure
  */
-static void dhcp_lease_clear(osn_dhcp_server_t *self)
+static void dhcp_server_status_rebuild(osn_dhcp_server_t *self)
 {
-    if (self->ds_status.ds_leases != NULL)
+    struct osn_dhcp_server_status *st = &self->ds_status;
+    struct dhcp_lease_node *ln;
+    int cnt = 0;
+
+    ds_tree_foreach(&self->ds_lease_index, ln)
     {
-        FREE(self->ds_status.ds_leases);
-        self->ds_status.ds_leases = NULL;
+        cnt++;
     }
 
-    self->ds_status.ds_leases_len = 0;
+    /* Grow in DHCP_LEASE_RESIZE_QUANTUM steps, never shrink */
+    if (cnt > 0 && (st->ds_leases == NULL || cnt > st->ds_leases_len))
+    {
+        st->ds_leases = REALLOC(
+                st->ds_leases,
+                ((cnt / DHCP_LEASE_RESIZE_QUANTUM) + 1) * DHCP_LEASE_RESIZE_QUANTUM *
+                sizeof(struct osn_dhcp_server_lease));
+    }
+
+    st->ds_leases_len = 0;
+    ds_tree_foreach(&self->ds_lease_index, ln)
+    {
+        st->ds_leases[st->ds_leases_len++] = ln->ln_lease;
+    }
 }
 
 /*
@@ -329,6 +394,7 @@ void dhcp_server_status_dispatch()
      */
     ds_dlist_foreach(&dhcp_server_list, ds)
     {
+        ds->ds_lease_changes = 0;
         if (ds->ds_status_fn != NULL)
         {
             ds->ds_status_fn(ds, &ds->ds_status);
@@ -336,151 +402,211 @@ void dhcp_server_status_dispatch()
     }
 }
 
-static bool dhcp_server_lease_parse_line(struct osn_dhcp_server_lease *dl, const char *line)
+/*
+ * Send a status update only to server instances whose lease set changed
+ * since the last dispatch
+ */
+static void dhcp_server_status_dispatch_changed(void)
 {
-    /*
-     * Regular expression to match a line in the "dhcp.lease" file of the
-     * following format:
-     *
-     * 1461412276 f4:09:d8:89:54:4f 192.168.0.181 android-c992b284e24fdd69 1,33,3,6,15,28,51,58,59 "*" 01:f4:09:d8:89:54:4f
-     */
-    static const char dnsmasq_lease_parse_re[] =
-        "(^[0-9]+) "                            /* 1: Match timestamp */
-        "(([a-fA-F0-9]{2}:?){6}) "              /* 2,3: Match MAC address */
-        "(([0-9]+\\.?){4}) "                    /* 4,5: Match IP address */
-        "(\\*|[a-zA-Z0-9_-]+) "                 /* 6: Match hostname, can be "*" */
-        "(\\*|([0-9]+,?)+) "                    /* 7,8: Match fingerprint, can be "*" */
-        "\"(\\*|[^\"]+)\" "                     /* 9: Match vendor-class, can be "*" */
-        "[^ ]+$";                               /* Match CID, can be "*" */
-
-    static bool parse_re_compiled = false;
-    static regex_t parse_re;
+    osn_dhcp_server_t *ds;
 
-    char sleasetime[C_INT32_LEN];
-    char shwaddr[C_MACADDR_LEN];
-    char sipaddr[C_IP4ADDR_LEN];
+    ds_dlist_foreach(&dhcp_server_list, ds)
+    {
+        if (ds->ds_lease_changes == 0)
+        {
+            LOGT("dhcpv4_server: %s: No lease changes, skipping status update.", ds->ds_ifname);
+            continue;
+        }
+
+        LOGD("dhcpv4_server: %s: %d lease(s) changed, %d active.",
+                ds->ds_ifname, ds->ds_lease_changes, ds->ds_status.ds_leases_len);
 
-    regmatch_t rm[10];
+        ds->ds_lease_changes = 0;
+        if (ds->ds_status_fn != NULL)
+        {
+            ds->ds_status_fn(ds, &ds->ds_status);
+        }
+    }
+}
 
-    if (!parse_re_compiled && regcomp(&parse_re, dnsmasq_lease_parse_re, REG_EXTENDED) != 0)
+/*
+ * Copy the next space delimited token from the lease line. If the token
+ * starts with a double quote, everything up to the closing quote is copied
+ * (without the quotes). A token that doesn't fit into the buffer is
+ * truncated if trunc is set. Returns a pointer past the token and its
+ * trailing delimiter or NULL if there is no token or it doesn't fit into
+ * the buffer.
+ */
+static const char *dhcp_lease_token(const char *p, char *buf, size_t bufsz, bool trunc)
+{
+    const char *start;
+    const char *end;
+    size_t len;
+
+    if (*p == '\0' || isspace((unsigned char)*p)) return NULL;
+
+    if (*p == '"')
     {
-        LOG(ERR, "dhcpv4_server: Error compiling DHCP lease parsing regular expression.");
-        return false;
+        start = ++p;
+        end = strchr(start, '"');
+        if (end == NULL) return NULL;
+        p = end + 1;
+    }
+    else
+    {
+        start = p;
+        while (*p != '\0' && !isspace((unsigned char)*p)) p++;
+        end = p;
     }
 
-    parse_re_compiled = true;
+    len = end - start;
+    if (len == 0) return NULL;
 
-    /* Parse the lease line using regular expressions */
-    if (regexec(&parse_re, line, ARRAY_LEN(rm), rm, 0) != 0)
+    if (len >= bufsz)
     {
-        LOG(ERR, "NM: Invalid DHCP lease line (ignoring): %s", line);
-        return false;
+        if (!trunc) return NULL;
+        len = bufsz - 1;
     }
 
-    memset(dl, 0, sizeof(*dl));
+    memcpy(buf, start, len);
+    buf[len] = '\0';
 
-    /* Extract the data */
-    os_reg_match_cpy(
-            sleasetime,
-            sizeof(sleasetime),
-            line,
-            rm[1]);
-
-    os_reg_match_cpy(
-            shwaddr,
-            sizeof(shwaddr),
-            line,
-            rm[2]);
-
-    os_reg_match_cpy(
-            sipaddr,
-            sizeof(sipaddr),
-            line, rm[4]);
-
-    os_reg_match_cpy(dl->dl_hostname,
-            sizeof(dl->dl_hostname),
-            line,
-            rm[6]);
-
-    /* Copy the fingerprint */
-    os_reg_match_cpy(dl->dl_fingerprint,
-            sizeof(dl->dl_fingerprint),
-            line,
-            rm[7]);
-
-    /* Copy the vendor-class */
-    os_reg_match_cpy(dl->dl_vendorclass,
-            sizeof(dl->dl_vendorclass),
-            line,
-            rm[9]);
+    /* Tokens are separated by exactly one space */
+    if (*p == ' ') p++;
 
-    dl->dl_leasetime = strtod(sleasetime, NULL);
+    return p;
+}
 
-    if (!osn_mac_addr_from_str(&dl->dl_hwaddr, shwaddr))
+static bool dhcp_lease_token_is_num(const char *s)
+{
+    for (; *s != '\0'; s++)
     {
-        LOG(ERR, "dhcpv4_server: Invalid DHCP MAC address obtained from lease file: %s", shwaddr);
-        return false;
+        if (!isdigit((unsigned char)*s)) return false;
     }
+    return true;
+}
 
-    if (!osn_ip_addr_from_str(&dl->dl_ipaddr, sipaddr))
+static bool dhcp_lease_token_is_fingerprint(const char *s)
+{
+    if (strcmp(s, "*") == 0) return true;
+
+    for (; *s != '\0'; s++)
     {
-        LOG(ERR, "dhcpv4_server: Invalid DHCP IPv4 address obtained from lease file: %s", sipaddr);
-        return false;
+        if (!isdigit((unsigned char)*s) && *s != ',') return false;
     }
-
     return true;
 }
 
-static bool lease_exists(struct osn_dhcp_server_status *st, struct osn_dhcp_server_lease *dl)
+/*
+ * Update a single lease entry in the cache, counts the lease as changed if
+ * it is new or any of its attributes differ from the cached copy
+ */
+static void dhcp_server_lease_update(osn_dhcp_server_t *self, struct osn_dhcp_server_lease *dl)
 {
-    int i;
+    struct dhcp_lease_node *ln;
+    struct dhcp_lease_key key;
 
-    for (i = 0; i < st->ds_leases_len; i++)
+    memset(&key, 0, sizeof(key));
+    key.lk_hwaddr = dl->dl_hwaddr;
+    key.lk_ipaddr = dl->dl_ipaddr;
+
+    ln = ds_tree_find(&self->ds_lease_index, &key);
+    if (ln == NULL)
     {
-        /* We don't really check for timestamp. We also don't assume the fingerprint
-         * or hostname will change.
-         */
-        if (memcmp(&dl->dl_ipaddr, &st->ds_leases[i].dl_ipaddr, sizeof(dl->dl_ipaddr)))
-        {
-            continue;
-        }
-        if (memcmp(&dl->dl_hwaddr, &st->ds_leases[i].dl_hwaddr, sizeof(dl->dl_hwaddr)))
-        {
-            continue;
-        }
+        ln = CALLOC(1, sizeof(*ln));
+        ln->ln_key = key;
+        ln->ln_lease = *dl;
+        ds_tree_insert(&self->ds_lease_index, ln, &ln->ln_key);
+        self->ds_lease_changes++;
 
-        return true;
+        LOG(DEBUG, "New lease added: "PRI_osn_ip_addr, FMT_osn_ip_addr(dl->dl_ipaddr));
+    }
+    else if (ln->ln_gen == dhcp_lease_gen)
+    {
+        LOGT("Lease is already added, skipping.");
+        return;
+    }
+    else if (memcmp(&ln->ln_lease, dl, sizeof(*dl)) != 0)
+    {
+        ln->ln_lease = *dl;
+        self->ds_lease_changes++;
+
+        LOG(DEBUG, "Lease updated: "PRI_osn_ip_addr, FMT_osn_ip_addr(dl->dl_ipaddr));
     }
 
-    return false;
+    ln->ln_gen = dhcp_lease_gen;
 }
 
 /*
- * Add a single lease entry to the cache
+ * Remove leases that were not seen in the last parse pass, or all leases
  */
-static void dhcp_server_lease_add(osn_dhcp_server_t *self, struct osn_dhcp_server_lease *dl)
+static void dhcp_server_lease_flush(osn_dhcp_server_t *self, bool all)
 {
-    struct osn_dhcp_server_status *st = &self->ds_status;
+    struct dhcp_lease_node *ln;
+    ds_tree_iter_t iter;
 
-    if (lease_exists(st, dl))
+    ds_tree_foreach_iter(&self->ds_lease_index, ln, &iter)
     {
-           LOGT("Lease is already added, skipping.");
-           return;
+        if (!all && ln->ln_gen == dhcp_lease_gen) continue;
+
+        LOG(DEBUG, "Lease removed: "PRI_osn_ip_addr, FMT_osn_ip_addr(ln->ln_lease.dl_ipaddr));
+
+        ds_tree_iremove(&iter);
+        FREE(ln);
+        self->ds_lease_changes++;
     }
+}
 
-    /* Resize the leases array */
-    if ((st->ds_leases_len % DHCP_LEASE_RESIZE_QUANTUM) == 0)
+static bool dhcp_server_lease_parse_line(struct osn_dhcp_server_lease *dl, const char *line)
+{
+    /*
+     * Parse a line in the "dhcp.lease" file of the following format:
+     *
+     * 1461412276 f4:09:d8:89:54:4f 192.168.0.181 android-c992b284e24fdd69 1,33,3,6,15,28,51,58,59 "*" 01:f4:09:d8:89:54:4f
+     *
+     * Fields are: timestamp, MAC address, IP address, hostname (can be "*"),
+     * fingerprint (can be "*"), quoted vendor-class (can be "*") and CID
+     * (can be "*").
+     */
+    char sleasetime[C_INT32_LEN];
+    char shwaddr[C_MACADDR_LEN];
+    char sipaddr[C_IP4ADDR_LEN];
+    const char *p = line;
+
+    memset(dl, 0, sizeof(*dl));
+
+    /*
+     * Hostname, fingerprint and vendor-class are truncated if too long. The
+     * CID is not used and not parsed, so a long one can't drop the lease.
+     */
+    if ((p = dhcp_lease_token(p, sleasetime, sizeof(sleasetime), false)) == NULL ||
+            !dhcp_lease_token_is_num(sleasetime) ||
+        (p = dhcp_lease_token(p, shwaddr, sizeof(shwaddr), false)) == NULL ||
+        (p = dhcp_lease_token(p, sipaddr, sizeof(sipaddr), false)) == NULL ||
+        (p = dhcp_lease_token(p, dl->dl_hostname, sizeof(dl->dl_hostname), true)) == NULL ||
+        (p = dhcp_lease_token(p, dl->dl_fingerprint, sizeof(dl->dl_fingerprint), true)) == NULL ||
+            !dhcp_lease_token_is_fingerprint(dl->dl_fingerprint) ||
+        (p = dhcp_lease_token(p, dl->dl_vendorclass, sizeof(dl->dl_vendorclass), true)) == NULL)
     {
-        /* Reallocate buffer */
-        st->ds_leases = REALLOC(
-                st->ds_leases,
-                (st->ds_leases_len + DHCP_LEASE_RESIZE_QUANTUM) * sizeof(struct osn_dhcp_server_lease));
+        LOG(ERR, "NM: Invalid DHCP lease line (ignoring): %s", line);
+        return false;
+    }
+
+    dl->dl_leasetime = strtod(sleasetime, NULL);
+
+    if (!osn_mac_addr_from_str(&dl->dl_hwaddr, shwaddr))
+    {
+        LOG(ERR, "dhcpv4_server: Invalid DHCP MAC address obtained from lease file: %s", shwaddr);
+        return false;
     }
 
-    LOG(DEBUG, "New lease added: "PRI_osn_ip_addr, FMT_osn_ip_addr(dl->dl_ipaddr));
+    if (!osn_ip_addr_from_str(&dl->dl_ipaddr, sipaddr))
+    {
+        LOG(ERR, "dhcpv4_server: Invalid DHCP IPv4 address obtained from lease file: %s", sipaddr);
+        return false;
+    }
 
-    /* Append to array */
-    st->ds_leases[st->ds_leases_len++] = *dl;
+    return true;
 }
 
 static osn_dhcp_server_t* dhcp_server_find_by_lease(struct osn_dhcp_server_lease *dl)
@@ -502,7 +628,8 @@ static osn_dhcp_server_t* dhcp_server_find_by_lease(struct osn_dhcp_server_lease
 }
 
 /*
- * Parse the dnsmasq lease file and update the lease cache
+ * Parse the dnsmasq lease file and update the lease cache. Leases that are
+ * no longer present in the file are removed from the cache.
  */
 bool dhcp_lease_parse(void)
 {
@@ -512,6 +639,9 @@ bool dhcp_lease_parse(void)
 
     bool retval = false;
 
+    /* Start a new parse pass, leases not seen during this pass are stale */
+    dhcp_lease_gen++;
+
     lf = fopen(CONFIG_RDK_DHCP_LEASES_PATH, "r");
     if (lf == NULL)
     {
@@ -535,6 +665,14 @@ bool dhcp_lease_parse(void)
     while (fgets(line, sizeof(line), lf) != NULL)
     {
         struct osn_dhcp_server_lease dl;
+        size_t len = strlen(line);
+        int c;
+
+        /* Drop the rest of an overlong line, it ends with the unused CID */
+        if (len > 0 && line[len - 1] != '\n')
+        {
+            while ((c = fgetc(lf)) != EOF && c != '\n');
+        }
 
         if (!dhcp_server_lease_parse_line(&dl, line))
         {
@@ -551,7 +689,13 @@ bool dhcp_lease_parse(void)
             continue;
         }
 
-        dhcp_server_lease_add(ds, &dl);
+        dhcp_server_lease_update(ds, &dl);
+    }
+
+    /* Drop leases that disappeared from the file */
+    ds_dlist_foreach(&dhcp_server_list, ds)
+    {
+        dhcp_server_lease_flush(ds, false);
     }
 
     retval = true;
@@ -561,6 +705,22 @@ exit:
     return retval;
 }
 
+/*
+ * Refresh the reported lease arrays of server instances with changed leases
+ */
+static void dhcp_lease_status_update(void)
+{
+    osn_dhcp_server_t *ds;
+
+    ds_dlist_foreach(&dhcp_server_list, ds)
+    {
+        if (ds->ds_lease_changes > 0)
+        {
+            dhcp_server_status_rebuild(ds);
+        }
+    }
+}
+
 /*
  * Callback function triggered by file status change on the lease file
  */
@@ -571,24 +731,23 @@ void dhcp_lease_onchange(struct ev_loop *loop, ev_stat *w, int revent)
 
     osn_dhcp_server_t *ds;
 
-    /* Clear all leases */
-    ds_dlist_foreach(&dhcp_server_list, ds)
-    {
-        dhcp_lease_clear(ds);
-    }
-
     if (w->attr.st_nlink)
     {
         LOGI("dhcpv4_server: Lease file changed.");
-        dhcp_lease_parse();
+        if (!dhcp_lease_parse()) return;
     }
     else
     {
         LOGI("dhcpv4_server: Lease file removed, flushing all entries.");
+        ds_dlist_foreach(&dhcp_server_list, ds)
+        {
+            dhcp_server_lease_flush(ds, true);
+        }
     }
 
-    /* Send out status change notifications */
-    dhcp_server_status_dispatch();
+    /* Send out status change notifications for changed leases only */
+    dhcp_lease_status_update();
+    dhcp_server_status_dispatch_changed();
 }
 
 
@@ -601,15 +760,13 @@ void dhcp_lease_init(struct ev_loop *loop, struct ev_debounce *ev, int revent)
 
     LOG(INFO, "DHCP leases initialization");
 
-    /* Clear all leases */
+    dhcp_lease_parse();
+
+    /* Send out the full status to all instances */
     ds_dlist_foreach(&dhcp_server_list, ds)
     {
-        dhcp_lease_clear(ds);
+        dhcp_server_status_rebuild(ds);
     }
-
-    dhcp_lease_parse();
-
-    /* Send out status change notifications */
     dhcp_server_status_dispatch();
 
 }
@@ -61,16 +61,65 @@ static struct
     char        pver[MAX_CACHE_LEN];
 } osp_unit_cache;
 
-bool osp_unit_serial_get(char *buff, size_t buffsz)
+/*
+ * Fetch the wanted unit parameter. The CCSP bus backend fetches all the not
+ * yet cached ones with the same single request. Through the dmcli tool each
+ * parameter costs a process spawn, so the others are bus only and when the
+ * bus is not up only the wanted one falls back to the dmcli tool.
+ */
+static void osp_unit_cache_fill(bool *want)
 {
-    if (!osp_unit_cache.serial_cached)
+    dmcli_param_t   params[4];
+    bool           *cached[4];
+    int             n = 0;
+    int             i;
+
+#define OSP_UNIT_CACHE_PARAM(_path, _field)                                 \
+    if (!osp_unit_cache._field ## _cached &&                                \
+        (kconfig_enabled(CONFIG_RDK_DMCLI_CCSP_BUS) ||                      \
+         want == &osp_unit_cache._field ## _cached))                        \
+    {                                                                       \
+        params[n] = (dmcli_param_t) {                                       \
+            .path = (_path),                                                \
+            .dest = osp_unit_cache._field,                                  \
+            .destsz = sizeof(osp_unit_cache._field),                        \
+            .empty_ok = false,                                              \
+            .bus_only = (want != &osp_unit_cache._field ## _cached),        \
+        };                                                                  \
+        cached[n++] = &osp_unit_cache._field ## _cached;                    \
+    }
+
+    OSP_UNIT_CACHE_PARAM(DMCLI_ERT_SERIAL_NUM, serial);
+    OSP_UNIT_CACHE_PARAM(DMCLI_ERT_CM_MAC, id);
+    OSP_UNIT_CACHE_PARAM(DMCLI_ERT_MODEL_NUM, model);
+    OSP_UNIT_CACHE_PARAM(DMCLI_ERT_SOFTWARE_VER, pver);
+
+#undef OSP_UNIT_CACHE_PARAM
+
+    if (n == 0) return;
+
+    dmcli_eRT_getv_multi(params, n);
+
+    for (i = 0; i < n; i++)
     {
-        if (!dmcli_eRT_getv(DMCLI_ERT_SERIAL_NUM,
-                          ARRAY_AND_SIZE(osp_unit_cache.serial), false))
+        if (!params[i].valid) continue;
+
+        if (cached[i] == &osp_unit_cache.id_cached && strlen(osp_unit_cache.id) != 17)
         {
-            return false;
+            LOGE("osp_unit_id_get() bad CM_MAC format");
+            continue;
         }
-        osp_unit_cache.serial_cached = true;
+
+        *cached[i] = true;
+    }
+}
+
+bool osp_unit_serial_get(char *buff, size_t buffsz)
+{
+    if (!osp_unit_cache.serial_cached)
+    {
+        osp_unit_cache_fill(&osp_unit_cache.serial_cached);
+        if (!osp_unit_cache.serial_cached) return false;
     }
 
     snprintf(buff, buffsz, "%s", osp_unit_cache.serial);
@@ -81,19 +130,8 @@ bool osp_unit_id_get(char *buff, size_t buffsz)
 {
     if (!osp_unit_cache.id_cached)
     {
-        if (!dmcli_eRT_getv(DMCLI_ERT_CM_MAC,
-                          ARRAY_AND_SIZE(osp_unit_cache.id), false))
-        {
-            return false;
-        }
-
-        if (strlen(osp_unit_cache.id) != 17)
-        {
-            LOGE("osp_unit_id_get() bad CM_MAC format");
-            return false;
-        }
-
-        osp_unit_cache.id_cached = true;
+        osp_unit_cache_fill(&osp_unit_cache.id_cached);
+        if (!osp_unit_cache.id_cached) return false;
     }
 
     snprintf(buff,
@@ -130,12 +168,8 @@ bool osp_unit_model_get(char *buff, size_t buffsz)
 {
     if (!osp_unit_cache.model_cached)
     {
-        if (!dmcli_eRT_getv(DMCLI_ERT_MODEL_NUM,
-                          ARRAY_AND_SIZE(osp_unit_cache.model), false))
-        {
-            return false;
-        }
-        osp_unit_cache.model_cached = true;
+        osp_unit_cache_fill(&osp_unit_cache.model_cached);
+        if (!osp_unit_cache.model_cached) return false;
     }
 
     snprintf(buff, buffsz, "%s", osp_unit_cache.model);
@@ -158,12 +192,8 @@ bool osp_unit_platform_version_get(char *buff, size_t buffsz)
 {
     if (!osp_unit_cache.pver_cached)
     {
-        if (!dmcli_eRT_getv(DMCLI_ERT_SOFTWARE_VER,
-                          ARRAY_AND_SIZE(osp_unit_cache.pver), false))
-        {
-            return false;
-        }
-        osp_unit_cache.pver_cached = true;
+        osp_unit_cache_fill(&osp_unit_cache.pver_cached);
+        if (!osp_unit_cache.pver_cached) return false;
     }
 
     snprintf(buff, buffsz, "%s", osp_unit_cache.pver);
@@ -33,6 +33,7 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #define _GNU_SOURCE
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <stdint.h>
 #include <stdbool.h>
 #include <unistd.h>
@@ -40,12 +41,15 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <ctype.h>
 #include <time.h>
 #include <errno.h>
+#include <poll.h>
+#include <pthread.h>
 #include <sys/types.h>
 #include <sys/socket.h>
 #include <sys/un.h>
 #include <linux/types.h>
 
 #include "log.h"
+#include "kconfig.h"
 #include "pl2rl.h"
 
 /*****************************************************************************/
@@ -54,11 +58,53 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #define PL2RL_RETRIES               3       // EAGAIN retries
 #define PL2RL_BUF                   4096    // Max buffer size
 
+#define PL2RL_ASYNC_TEXT_MAX        1024    // Longer messages are truncated
+#define PL2RL_ASYNC_RING_MIN        16
+#define PL2RL_ASYNC_IDLE_MS         100     // Flusher wakeup period when idle
+#define PL2RL_ASYNC_SEND_TIMEOUT_MS 100     // Max wait for the socket to drain
+#define PL2RL_ASYNC_REPORT_SEC      60      // Min interval between stats reports
+#define PL2RL_ASYNC_LATENCY_WARN_MS 250     // Report if queueing took longer
+#define PL2RL_ASYNC_EXIT_TIMEOUT_MS 200     // Max wait for the flusher at exit
+
+/*****************************************************************************/
+
+// Queued log record
+typedef struct
+{
+    size_t          seq;
+    uint64_t        stamp;          // Enqueue time, monotonic ns
+    uint8_t         severity;
+    uint8_t         module;
+    uint16_t        text_len;
+    char            text[PL2RL_ASYNC_TEXT_MAX];
+} pl2rl_rec_t;
+
+// Bounded multi-producer, single-consumer ring of log records
+typedef struct
+{
+    pl2rl_rec_t    *slots;
+    size_t          mask;
+    size_t          head;           // Consumer position
+    size_t          tail;           // Producer reservation position
+} pl2rl_ring_t;
+
 /*****************************************************************************/
 
 static time_t   pl2rl_last_attempt  =  0;
 static int      pl2rl_fd            = -1;
 
+static bool             pl2rl_async         = false;
+static pl2rl_ring_t     pl2rl_ring;
+static pthread_t        pl2rl_thread;
+static pthread_mutex_t  pl2rl_lock          = PTHREAD_MUTEX_INITIALIZER;   // Flusher wakeup only
+static pthread_cond_t   pl2rl_cond          = PTHREAD_COND_INITIALIZER;
+static pthread_mutex_t  pl2rl_flush_lock    = PTHREAD_MUTEX_INITIALIZER;   // Ring consumer and socket
+static int              pl2rl_waiting       = 0;    // Flusher is idle
+static uint64_t         pl2rl_dropped       = 0;    // Total dropped messages
+static uint64_t         pl2rl_dropped_rep   = 0;    // Dropped at last report
+static uint64_t         pl2rl_max_latency   = 0;    // Since last report, ns
+static time_t           pl2rl_last_report   = 0;
+
 /*****************************************************************************/
 
 static void
@@ -208,11 +254,391 @@ pl2rl_connect(void)
     return true;
 }
 
+/*****************************************************************************
+ * Asynchronous mode
+ *
+ * pl2rl_log() only copies the message into a preallocated ring. A flusher
+ * thread batches queued records into as few send() calls as possible and
+ * is the only user of the socket. A stalled logger daemon therefore costs
+ * dropped messages instead of blocking the caller.
+ *****************************************************************************/
+
+static uint64_t
+pl2rl_now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static bool
+pl2rl_ring_init(pl2rl_ring_t *ring, size_t size)
+{
+    size_t  depth = PL2RL_ASYNC_RING_MIN;
+    size_t  i;
+
+    while (depth < size) depth <<= 1;
+
+    ring->slots = calloc(depth, sizeof(*ring->slots));
+    if (ring->slots == NULL) {
+        return false;
+    }
+    ring->mask = depth - 1;
+    ring->head = 0;
+    ring->tail = 0;
+
+    for (i = 0; i < depth; i++)
+    {
+        ring->slots[i].seq = i;
+    }
+
+    return true;
+}
+
+static pl2rl_rec_t *
+pl2rl_ring_reserve(pl2rl_ring_t *ring, size_t *out_pos)
+{
+    pl2rl_rec_t    *slot;
+    size_t          pos;
+    size_t          seq;
+    ssize_t         diff;
+
+    pos = __atomic_load_n(&ring->tail, __ATOMIC_RELAXED);
+    for (;;)
+    {
+        slot = &ring->slots[pos & ring->mask];
+        seq = __atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE);
+        diff = (ssize_t)seq - (ssize_t)pos;
+
+        if (diff == 0)
+        {
+            if (__atomic_compare_exchange_n(&ring->tail, &pos, pos + 1, true,
+                                            __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+            {
+                *out_pos = pos;
+                return slot;
+            }
+        }
+        else if (diff < 0)
+        {
+            // Flusher hasn't released this slot yet, the ring is full
+            return NULL;
+        }
+        else
+        {
+            pos = __atomic_load_n(&ring->tail, __ATOMIC_RELAXED);
+        }
+    }
+}
+
+static pl2rl_rec_t *
+pl2rl_ring_peek(pl2rl_ring_t *ring)
+{
+    pl2rl_rec_t    *slot = &ring->slots[ring->head & ring->mask];
+
+    if (__atomic_load_n(&slot->seq, __ATOMIC_SEQ_CST) != ring->head + 1) {
+        return NULL;
+    }
+
+    return slot;
+}
+
+static void
+pl2rl_ring_release(pl2rl_ring_t *ring, pl2rl_rec_t *slot)
+{
+    __atomic_store_n(&slot->seq, ring->head + ring->mask + 1, __ATOMIC_RELEASE);
+    ring->head++;
+}
+
+static bool
+pl2rl_async_send(void *data, int len)
+{
+    struct pollfd   pfd;
+    uint64_t        deadline;
+    int64_t         left;
+    int             ret;
+    int             w = 0;
+
+    if (pl2rl_fd < 0 && !pl2rl_connect()) {
+        return false;
+    }
+
+    deadline = pl2rl_now() + (uint64_t)PL2RL_ASYNC_SEND_TIMEOUT_MS * 1000000;
+
+    while (w < len)
+    {
+        ret = send(pl2rl_fd, (data+w), (len-w), MSG_NOSIGNAL);
+        if (ret >= 0)
+        {
+            w += ret;
+            continue;
+        }
+        if (errno != EAGAIN && errno != EINTR)
+        {
+            pl2rl_disconnect();
+            return false;
+        }
+
+        // Wait for the daemon to drain the socket instead of spinning
+        left = (int64_t)(deadline - pl2rl_now());
+        if (left <= 0) {
+            break;
+        }
+        pfd.fd = pl2rl_fd;
+        pfd.events = POLLOUT;
+        poll(&pfd, 1, (int)(left / 1000000) + 1);
+    }
+
+    if (w == len) {
+        return true;
+    }
+
+    if (w > 0)
+    {
+        // Partial message on the stream, reconnect to resynchronize
+        pl2rl_disconnect();
+    }
+
+    return false;
+}
+
+static int
+pl2rl_async_append(
+        char *buf,
+        int len,
+        uint8_t severity,
+        uint8_t module,
+        const char *text,
+        uint16_t text_len)
+{
+    pl2rl_msg_t    *msg = (pl2rl_msg_t *)(buf + len);
+    int             hdr_len = sizeof(pl2rl_msg_hdr_t) + sizeof(pl2rl_msg_log_data_t);
+
+    msg->hdr.msg_type      = PL2RL_MSG_TYPE_LOG;
+    msg->hdr.length        = hdr_len + text_len;
+    msg->data.log.severity = severity;
+    msg->data.log.module   = module;
+    msg->data.log.text_len = text_len;
+    memcpy(buf + len + hdr_len, text, text_len);
+
+    return len + hdr_len + text_len;
+}
+
+static int
+pl2rl_async_report(char *buf, int len)
+{
+    char        text[160];
+    uint64_t    dropped;
+    unsigned    latency_ms;
+    time_t      now = time(NULL);
+    int         text_len;
+
+    if (pl2rl_last_report && (now - pl2rl_last_report) < PL2RL_ASYNC_REPORT_SEC) {
+        return len;
+    }
+
+    dropped = __atomic_load_n(&pl2rl_dropped, __ATOMIC_RELAXED);
+    latency_ms = (unsigned)(pl2rl_max_latency / 1000000);
+
+    if (dropped == pl2rl_dropped_rep && latency_ms < PL2RL_ASYNC_LATENCY_WARN_MS) {
+        return len;
+    }
+
+    text_len = snprintf(text, sizeof(text),
+                        "pl2rl: %llu log messages dropped (%llu total), max queueing latency %u ms",
+                        (unsigned long long)(dropped - pl2rl_dropped_rep),
+                        (unsigned long long)dropped,
+                        latency_ms);
+    if (text_len >= (int)sizeof(text)) {
+        text_len = sizeof(text) - 1;
+    }
+
+    pl2rl_dropped_rep = dropped;
+    pl2rl_max_latency = 0;
+    pl2rl_last_report = now;
+
+    return pl2rl_async_append(buf, len, LOG_SEVERITY_WARNING, LOG_MODULE_ID_MAIN, text, text_len);
+}
+
+/*
+ * Drain the ring. Must be called with pl2rl_flush_lock held, pl2rl_lock
+ * must not be held so producers never wait for the socket.
+ */
+static void
+pl2rl_async_flush(void)
+{
+    pl2rl_rec_t    *rec;
+    char            buf[PL2RL_BUF];
+    int             hdr_len = sizeof(pl2rl_msg_hdr_t) + sizeof(pl2rl_msg_log_data_t);
+    int             batch = 0;
+    int             len = 0;
+    uint64_t        latency;
+
+    while ((rec = pl2rl_ring_peek(&pl2rl_ring)) != NULL)
+    {
+        if (len + hdr_len + rec->text_len > (int)sizeof(buf))
+        {
+            if (!pl2rl_async_send(buf, len)) {
+                __atomic_add_fetch(&pl2rl_dropped, batch, __ATOMIC_RELAXED);
+            }
+            len = 0;
+            batch = 0;
+        }
+
+        latency = pl2rl_now() - rec->stamp;
+        if (latency > pl2rl_max_latency) {
+            pl2rl_max_latency = latency;
+        }
+
+        len = pl2rl_async_append(buf, len, rec->severity, rec->module, rec->text, rec->text_len);
+        batch++;
+
+        pl2rl_ring_release(&pl2rl_ring, rec);
+    }
+
+    if (len + hdr_len + 160 > (int)sizeof(buf))
+    {
+        if (!pl2rl_async_send(buf, len)) {
+            __atomic_add_fetch(&pl2rl_dropped, batch, __ATOMIC_RELAXED);
+        }
+        len = 0;
+        batch = 0;
+    }
+    len = pl2rl_async_report(buf, len);
+
+    if (len > 0 && !pl2rl_async_send(buf, len)) {
+        __atomic_add_fetch(&pl2rl_dropped, batch, __ATOMIC_RELAXED);
+    }
+}
+
+static void *
+pl2rl_async_thread(void *arg)
+{
+    struct timespec ts;
+
+    (void)arg;
+
+    for (;;)
+    {
+        pthread_mutex_lock(&pl2rl_flush_lock);
+        pl2rl_async_flush();
+        pthread_mutex_unlock(&pl2rl_flush_lock);
+
+        // Producers only signal while pl2rl_waiting is set, so it has to be
+        // visible before the ring is checked for a last time under the lock
+        __atomic_store_n(&pl2rl_waiting, 1, __ATOMIC_SEQ_CST);
+        pthread_mutex_lock(&pl2rl_lock);
+        if (pl2rl_ring_peek(&pl2rl_ring) == NULL)
+        {
+            clock_gettime(CLOCK_REALTIME, &ts);
+            ts.tv_nsec += PL2RL_ASYNC_IDLE_MS * 1000000L;
+            if (ts.tv_nsec >= 1000000000L)
+            {
+                ts.tv_sec++;
+                ts.tv_nsec -= 1000000000L;
+            }
+            pthread_cond_timedwait(&pl2rl_cond, &pl2rl_lock, &ts);
+        }
+        pthread_mutex_unlock(&pl2rl_lock);
+        __atomic_store_n(&pl2rl_waiting, 0, __ATOMIC_SEQ_CST);
+    }
+
+    return NULL;
+}
+
+static void
+pl2rl_async_exit(void)
+{
+    struct timespec ts;
+
+    // Deliver what is still queued. If the flusher is stuck on a stalled
+    // daemon, give up after a bounded wait rather than hang the exit.
+    clock_gettime(CLOCK_REALTIME, &ts);
+    ts.tv_nsec += PL2RL_ASYNC_EXIT_TIMEOUT_MS * 1000000L;
+    while (ts.tv_nsec >= 1000000000L)
+    {
+        ts.tv_sec++;
+        ts.tv_nsec -= 1000000000L;
+    }
+    if (pthread_mutex_timedlock(&pl2rl_flush_lock, &ts) != 0) {
+        return;
+    }
+    pl2rl_async_flush();
+    pthread_mutex_unlock(&pl2rl_flush_lock);
+}
+
+static bool
+pl2rl_async_init(void)
+{
+    pthread_attr_t  attr;
+    int             ret;
+
+    if (!pl2rl_ring_init(&pl2rl_ring, CONFIG_RDK_LOGGER_ASYNC_RING_SIZE)) {
+        return false;
+    }
+
+    pthread_attr_init(&attr);
+    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+    ret = pthread_create(&pl2rl_thread, &attr, pl2rl_async_thread, NULL);
+    pthread_attr_destroy(&attr);
+
+    if (ret != 0)
+    {
+        free(pl2rl_ring.slots);
+        pl2rl_ring.slots = NULL;
+        return false;
+    }
+
+    atexit(pl2rl_async_exit);
+
+    return true;
+}
+
+static void
+pl2rl_async_log(logger_msg_t *lmsg)
+{
+    pl2rl_rec_t    *rec;
+    size_t          pos;
+
+    rec = pl2rl_ring_reserve(&pl2rl_ring, &pos);
+    if (rec == NULL)
+    {
+        // Ring full: Drop message
+        __atomic_add_fetch(&pl2rl_dropped, 1, __ATOMIC_RELAXED);
+        return;
+    }
+
+    rec->stamp    = pl2rl_now();
+    rec->severity = lmsg->lm_severity;
+    rec->module   = lmsg->lm_module;
+    rec->text_len = strnlen(lmsg->lm_text, sizeof(rec->text));
+    memcpy(rec->text, lmsg->lm_text, rec->text_len);
+
+    __atomic_store_n(&rec->seq, pos + 1, __ATOMIC_SEQ_CST);
+
+    if (__atomic_load_n(&pl2rl_waiting, __ATOMIC_SEQ_CST))
+    {
+        pthread_mutex_lock(&pl2rl_lock);
+        pthread_cond_signal(&pl2rl_cond);
+        pthread_mutex_unlock(&pl2rl_lock);
+    }
+}
+
 /*****************************************************************************/
 
 bool
 pl2rl_init(void)
 {
+    if (kconfig_enabled(CONFIG_RDK_LOGGER_ASYNC) && !pl2rl_async)
+    {
+        // The flusher thread connects on its own
+        pl2rl_async = pl2rl_async_init();
+        if (pl2rl_async) {
+            return true;
+        }
+    }
+
     // Attempt to connect now
     pl2rl_connect();
 
@@ -225,9 +651,17 @@ pl2rl_log(logger_msg_t *lmsg)
     pl2rl_msg_t    *msg;
     char            buf[PL2RL_BUF];
     char            *text;
-    int             text_len = strlen(lmsg->lm_text);
+    int             text_len;
     int             hdr_len = sizeof(pl2rl_msg_hdr_t) + sizeof(pl2rl_msg_log_data_t);
 
+    if (pl2rl_async)
+    {
+        pl2rl_async_log(lmsg);
+        return;
+    }
+
+    text_len = strlen(lmsg->lm_text);
+
     if (pl2rl_fd < 0)
     {
         if (!pl2rl_connect())
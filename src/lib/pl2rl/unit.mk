@@ -42,4 +42,7 @@ UNIT_EXPORT_CFLAGS := $(UNIT_CFLAGS)
 UNIT_DEPS := src/lib/log
 
 # Don't want this exported
-UNIT_CFLAGS += -Isrc/lib/log/inc -Isrc/lib/ds/inc
+UNIT_CFLAGS += -Isrc/lib/log/inc -Isrc/lib/ds/inc -Isrc/lib/common/inc
+
+UNIT_LDFLAGS := -lpthread
+UNIT_EXPORT_LDFLAGS := $(UNIT_LDFLAGS)
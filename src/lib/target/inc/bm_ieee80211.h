@@ -27,6 +27,7 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #ifndef BM_IEEE80211_H_INCLUDED
 #define BM_IEEE80211_H_INCLUDED
 
+#include <stddef.h>
 #include <linux/types.h>
 
 #define STRUCT_PACKED __attribute__ ((packed))
@@ -184,6 +185,71 @@ struct supp_chan {
 #define WLAN_EID_RRM_ENABLED_CAPABILITIES 70
 #define WLAN_EID_EXT_CAPAB 127
 #define WLAN_EID_VHT_CAP 191
+#define WLAN_EID_EXTENSION 255
+
+/* Element ID Extension values, IEEE Std 802.11ax-2021 / 802.11be */
+#define WLAN_EID_EXT_HE_CAPABILITIES 35
+#define WLAN_EID_EXT_EHT_CAPABILITIES 108
+
+/* HE PHY Capabilities Information, first octet */
+#define IEEE80211_HE_PHYCAP_CHWIDTH_40_2G    BIT(1)
+#define IEEE80211_HE_PHYCAP_CHWIDTH_40_80_5G BIT(2)
+#define IEEE80211_HE_PHYCAP_CHWIDTH_160_5G   BIT(3)
+
+/*
+ * Table driven element parsing. bm_ie_parse() walks the element list once
+ * and hands each element to the first matching handler. Extension elements
+ * (WLAN_EID_EXTENSION) are matched on ext_id and the handler gets the data
+ * after the Element ID Extension octet. Elements shorter than min_len are
+ * skipped, so handlers may read min_len octets without further checks.
+ */
+struct bm_ie_handler {
+        u8 id;
+        u8 ext_id;      /* Only if id == WLAN_EID_EXTENSION */
+        u8 min_len;
+        void (*parse)(void *ctx, const u8 *data, u8 len);
+};
+
+/* Returns the number of elements that were too short for their handler */
+static inline unsigned int bm_ie_parse(const u8 *ies, size_t ies_len,
+                                       const struct bm_ie_handler *handlers,
+                                       size_t num_handlers, void *ctx)
+{
+        const struct element *elem;
+        const u8 *data;
+        u8 len;
+        unsigned int malformed = 0;
+        size_t i;
+
+        for_each_element(elem, ies, ies_len) {
+                data = elem->data;
+                len = elem->datalen;
+
+                if (elem->id == WLAN_EID_EXTENSION) {
+                        if (len < 1) {
+                                malformed++;
+                                continue;
+                        }
+                        data++;
+                        len--;
+                }
+
+                for (i = 0; i < num_handlers; i++) {
+                        if (handlers[i].id != elem->id)
+                                continue;
+                        if (elem->id == WLAN_EID_EXTENSION &&
+                            handlers[i].ext_id != elem->data[0])
+                                continue;
+                        if (len < handlers[i].min_len)
+                                malformed++;
+                        else
+                                handlers[i].parse(ctx, data, len);
+                        break;
+                }
+        }
+
+        return malformed;
+}
 
 /* IEEE Std 802.11-2016, 9.4.2.22 - Measurement Report element */
 struct rrm_measurement_report_element {
@@ -98,17 +98,41 @@ typedef void radio_config_cb_t(
 
 typedef struct
 {
-    // Client general data
-    dpp_client_info_t               info;
-    // Target specific client data
+    // Target specific client data, kept first as it is what the delta
+    // calculation reads
     wifi_associated_dev_stats_t     stats;
-    wifi_associated_dev3_t          dev3;
     uint64_t                        stats_cookie;
+    INT                             snr;
+    bool                            rx_counters_na; // No rx retry/error counters
+    // Client general data
+    dpp_client_info_t               info;
     ds_dlist_node_t                 node;
 } stats_client_record_t;
 
 typedef stats_client_record_t target_client_record_t;
 
+typedef enum
+{
+    STATS_COUNTER_32 = 0,   // Counter wraps at 32 bits
+    STATS_COUNTER_64,       // Counter is 64 bits wide and does not wrap
+    STATS_COUNTER_AUTO,     // 64-bit field, driver counter width not known
+} stats_counter_width_t;
+
+typedef enum
+{
+    STATS_DELTA_OK = 0,     // Counter advanced
+    STATS_DELTA_WRAP,       // Counter wrapped its 32-bit range
+    STATS_DELTA_RESET,      // Counter went backwards and restarted from zero
+} stats_delta_type_t;
+
+typedef struct
+{
+    uint64_t            wraps;
+    uint64_t            resets;
+    uint64_t            reinits;    // New association, baseline discarded
+    uint64_t            learned_64; // Unknown width found to be 64 bits
+} stats_delta_stats_t;
+
 // on-channel survey
 typedef struct
 {
@@ -169,6 +193,23 @@ typedef enum
 
 typedef void (*sync_on_connect_cb_t)(void);
 
+typedef struct
+{
+    uint64_t            hits;
+    uint64_t            misses;
+    uint64_t            invalidations;
+} topology_stats_t;
+
+typedef struct
+{
+    uint64_t            scans;
+    uint64_t            raw;            // Results returned by the HAL
+    uint64_t            offchan;        // Dropped, not on a scanned channel
+    uint64_t            duplicates;     // Dropped, same BSSID on the same channel
+    uint64_t            neighbors;      // Reported
+    uint32_t            raw_max;        // Largest single scan
+} stats_scan_dedup_stats_t;
+
 /* Current design requires caching key_id to have matching Wifi_VIF_Config/State tables.
  * To be removed in the future. */
 typedef char psk_key_id_t[65];
@@ -182,7 +223,12 @@ bool                 radio_cloud_mode_set(radio_cloud_mode_t mode);
 radio_cloud_mode_t   radio_cloud_mode_get(void);
 bool                 radio_rops_vstate(struct schema_Wifi_VIF_State *vstate,
                                        const char *radio_ifname);
+bool                 radio_rops_vstate_force(struct schema_Wifi_VIF_State *vstate,
+                                             const char *radio_ifname);
+void                 radio_state_shadow_invalidate(const char *if_name);
 void                 radio_trigger_resync(void);
+void                 radio_trigger_resync_radio(INT radioIndex);
+void                 radio_trigger_resync_vif(INT ssidIndex, bool clients);
 INT                  get_radio_cap_index(const wifi_hal_capability_t *cap, INT radioIndex);
 bool                 radio_ifname_to_idx(const char *ifname, INT *outRadioIndex);
 bool                 radio_rops_vconfig(struct schema_Wifi_VIF_Config *vconf,
@@ -242,6 +288,31 @@ void                multi_ap_to_state(INT ssid_index,
 bool                vap_controlled(const char *ifname);
 bool                is_home_ap(const char *ifname);
 
+bool                acl_hal_get(INT vap_index, mac_address_t **acl_list, UINT *acl_num);
+bool                acl_hal_apply(INT vap_index, const char *vap_name, bool deny_list,
+                                        const struct schema_Wifi_VIF_Config *vconf);
+bool                acl_hal_apply_list(INT vap_index, const char *vap_name, bool deny_list,
+                                        const mac_address_t *target, UINT target_num);
+void                acl_mac_to_str(const mac_address_t mac, char *mac_str, size_t mac_str_len);
+
+void                bsal_parse_assoc_ies(bsal_client_info_t *info, const uint8_t *ies, size_t ies_len);
+
+stats_delta_type_t  stats_counter_delta(uint64_t old_value, uint64_t new_value,
+                                        stats_counter_width_t *width, uint64_t *delta);
+void                stats_counter_reinit(void);
+void                stats_delta_stats_get(stats_delta_stats_t *stats);
+
+void                stats_scan_dedup_stats_get(stats_scan_dedup_stats_t *stats);
+
+void                topology_invalidate(void);
+void                topology_stats_get(topology_stats_t *stats);
+bool                topology_radio_ifname_to_idx(const char *radio_ifname, INT *radio_index);
+bool                topology_radio_idx_to_ifname(INT radio_index, char *radio_ifname,
+                                        size_t radio_ifname_size);
+bool                topology_vif_ifname_to_idx(const char *ifname, INT *ssid_index);
+bool                topology_ssid_index_to_radio(INT ssid_index, INT *radio_index,
+                                        INT *vap_pos);
+
 bool                ssid_index_to_vap_info(UINT ssid_index, wifi_vap_info_map_t *map, wifi_vap_info_t **vap_info);
 
 extern struct ev_loop   *wifihal_evloop;
@@ -37,14 +37,18 @@ UNIT_SRC_TOP += $(UNIT_SRC_DIR)/target.c
 UNIT_SRC_TOP += $(UNIT_SRC_DIR)/clients.c
 UNIT_SRC_TOP += $(UNIT_SRC_DIR)/radio.c
 UNIT_SRC_TOP += $(UNIT_SRC_DIR)/vif.c
+UNIT_SRC_TOP += $(UNIT_SRC_DIR)/acl.c
 UNIT_SRC_TOP += $(UNIT_SRC_DIR)/stats.c
+UNIT_SRC_TOP += $(UNIT_SRC_DIR)/stats_delta.c
 UNIT_SRC_TOP += $(UNIT_SRC_DIR)/log.c
+UNIT_SRC_TOP += $(UNIT_SRC_DIR)/topology.c
 
 ifneq ($(CONFIG_RDK_DISABLE_SYNC),y)
 UNIT_SRC_TOP += $(UNIT_SRC_DIR)/sync.c
 endif
 
 UNIT_SRC_TOP += $(if $(CONFIG_RDK_WIFI_HAL_VERSION_3_PHASE2), $(UNIT_SRC_DIR)/bsal.c, $(UNIT_SRC_DIR)/bsal_legacy.c)
+UNIT_SRC_TOP += $(UNIT_SRC_DIR)/bsal_ies.c
 UNIT_SRC_TOP += $(UNIT_SRC_DIR)/cloud_config.c
 UNIT_SRC_TOP += $(if $(CONFIG_RDK_WPS_SUPPORT), $(UNIT_SRC_DIR)/wps.c)
 UNIT_SRC_TOP += $(if $(CONFIG_RDK_MULTI_AP_SUPPORT), $(UNIT_SRC_DIR)/multi_ap.c)
@@ -66,7 +70,12 @@ ifeq ($(RDK_LOGGER),1)
 UNIT_DEPS    += $(PLATFORM_DIR)/src/lib/pl2rl
 endif
 
+ifeq ($(CONFIG_RDK_WIFI_HAL_MOCK),y)
+UNIT_DEPS    += $(PLATFORM_DIR)/src/tools/wifi_hal_mock
+UNIT_LDFLAGS := $(SDK_LIB_DIR) -lrt
+else
 UNIT_LDFLAGS := $(SDK_LIB_DIR)  -lhal_wifi -lrt
+endif
 UNIT_CFLAGS += -DCONTROLLER_ADDR="\"$(shell echo -n $(CONTROLLER_ADDR))\""
 
 UNIT_EXPORT_CFLAGS  := $(UNIT_CFLAGS)
@@ -0,0 +1,393 @@
+/*
+Copyright (c) 2017, Plume Design Inc. All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+   1. Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+   2. Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+   3. Neither the name of the Plume Design Inc. nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL Plume Design Inc. BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+/*
+ * VAP access control lists
+ *
+ * ACLs are handled as sets of binary MAC addresses. Applying a new list
+ * reads the HAL's current list, computes the entries to add and remove
+ * through a hash set and only issues HAL calls for those, so unchanged
+ * entries stay in place and the list is never flushed and re-added. Lists
+ * are sized from wifi_getApAclDeviceNum() and are not limited to a fixed
+ * number of entries.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "log.h"
+#include "const.h"
+#include "util.h"
+#include "memutil.h"
+
+#include "target.h"
+#include "target_internal.h"
+
+#define MODULE_ID LOG_MODULE_ID_VIF
+
+#define ACL_KEY_USED        (1ULL << 63)
+// The list may grow between reading its size and reading the list
+#define ACL_LIST_SLACK      8
+
+typedef struct
+{
+    uint64_t           *slots;
+    uint32_t            size;       // Power of two
+} acl_set_t;
+
+static uint64_t acl_mac_to_key(const mac_address_t mac)
+{
+    uint64_t key = 0;
+    int i;
+
+    for (i = 0; i < 6; i++)
+    {
+        key = (key << 8) | mac[i];
+    }
+    return key | ACL_KEY_USED;
+}
+
+static void acl_set_init(acl_set_t *set, uint32_t num)
+{
+    // Keep the load factor at or below 1/2
+    set->size = 16;
+    while (set->size < num * 2) set->size <<= 1;
+    set->slots = CALLOC(set->size, sizeof(*set->slots));
+}
+
+static void acl_set_free(acl_set_t *set)
+{
+    FREE(set->slots);
+    set->size = 0;
+}
+
+static uint32_t acl_set_slot(const acl_set_t *set, uint64_t key)
+{
+    uint32_t mask = set->size - 1;
+    uint32_t i = (uint32_t)((key * 0x9E3779B97F4A7C15ULL) >> 32) & mask;
+
+    while (set->slots[i] != 0 && set->slots[i] != key)
+    {
+        i = (i + 1) & mask;
+    }
+    return i;
+}
+
+// Returns false if the MAC was already in the set
+static bool acl_set_add(acl_set_t *set, const mac_address_t mac)
+{
+    uint64_t key = acl_mac_to_key(mac);
+    uint32_t i = acl_set_slot(set, key);
+
+    if (set->slots[i] == key) return false;
+    set->slots[i] = key;
+    return true;
+}
+
+static bool acl_set_contains(const acl_set_t *set, const mac_address_t mac)
+{
+    uint64_t key = acl_mac_to_key(mac);
+
+    return set->slots[acl_set_slot(set, key)] == key;
+}
+
+void acl_mac_to_str(const mac_address_t mac, char *mac_str, size_t mac_str_len)
+{
+    snprintf(mac_str, mac_str_len, "%02x:%02x:%02x:%02x:%02x:%02x",
+             mac[0], mac[1], mac[2], mac[3], mac[4], mac[5]);
+}
+
+static bool acl_str_to_mac(const char *mac_str, mac_address_t mac)
+{
+    unsigned int b[6];
+    char tail;
+    int i;
+
+    if (sscanf(mac_str, "%2x:%2x:%2x:%2x:%2x:%2x%c",
+               &b[0], &b[1], &b[2], &b[3], &b[4], &b[5], &tail) != 6)
+    {
+        return false;
+    }
+
+    for (i = 0; i < 6; i++) mac[i] = (UCHAR)b[i];
+    return true;
+}
+
+bool acl_hal_get(INT vap_index, mac_address_t **acl_list, UINT *acl_num)
+{
+    UINT num = 0;
+    UINT max;
+    INT status;
+
+    *acl_list = NULL;
+    *acl_num = 0;
+
+    status = wifi_getApAclDeviceNum(vap_index, &num);
+    if (status != RETURN_OK)
+    {
+        LOGE("%s: Failed to obtain ACL list count for VAP index: %d (status %d)!",
+             __func__, vap_index, status);
+        return false;
+    }
+
+    max = num + ACL_LIST_SLACK;
+    *acl_list = CALLOC(max, sizeof(mac_address_t));
+
+#ifdef WIFI_HAL_VERSION_3_PHASE2
+    status = wifi_getApAclDevices(vap_index, *acl_list, max, acl_num);
+    if (status != RETURN_OK)
+    {
+        LOGE("%s: Failed to obtain ACL list for VAP index: %d (status %d)!",
+             __func__, vap_index, status);
+        FREE(*acl_list);
+        *acl_num = 0;
+        return false;
+    }
+#else
+    {
+        const char mac_list_separator[] = ",\n";
+        size_t buf_size = max * MAC_STR_LEN + 1;
+        char *acl_buf = CALLOC(1, buf_size);
+        char *s = NULL;
+        char *p;
+
+        status = wifi_getApAclDevices(vap_index, acl_buf, buf_size);
+        if (status != RETURN_OK)
+        {
+            LOGE("%s: Failed to obtain ACL list for VAP index: %d (status %d)!",
+                 __func__, vap_index, status);
+            FREE(acl_buf);
+            FREE(*acl_list);
+            return false;
+        }
+
+        for (p = strtok_r(acl_buf, mac_list_separator, &s);
+             p != NULL && *acl_num < max;
+             p = strtok_r(NULL, mac_list_separator, &s))
+        {
+            if (!acl_str_to_mac(p, (*acl_list)[*acl_num]))
+            {
+                LOGW("%s: VAP index: %d: ACL has malformed MAC \"%s\"", __func__, vap_index, p);
+                continue;
+            }
+            (*acl_num)++;
+        }
+
+        FREE(acl_buf);
+    }
+#endif
+
+    LOGD("%s: VAP index = %d: ACL list size: %u", __func__, vap_index, *acl_num);
+    return true;
+}
+
+static INT acl_hal_add(INT vap_index, mac_address_t mac)
+{
+#ifdef WIFI_HAL_VERSION_3_PHASE2
+    return wifi_addApAclDevice(vap_index, mac);
+#else
+    char mac_str[MAC_STR_LEN];
+
+    acl_mac_to_str(mac, mac_str, sizeof(mac_str));
+    return wifi_addApAclDevice(vap_index, mac_str);
+#endif
+}
+
+static INT acl_hal_del(INT vap_index, mac_address_t mac)
+{
+#ifdef WIFI_HAL_VERSION_3_PHASE2
+    return wifi_delApAclDevice(vap_index, mac);
+#else
+    char mac_str[MAC_STR_LEN];
+
+    acl_mac_to_str(mac, mac_str, sizeof(mac_str));
+    return wifi_delApAclDevice(vap_index, mac_str);
+#endif
+}
+
+static void acl_hal_add_all(INT vap_index, const char *vap_name, mac_address_t *macs, UINT num)
+{
+    char mac_str[MAC_STR_LEN];
+    UINT i;
+    INT ret;
+
+    for (i = 0; i < num; i++)
+    {
+        ret = acl_hal_add(vap_index, macs[i]);
+        acl_mac_to_str(macs[i], mac_str, sizeof(mac_str));
+        LOGD("[WIFI_HAL SET] wifi_addApAclDevice(%d, %s) = %d", vap_index, mac_str, ret);
+        if (ret != RETURN_OK)
+        {
+            LOGW("%s: Failed to add %s to ACL", vap_name, mac_str);
+        }
+    }
+}
+
+static void acl_hal_del_all(INT vap_index, const char *vap_name, mac_address_t *macs, UINT num)
+{
+    char mac_str[MAC_STR_LEN];
+    UINT i;
+    INT ret;
+
+    for (i = 0; i < num; i++)
+    {
+        ret = acl_hal_del(vap_index, macs[i]);
+        acl_mac_to_str(macs[i], mac_str, sizeof(mac_str));
+        LOGD("[WIFI_HAL SET] wifi_delApAclDevice(%d, %s) = %d", vap_index, mac_str, ret);
+        if (ret != RETURN_OK)
+        {
+            LOGW("%s: Failed to remove %s from ACL", vap_name, mac_str);
+        }
+    }
+}
+
+/*
+ * Apply a list of MAC addresses as the ACL of the VAP, issuing HAL calls
+ * only for the entries to add and to remove
+ */
+bool acl_hal_apply_list(
+        INT vap_index,
+        const char *vap_name,
+        bool deny_list,
+        const mac_address_t *target,
+        UINT target_num)
+{
+    mac_address_t *current = NULL;
+    mac_address_t *add;
+    mac_address_t *del;
+    UINT current_num;
+    UINT target_uniq = 0;
+    UINT add_num = 0;
+    UINT del_num = 0;
+    acl_set_t current_set;
+    acl_set_t target_set;
+    UINT i;
+    UINT n;
+    INT ret;
+
+    if (!acl_hal_get(vap_index, &current, &current_num))
+    {
+        LOGE("%s: Failed to get ACL list", vap_name);
+        return false;
+    }
+
+    add = CALLOC(target_num + 1, sizeof(mac_address_t));
+    del = CALLOC(current_num + 1, sizeof(mac_address_t));
+
+    acl_set_init(&current_set, current_num);
+    acl_set_init(&target_set, target_num);
+
+    // Drop duplicate HAL entries, so that each is removed only once
+    for (i = 0, n = 0; i < current_num; i++)
+    {
+        if (!acl_set_add(&current_set, current[i])) continue;
+        if (n != i) memcpy(current[n], current[i], sizeof(mac_address_t));
+        n++;
+    }
+    current_num = n;
+
+    for (i = 0; i < target_num; i++)
+    {
+        if (!acl_set_add(&target_set, target[i])) continue;
+
+        if (!acl_set_contains(&current_set, target[i]))
+        {
+            memcpy(add[add_num++], target[i], sizeof(mac_address_t));
+        }
+        target_uniq++;
+    }
+
+    for (i = 0; i < current_num; i++)
+    {
+        if (!acl_set_contains(&target_set, current[i]))
+        {
+            memcpy(del[del_num++], current[i], sizeof(mac_address_t));
+        }
+    }
+
+    LOGD("%s: ACL current=%u target=%u add=%u remove=%u",
+         vap_name, current_num, target_uniq, add_num, del_num);
+
+    if (target_uniq == 0 && del_num > 0)
+    {
+        // Emptying the list, a single flush does it
+        ret = wifi_delApAclDevices(vap_index);
+        LOGD("[WIFI_HAL SET] wifi_delApAclDevices(%d) = %d", vap_index, ret);
+        if (ret != RETURN_OK)
+        {
+            acl_hal_del_all(vap_index, vap_name, del, del_num);
+        }
+    }
+    else if (deny_list)
+    {
+        // Block new entries before unblocking the old ones
+        acl_hal_add_all(vap_index, vap_name, add, add_num);
+        acl_hal_del_all(vap_index, vap_name, del, del_num);
+    }
+    else
+    {
+        // Revoke old entries before allowing the new ones
+        acl_hal_del_all(vap_index, vap_name, del, del_num);
+        acl_hal_add_all(vap_index, vap_name, add, add_num);
+    }
+
+    acl_set_free(&current_set);
+    acl_set_free(&target_set);
+    FREE(current);
+    FREE(add);
+    FREE(del);
+    return true;
+}
+
+bool acl_hal_apply(
+        INT vap_index,
+        const char *vap_name,
+        bool deny_list,
+        const struct schema_Wifi_VIF_Config *vconf)
+{
+    mac_address_t *target;
+    UINT target_num = 0;
+    bool ret;
+    int i;
+
+    target = CALLOC(vconf->mac_list_len + 1, sizeof(mac_address_t));
+
+    for (i = 0; i < vconf->mac_list_len; i++)
+    {
+        if (!acl_str_to_mac(vconf->mac_list[i], target[target_num]))
+        {
+            LOGW("%s: Failed to convert ACL %s", vap_name, vconf->mac_list[i]);
+            continue;
+        }
+        target_num++;
+    }
+
+    ret = acl_hal_apply_list(vap_index, vap_name, deny_list, target, target_num);
+
+    FREE(target);
+    return ret;
+}
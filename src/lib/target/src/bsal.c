@@ -24,17 +24,15 @@ ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
 SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 */
 
+#include "os.h"
 #include "target.h"
 #include "ds_tree.h"
 #include "target_internal.h"
 #include "kconfig.h"
 
-#ifdef CONFIG_RDK_HAS_ASSOC_REQ_IES
-#include <endian.h>
-#include "bm_ieee80211.h"
-#endif
-
 #include <errno.h>
+#include <pthread.h>
+#include <ev.h>
 
 /*****************************************************************************/
 
@@ -64,17 +62,46 @@ typedef struct
 
 typedef struct
 {
-    uint8_t bssid[BSAL_MAC_ADDR_LEN];
-    char ifname[BSAL_IFNAME_LEN];
-} bsal_neigh_key_t;
-
-typedef struct
-{
-    bsal_neigh_key_t    key;
+    uint8_t             bssid[BSAL_MAC_ADDR_LEN];
     bsal_neigh_info_t   nr;
     ds_tree_node_t      dst_node;
 } bsal_neighbor_t;
 
+/*
+ * Neighbor reports are indexed per interface. Changes only mark the
+ * interface dirty; the list is pushed to the HAL from a debounced timer, so
+ * a burst of changes results in one wifi_setNeighborReports() call per
+ * interface, and none if the list ends up as it was last pushed. A failed
+ * push keeps the interface dirty and is retried with exponential backoff
+ * until the HAL takes the list, or sooner on the next change.
+ */
+typedef struct
+{
+    char                    ifname[BSAL_IFNAME_LEN];
+    ds_tree_t               neighbors;          // bsal_neighbor_t by BSSID
+    UINT                    neighbors_num;
+    bool                    dirty;
+    unsigned int            changes;            // Since the last push
+    unsigned int            retries;            // Failed pushes in a row
+    ev_tstamp               retry_at;           // Next attempt after a failure
+    wifi_NeighborReport_t  *pushed;             // Last list accepted by the HAL
+    UINT                    pushed_num;
+    ds_tree_node_t          dst_node;
+} bsal_neigh_iface_t;
+
+typedef struct
+{
+    uint64_t                changes;
+    uint64_t                pushes;
+    uint64_t                unchanged;          // Pushes skipped, list as last pushed
+    uint64_t                failures;
+} bsal_neigh_stats_t;
+
+#define BSAL_NEIGH_PUSH_DELAY       0.1     // Quiet time before a push [s]
+#define BSAL_NEIGH_PUSH_MAX_DELAY   1.0     // Upper bound since the first change [s]
+#define BSAL_NEIGH_PUSH_RETRIES     3       // Failed pushes before logging an error
+#define BSAL_NEIGH_PUSH_BACKOFF_MAX 60.0    // Upper bound of the retry backoff [s]
+
 typedef enum {
     BSAL_CHAN_WIDTH_20 = 0,
     BSAL_CHAN_WIDTH_40,
@@ -83,10 +110,16 @@ typedef enum {
     BSAL_CHAN_WIDTH_UNSUPPORTED
 } bsal_chwidth_t;
 
-static ds_key_cmp_t bssid_ifname_cmp;
-static ds_tree_t    bsal_ifaces_neighbors = DS_TREE_INIT(bssid_ifname_cmp,
-                                                            bsal_neighbor_t,
-                                                            dst_node);
+static ds_key_cmp_t bsal_bssid_cmp;
+static ds_tree_t    bsal_neigh_ifaces = DS_TREE_INIT((ds_key_cmp_t *)strcmp,
+                                                     bsal_neigh_iface_t,
+                                                     dst_node);
+static bsal_neigh_stats_t bsal_neigh_stats;
+static ev_timer     bsal_neigh_push_timer;
+static void         bsal_neigh_push_cb(struct ev_loop *loop, ev_timer *timer, int revents);
+static void         bsal_neigh_ifaces_flush(void);
+static ev_tstamp    bsal_neigh_pending_since;
+static struct ev_loop *bsal_evloop;
 
 static bsal_event_cb_t _bsal_event_cb = NULL;
 
@@ -115,27 +148,66 @@ static c_item_t map_rssi_xing[] =
     C_ITEM_VAL(WIFI_STEERING_RSSI_HIGHER, BSAL_RSSI_HIGHER)
 };
 
-typedef struct
+/*
+ * Client info cache, filled from HAL connect events (HAL thread) and read
+ * when BM queries a client (event loop), hence the lock. Entries are hashed
+ * by MAC and kept in LRU order. Entries are removed on disconnect; if that
+ * event is missed the cache is still bounded, the least recently used entry
+ * is evicted when it is full.
+ */
+#define BSAL_CLIENT_CACHE_BUCKETS   256     // Power of two
+#define BSAL_CLIENT_CACHE_MAX       1024
+
+typedef struct bsal_client_info_cache
 {
-    uint8_t             mac[BSAL_MAC_ADDR_LEN];
-    bsal_client_info_t  client;
-    ds_dlist_node_t     node;
+    uint8_t                         mac[BSAL_MAC_ADDR_LEN];
+    bsal_client_info_t              client;
+    struct bsal_client_info_cache  *hash_next;
+    ds_dlist_node_t                 node;       // LRU order, most recent last
 } bsal_client_info_cache_t;
 
-static ds_dlist_t g_client_info_list = DS_DLIST_INIT(
-        bsal_client_info_cache_t,
-        node);
+static struct
+{
+    pthread_mutex_t                 lock;
+    bsal_client_info_cache_t       *buckets[BSAL_CLIENT_CACHE_BUCKETS];
+    ds_dlist_t                      lru;
+    unsigned int                    num;
+    uint64_t                        lookups;
+    uint64_t                        hits;
+    uint64_t                        evictions;
+} g_client_info = {
+    .lock = PTHREAD_MUTEX_INITIALIZER,
+    .lru = DS_DLIST_INIT(bsal_client_info_cache_t, node),
+};
 
 /*****************************************************************************/
 
+static unsigned int bsal_client_info_hash(const uint8_t *mac)
+{
+    uint32_t h;
+
+    // The NIC specific part varies the most, also for randomized MACs
+    h = ((uint32_t)mac[3] << 16) | ((uint32_t)mac[4] << 8) | mac[5];
+    h ^= ((uint32_t)mac[0] << 8) | mac[2];
+    return (h * 2654435761u) >> 24 & (BSAL_CLIENT_CACHE_BUCKETS - 1);
+}
+
+// Must be called with g_client_info.lock held
 static bsal_client_info_cache_t *bsal_find_client_info(const uint8_t *mac)
 {
     bsal_client_info_cache_t *client_info_cache;
 
-    ds_dlist_foreach(&g_client_info_list, client_info_cache)
+    g_client_info.lookups++;
+
+    for (client_info_cache = g_client_info.buckets[bsal_client_info_hash(mac)];
+         client_info_cache != NULL;
+         client_info_cache = client_info_cache->hash_next)
     {
         if (!memcmp(mac, client_info_cache->mac, BSAL_MAC_ADDR_LEN))
         {
+            g_client_info.hits++;
+            ds_dlist_remove(&g_client_info.lru, client_info_cache);
+            ds_dlist_insert_tail(&g_client_info.lru, client_info_cache);
             return client_info_cache;
         }
     }
@@ -147,6 +219,87 @@ static bsal_client_info_cache_t *bsal_find_client_info(const uint8_t *mac)
     return NULL;
 }
 
+// Must be called with g_client_info.lock held
+static void bsal_client_info_unlink(bsal_client_info_cache_t *client_info_cache)
+{
+    bsal_client_info_cache_t **p;
+
+    p = &g_client_info.buckets[bsal_client_info_hash(client_info_cache->mac)];
+    while (*p != NULL && *p != client_info_cache)
+    {
+        p = &(*p)->hash_next;
+    }
+    if (*p != NULL)
+    {
+        *p = client_info_cache->hash_next;
+    }
+
+    ds_dlist_remove(&g_client_info.lru, client_info_cache);
+    g_client_info.num--;
+}
+
+// Must be called with g_client_info.lock held
+static bsal_client_info_cache_t *bsal_client_info_insert(const uint8_t *mac)
+{
+    bsal_client_info_cache_t *client_info_cache;
+    unsigned int bucket;
+
+    if (g_client_info.num >= BSAL_CLIENT_CACHE_MAX)
+    {
+        client_info_cache = ds_dlist_head(&g_client_info.lru);
+        bsal_client_info_unlink(client_info_cache);
+        g_client_info.evictions++;
+
+        LOGD("BSAL client_info cache full, evicted "MAC_ADDR_FMT" (lookups=%llu hits=%llu evictions=%llu)",
+             MAC_ADDR_UNPACK(client_info_cache->mac),
+             (unsigned long long)g_client_info.lookups,
+             (unsigned long long)g_client_info.hits,
+             (unsigned long long)g_client_info.evictions);
+
+        memset(client_info_cache, 0, sizeof(*client_info_cache));
+    }
+    else
+    {
+        client_info_cache = (bsal_client_info_cache_t *)calloc(1, sizeof(*client_info_cache));
+        if (client_info_cache == NULL)
+        {
+            LOGE("BSAL Failed to allocate memory for new client info");
+            return NULL;
+        }
+    }
+
+    memcpy(client_info_cache->mac, mac, sizeof(client_info_cache->mac));
+    bucket = bsal_client_info_hash(mac);
+    client_info_cache->hash_next = g_client_info.buckets[bucket];
+    g_client_info.buckets[bucket] = client_info_cache;
+    ds_dlist_insert_tail(&g_client_info.lru, client_info_cache);
+    g_client_info.num++;
+
+    return client_info_cache;
+}
+
+static void bsal_client_info_flush(void)
+{
+    bsal_client_info_cache_t *client_info_cache;
+
+    pthread_mutex_lock(&g_client_info.lock);
+
+    LOGI("BSAL client_info cache: entries=%u lookups=%llu hits=%llu evictions=%llu",
+         g_client_info.num,
+         (unsigned long long)g_client_info.lookups,
+         (unsigned long long)g_client_info.hits,
+         (unsigned long long)g_client_info.evictions);
+
+    while ((client_info_cache = ds_dlist_remove_head(&g_client_info.lru)) != NULL)
+    {
+        free(client_info_cache);
+    }
+    memset(g_client_info.buckets, 0, sizeof(g_client_info.buckets));
+    g_client_info.num = 0;
+
+    pthread_mutex_unlock(&g_client_info.lock);
+}
+
 static UINT bsal_convert_max_chwidth(UINT max_chwidth)
 {
     if (max_chwidth <= 3) return max_chwidth;
@@ -164,17 +317,17 @@ static void bsal_client_info_update(const wifi_steering_evConnect_t *connect)
     bsal_client_info_cache_t *client_info_cache;
     UINT max_chanwidth;
 
+    pthread_mutex_lock(&g_client_info.lock);
+
     client_info_cache = bsal_find_client_info(connect->client_mac);
     if (client_info_cache == NULL)  /* Allocate new node */
     {
-        client_info_cache = (bsal_client_info_cache_t *)calloc(1, sizeof(*client_info_cache));
+        client_info_cache = bsal_client_info_insert(connect->client_mac);
         if (client_info_cache == NULL)
         {
-            LOGE("BSAL Failed to allocate memory for new client info");
+            pthread_mutex_unlock(&g_client_info.lock);
             return;
         }
-        memcpy(client_info_cache->mac, connect->client_mac, sizeof(client_info_cache->mac));
-        ds_dlist_insert_tail(&g_client_info_list, client_info_cache);
     }
 
     client_info_cache->client.is_BTM_supported = connect->isBTMSupported;
@@ -223,19 +376,316 @@ static void bsal_client_info_update(const wifi_steering_evConnect_t *connect)
     client_info_cache->client.rrm_caps.ftm_range_rpt = connect->rrmCaps.ftmRangeRpt;
 
     /* assoc_ies and assoc_ies_len set to 0 */
+
+    pthread_mutex_unlock(&g_client_info.lock);
 }
 
 static void bsal_client_info_remove(const uint8_t *mac)
 {
     bsal_client_info_cache_t *client_info_cache;
 
+    pthread_mutex_lock(&g_client_info.lock);
+
     client_info_cache = bsal_find_client_info(mac);
-    if (client_info_cache == NULL)
+    if (client_info_cache != NULL)
     {
-        return;
+        bsal_client_info_unlink(client_info_cache);
+        free(client_info_cache);
+    }
+
+    pthread_mutex_unlock(&g_client_info.lock);
+}
+
+/*
+ * Per-VAP snapshot of the associated device list. BM asks for the info of
+ * many clients in a row during a steering round, they are all answered from
+ * one HAL fetch as long as it is not older than
+ * CONFIG_RDK_BSAL_ASSOC_SNAPSHOT_MS and no client (dis)connected on that VAP
+ * since. Only used from the event loop; the HAL thread just bumps the
+ * generation on connect and disconnect events.
+ */
+#define BSAL_ASSOC_SNAPSHOT_MAX     (MAX_NUM_RADIOS * MAX_NUM_VAP_PER_RADIO)
+
+typedef struct
+{
+    wifi_associated_dev3_t     *clients;
+    UINT                        clients_num;
+    double                      fetched;    // ev_now() of the fetch
+    unsigned int                gen;        // g_assoc_gen[] at fetch time
+    bool                        valid;
+} bsal_assoc_snapshot_t;
+
+static bsal_assoc_snapshot_t    g_assoc_snapshot[BSAL_ASSOC_SNAPSHOT_MAX];
+static bsal_assoc_snapshot_t    g_assoc_scratch;    // Out of range apIndex, never valid
+static unsigned int             g_assoc_gen[BSAL_ASSOC_SNAPSHOT_MAX];
+static uint64_t                 g_assoc_queries;
+static uint64_t                 g_assoc_fetches;
+
+static void bsal_assoc_snapshot_invalidate(INT apIndex)
+{
+    if (apIndex < 0 || apIndex >= BSAL_ASSOC_SNAPSHOT_MAX) return;
+    __atomic_add_fetch(&g_assoc_gen[apIndex], 1, __ATOMIC_RELEASE);
+}
+
+static void bsal_assoc_snapshot_flush(void)
+{
+    int i;
+
+    LOGI("BSAL assoc snapshot: queries=%llu fetches=%llu",
+         (unsigned long long)g_assoc_queries,
+         (unsigned long long)g_assoc_fetches);
+
+    for (i = 0; i < BSAL_ASSOC_SNAPSHOT_MAX; i++)
+    {
+        free(g_assoc_snapshot[i].clients);
+        memset(&g_assoc_snapshot[i], 0, sizeof(g_assoc_snapshot[i]));
+    }
+
+    free(g_assoc_scratch.clients);
+    memset(&g_assoc_scratch, 0, sizeof(g_assoc_scratch));
+}
+
+static const bsal_assoc_snapshot_t *bsal_assoc_snapshot_get(INT apIndex)
+{
+    bsal_assoc_snapshot_t *snap;
+    unsigned int gen = 0;
+    double now;
+    int wifi_hal_ret;
+
+    g_assoc_queries++;
+    now = ev_now(bsal_evloop ? bsal_evloop : EV_DEFAULT);
+
+    if (apIndex >= 0 && apIndex < BSAL_ASSOC_SNAPSHOT_MAX)
+    {
+        snap = &g_assoc_snapshot[apIndex];
+        gen = __atomic_load_n(&g_assoc_gen[apIndex], __ATOMIC_ACQUIRE);
+
+        if (snap->valid && snap->gen == gen &&
+            (now - snap->fetched) * 1000.0 < CONFIG_RDK_BSAL_ASSOC_SNAPSHOT_MS)
+        {
+            return snap;
+        }
+    }
+    else
+    {
+        snap = &g_assoc_scratch;
     }
-    ds_dlist_remove(&g_client_info_list, client_info_cache);
-    free(client_info_cache);
+
+    free(snap->clients);
+    memset(snap, 0, sizeof(*snap));
+
+    g_assoc_fetches++;
+    wifi_hal_ret = wifi_getApAssociatedDeviceDiagnosticResult3(apIndex, &snap->clients, &snap->clients_num);
+    if (wifi_hal_ret != RETURN_OK)
+    {
+        LOGE("BSAL Failed to fetch clients associated with iface: %d (wifi_getApAssociatedDeviceDiagnosticResult3() "
+             "failed with code %d)", apIndex, wifi_hal_ret);
+        free(snap->clients);
+        memset(snap, 0, sizeof(*snap));
+        return NULL;
+    }
+
+    LOGI("BSAL Found %u clients associated with iface: %d", snap->clients_num, apIndex);
+
+    snap->fetched = now;
+    snap->gen = gen;
+    snap->valid = (snap != &g_assoc_scratch);
+
+    return snap;
+}
+
+/*
+ * Probe request coalescing and rate limiting, run on the HAL thread before
+ * anything is allocated for the event.
+ *
+ * The first probe of a (client, iface) pair is delivered right away. Further
+ * probes within CONFIG_RDK_BSAL_PROBE_COALESCE_MS are folded into the pair's
+ * entry and the next delivered probe carries the strongest RSSI seen since
+ * the previous one, as long as the last folded probe is at most
+ * CONFIG_RDK_BSAL_PROBE_COALESCE_MS old. A change of the blocked or broadcast flag is always
+ * delivered. Delivered probes also take a token from a per-client bucket
+ * (CONFIG_RDK_BSAL_PROBE_RATE per second, CONFIG_RDK_BSAL_PROBE_BURST deep),
+ * probes without a token are suppressed.
+ *
+ * The tables are 4-way set associative and replace the least recently seen
+ * entry of a set, so thousands of passing clients only cost a fixed amount
+ * of memory. Token buckets are kept in a table of their own, under apIndex
+ * -1, so that a client's pair entries can't evict its bucket.
+ */
+#define BSAL_PROBE_SETS             512     // Power of two, at most 65536
+#define BSAL_PROBE_WAYS             4
+#define BSAL_PROBE_STATS_INTERVAL   60000   // ms
+
+typedef struct
+{
+    uint8_t             mac[BSAL_MAC_ADDR_LEN];
+    INT                 ap_index;
+    bool                used;
+    bool                blocked;
+    bool                ssid_null;
+    int32_t             max_rssi;           // Strongest RSSI folded since last delivery
+    unsigned int        folded;             // Probes folded since last delivery
+    uint64_t            window_start;       // Last delivery, ms
+    uint64_t            last_folded;        // ms
+    uint64_t            last_seen;          // ms
+    double              tokens;             // Only for ap_index == -1
+    uint64_t            refilled;           // Only for ap_index == -1, ms
+} bsal_probe_entry_t;
+
+typedef struct
+{
+    uint64_t            received;
+    uint64_t            delivered;
+    uint64_t            coalesced;
+    uint64_t            suppressed;
+    uint64_t            evicted;
+} bsal_probe_stats_t;
+
+static bsal_probe_entry_t   g_probe_table[BSAL_PROBE_SETS][BSAL_PROBE_WAYS];
+static bsal_probe_entry_t   g_probe_buckets[BSAL_PROBE_SETS][BSAL_PROBE_WAYS];
+static bsal_probe_stats_t   g_probe_stats;
+static uint64_t             g_probe_stats_logged;
+
+static bsal_probe_entry_t *bsal_probe_entry_get(
+        bsal_probe_entry_t (*table)[BSAL_PROBE_WAYS],
+        const uint8_t *mac,
+        INT ap_index,
+        uint64_t now)
+{
+    bsal_probe_entry_t *set;
+    bsal_probe_entry_t *victim;
+    uint32_t h;
+    int i;
+
+    h = ((uint32_t)mac[3] << 16) | ((uint32_t)mac[4] << 8) | mac[5];
+    h ^= ((uint32_t)mac[2] << 8) ^ (uint32_t)(ap_index + 1) * 0x9e37u;
+    set = table[(h * 2654435761u) >> 16 & (BSAL_PROBE_SETS - 1)];
+
+    victim = &set[0];
+    for (i = 0; i < BSAL_PROBE_WAYS; i++)
+    {
+        if (set[i].used && set[i].ap_index == ap_index &&
+            !memcmp(set[i].mac, mac, BSAL_MAC_ADDR_LEN))
+        {
+            set[i].last_seen = now;
+            return &set[i];
+        }
+
+        if (!set[i].used)
+        {
+            victim = &set[i];
+        }
+        else if (victim->used && set[i].last_seen < victim->last_seen)
+        {
+            victim = &set[i];
+        }
+    }
+
+    if (victim->used) g_probe_stats.evicted++;
+
+    memset(victim, 0, sizeof(*victim));
+    memcpy(victim->mac, mac, BSAL_MAC_ADDR_LEN);
+    victim->ap_index = ap_index;
+    victim->used = true;
+    victim->last_seen = now;
+    victim->tokens = CONFIG_RDK_BSAL_PROBE_BURST;
+    victim->refilled = now;
+
+    return victim;
+}
+
+static bool bsal_probe_take_token(const uint8_t *mac, uint64_t now)
+{
+    bsal_probe_entry_t *bucket;
+
+    if (CONFIG_RDK_BSAL_PROBE_RATE <= 0) return true;
+
+    bucket = bsal_probe_entry_get(g_probe_buckets, mac, -1, now);
+
+    bucket->tokens += (double)(now - bucket->refilled) * CONFIG_RDK_BSAL_PROBE_RATE / 1000.0;
+    if (bucket->tokens > CONFIG_RDK_BSAL_PROBE_BURST)
+    {
+        bucket->tokens = CONFIG_RDK_BSAL_PROBE_BURST;
+    }
+    bucket->refilled = now;
+
+    if (bucket->tokens < 1.0) return false;
+
+    bucket->tokens -= 1.0;
+    return true;
+}
+
+static void bsal_probe_stats_log(void)
+{
+    LOGI("BSAL probe requests: received=%llu delivered=%llu coalesced=%llu suppressed=%llu evicted=%llu",
+         (unsigned long long)g_probe_stats.received,
+         (unsigned long long)g_probe_stats.delivered,
+         (unsigned long long)g_probe_stats.coalesced,
+         (unsigned long long)g_probe_stats.suppressed,
+         (unsigned long long)g_probe_stats.evicted);
+}
+
+/*
+ * Returns true if the probe should be delivered, with *rssi set to the
+ * strongest RSSI folded into it.
+ */
+static bool bsal_probe_filter(const wifi_steering_event_t *wifi_hal_event, int32_t *rssi)
+{
+    const uint8_t *mac = (const uint8_t *)wifi_hal_event->data.probeReq.client_mac;
+    bool blocked = wifi_hal_event->data.probeReq.blocked ? true : false;
+    bool ssid_null = wifi_hal_event->data.probeReq.broadcast ? true : false;
+    bsal_probe_entry_t *entry;
+    bool flags_changed;
+    uint64_t now = get_timestamp();
+
+    g_probe_stats.received++;
+    *rssi = wifi_hal_event->data.probeReq.rssi;
+
+    if (now - g_probe_stats_logged >= BSAL_PROBE_STATS_INTERVAL)
+    {
+        g_probe_stats_logged = now;
+        bsal_probe_stats_log();
+    }
+
+    entry = bsal_probe_entry_get(g_probe_table, mac, wifi_hal_event->apIndex, now);
+    flags_changed = entry->window_start != 0 &&
+                    (entry->blocked != blocked || entry->ssid_null != ssid_null);
+
+    if (!flags_changed && entry->window_start != 0 &&
+        now - entry->window_start < CONFIG_RDK_BSAL_PROBE_COALESCE_MS)
+    {
+        if (entry->folded == 0 || *rssi > entry->max_rssi) entry->max_rssi = *rssi;
+        entry->folded++;
+        entry->last_folded = now;
+        g_probe_stats.coalesced++;
+        return false;
+    }
+
+    // Flag changes are state changes for BM, never rate limit those
+    if (!flags_changed && !bsal_probe_take_token(mac, now))
+    {
+        if (entry->folded == 0 || *rssi > entry->max_rssi) entry->max_rssi = *rssi;
+        entry->folded++;
+        entry->last_folded = now;
+        g_probe_stats.suppressed++;
+        return false;
+    }
+
+    // RSSI folded long ago no longer says where the client is
+    if (entry->folded > 0 && now - entry->last_folded < CONFIG_RDK_BSAL_PROBE_COALESCE_MS)
+    {
+        LOGT("BSAL "MAC_ADDR_FMT" apIndex: %d delivering probe after %u folded, max rssi: %d",
+             MAC_ADDR_UNPACK(mac), wifi_hal_event->apIndex, entry->folded, entry->max_rssi);
+        if (entry->max_rssi > *rssi) *rssi = entry->max_rssi;
+    }
+
+    entry->blocked = blocked;
+    entry->ssid_null = ssid_null;
+    entry->folded = 0;
+    entry->window_start = now;
+    g_probe_stats.delivered++;
+
+    return true;
 }
 
 static void process_event(
@@ -244,6 +694,7 @@ static void process_event(
 {
     bsal_event_t *bsal_event = NULL;
     uint32_t val = 0;
+    int32_t probe_rssi = 0;
     size_t i;
 
     // If we don't have a callback, just ignore the data
@@ -252,6 +703,12 @@ static void process_event(
         goto end;
     }
 
+    if (wifi_hal_event->type == WIFI_STEERING_EVENT_PROBE_REQ &&
+        !bsal_probe_filter(wifi_hal_event, &probe_rssi))
+    {
+        goto end;
+    }
+
     bsal_event = (bsal_event_t *)calloc(1, sizeof(*bsal_event));
     if (bsal_event == NULL)
     {
@@ -286,7 +743,7 @@ static void process_event(
         memcpy(&bsal_event->data.probe_req.client_addr,
                &wifi_hal_event->data.probeReq.client_mac,
                sizeof(bsal_event->data.probe_req.client_addr));
-        bsal_event->data.probe_req.rssi = wifi_hal_event->data.probeReq.rssi;
+        bsal_event->data.probe_req.rssi = probe_rssi;
         bsal_event->data.probe_req.ssid_null = wifi_hal_event->data.probeReq.broadcast ? true : false;
         bsal_event->data.probe_req.blocked = wifi_hal_event->data.probeReq.blocked   ? true : false;
         break;
@@ -325,6 +782,7 @@ static void process_event(
                sizeof(bsal_event->data.connect.client_addr));
 
         bsal_client_info_update(&wifi_hal_event->data.connect);
+        bsal_assoc_snapshot_invalidate(wifi_hal_event->apIndex);
         break;
 
     case WIFI_STEERING_EVENT_CLIENT_DISCONNECT:
@@ -353,6 +811,7 @@ static void process_event(
         bsal_event->data.disconnect.reason = wifi_hal_event->data.disconnect.reason;
 
         bsal_client_info_remove(wifi_hal_event->data.disconnect.client_mac);
+        bsal_assoc_snapshot_invalidate(wifi_hal_event->apIndex);
         break;
 
     case WIFI_STEERING_EVENT_CLIENT_ACTIVITY:
@@ -670,6 +1129,7 @@ int target_bsal_init(
 {
     int ret;
     wifi_hal_capability_t cap;
+    bsal_neigh_iface_t *neigh_iface;
 
     memset(&cap, 0, sizeof(cap));
 
@@ -680,6 +1140,18 @@ int target_bsal_init(
     }
 
     _bsal_event_cb = event_cb;
+    bsal_evloop = loop;
+    ev_init(&bsal_neigh_push_timer, bsal_neigh_push_cb);
+
+    // Neighbor lists that failed to push before there was a loop to retry on
+    ds_tree_foreach(&bsal_neigh_ifaces, neigh_iface)
+    {
+        if (!neigh_iface->dirty) continue;
+
+        ev_timer_set(&bsal_neigh_push_timer, BSAL_NEIGH_PUSH_DELAY, 0.);
+        ev_timer_start(bsal_evloop ? bsal_evloop : EV_DEFAULT, &bsal_neigh_push_timer);
+        break;
+    }
     memset(&group, 0, sizeof(group));
 
     ret = wifi_getHalCapability(&cap);
@@ -726,9 +1198,19 @@ int target_bsal_cleanup(void)
 {
     wifi_steering_eventUnregister();
 
+    ev_timer_stop(bsal_evloop ? bsal_evloop : EV_DEFAULT, &bsal_neigh_push_timer);
+    bsal_neigh_pending_since = 0;
+    bsal_neigh_ifaces_flush();
+
     _bsal_event_cb = NULL;
     free(group.iface);
 
+    bsal_client_info_flush();
+    bsal_assoc_snapshot_flush();
+    bsal_probe_stats_log();
+    memset(g_probe_table, 0, sizeof(g_probe_table));
+    memset(g_probe_buckets, 0, sizeof(g_probe_buckets));
+
     LOGI("BSAL cleaned up");
 
     return 0;
@@ -1032,24 +1514,20 @@ static bool bsal_client_set_connected(
         const uint8_t *mac_addr,
         bsal_client_info_t *info)
 {
-    wifi_associated_dev3_t *clients = NULL;
-    UINT clients_num = 0;
+    const bsal_assoc_snapshot_t *snap;
+    const wifi_associated_dev3_t *clients;
     UINT i = 0;
-    int wifi_hal_ret = 0;
     bsal_client_info_cache_t *client_info_cache;
 
-    wifi_hal_ret = wifi_getApAssociatedDeviceDiagnosticResult3(apIndex, &clients, &clients_num);
-    if (wifi_hal_ret != RETURN_OK)
+    snap = bsal_assoc_snapshot_get(apIndex);
+    if (snap == NULL)
     {
-        LOGE("BSAL Failed to fetch clients associated with iface: %d (wifi_getApAssociatedDeviceDiagnosticResult3() "
-             "failed with code %d)", apIndex, wifi_hal_ret);
         return false;
     }
-
-    LOGI("BSAL Found %u clients associated with iface: %d", clients_num, apIndex);
+    clients = snap->clients;
 
     memset(info, 0, sizeof(*info));
-    for (i = 0; i < clients_num; i++)
+    for (i = 0; i < snap->clients_num; i++)
     {
         if (memcmp(mac_addr, &clients[i].cli_MACAddress, sizeof(clients[i].cli_MACAddress)) == 0)
         {
@@ -1059,6 +1537,7 @@ static bool bsal_client_set_connected(
             info->rx_bytes = clients[i].cli_BytesReceived;
             if (!kconfig_enabled(CONFIG_RDK_HAS_ASSOC_REQ_IES))
             {
+                pthread_mutex_lock(&g_client_info.lock);
                 client_info_cache = bsal_find_client_info(mac_addr);
                 if (client_info_cache != NULL)
                 {
@@ -1068,6 +1547,7 @@ static bool bsal_client_set_connected(
                     client_info_cache->client.tx_bytes = clients[i].cli_BytesSent;
                     memcpy(info, &client_info_cache->client, sizeof(*info));
                 }
+                pthread_mutex_unlock(&g_client_info.lock);
             }
             LOGI("BSAL Client "MAC_ADDR_FMT" is connected apIndex: %d, SNR: %d, rx: %lld, tx: %lld", MAC_ADDR_UNPACK(mac_addr),
                 apIndex, info->snr, info->rx_bytes, info->tx_bytes);
@@ -1076,7 +1556,6 @@ static bool bsal_client_set_connected(
         }
     }
 
-    free(clients);
     return true;
 }
 
@@ -1219,162 +1698,6 @@ error:
     return -1;
 }
 
-#ifdef CONFIG_RDK_HAS_ASSOC_REQ_IES
-static int get_ht_mcs_max(uint32_t mcs_set)
-{
-    int i;
-
-    LOGD("HT mcs_set = %x\n", mcs_set);
-    // We don't handle mcs_set == 0. Just return 0 in that case.
-    for (i = 0; i < 32; i++)
-    {
-        // Shift right the mcs_set until no more bits
-        // are set. Amount of the shifts equals to
-        // the position of highest bit set to '1'. Position
-        // of highest '1' determines the max supported
-        // MCS. We check here only for 0-31 MCS set.
-        mcs_set = mcs_set >> 1;
-        if (mcs_set == 0) break;
-    }
-
-    return i;
-}
-
-static int get_vht_mcs_max(uint16_t rx_mcs_map)
-{
-    int i;
-    int max_mcs = 0;
-
-    for (i = 0; i < 8; i++)
-    {
-        switch (rx_mcs_map & 0x03)
-        {
-            case 0x00:
-                max_mcs = max_mcs < 7 ? 7 : max_mcs;
-                break;
-            case 0x01:
-                max_mcs = max_mcs < 8 ? 8 : max_mcs;
-                break;
-            case 0x02:
-                max_mcs = max_mcs < 9 ? 9 : max_mcs;
-                break;
-            default:
-                // Not supported or invalid
-                break;
-        }
-
-        rx_mcs_map = rx_mcs_map >> 2;
-    }
-
-    return max_mcs;
-}
-
-static int get_vht_nss_max(uint16_t rx_mcs_map)
-{
-    int i;
-    int number_of_spatial_streams = 0;
-
-    for (i = 0; i < 8; i++)
-    {
-        // Set number of spatial streams for highest found valid bit pair.
-        if ((rx_mcs_map & 0x03) != 0x03) number_of_spatial_streams = i + 1;
-        rx_mcs_map = rx_mcs_map >> 2;
-    }
-
-    return number_of_spatial_streams;
-}
-
-static void bm_parse_btm_supported(bsal_client_info_t *info, uint32_t ext_caps)
-{
-    // We only check the first 4 bytes from extended capabilities
-    info->is_BTM_supported = !!(ext_caps & IEEE80211_EXTCAPIE_BSSTRANSITION);
-}
-
-static void bm_parse_rrm_supported(bsal_client_info_t *info, uint8_t rm_cap_oct1,
-                                uint8_t rm_cap_oct2, uint8_t rm_cap_oct5)
-{
-    info->is_RRM_supported = true;
-    info->rrm_caps.link_meas = !!(rm_cap_oct1 & IEEE80211_RRM_CAPS_LINK_MEASUREMENT);
-    info->rrm_caps.neigh_rpt = !!(rm_cap_oct1 & IEEE80211_RRM_CAPS_NEIGHBOR_REPORT);
-    info->rrm_caps.bcn_rpt_passive = !!(rm_cap_oct1 & IEEE80211_RRM_CAPS_BEACON_REPORT_PASSIVE);
-    info->rrm_caps.bcn_rpt_active = !!(rm_cap_oct1 & IEEE80211_RRM_CAPS_BEACON_REPORT_ACTIVE);
-    info->rrm_caps.bcn_rpt_table = !!(rm_cap_oct1 & IEEE80211_RRM_CAPS_BEACON_REPORT_TABLE);
-    info->rrm_caps.lci_meas = !!(rm_cap_oct2 & IEEE80211_RRM_CAPS_LCI_MEASUREMENT);
-    info->rrm_caps.ftm_range_rpt = !!(rm_cap_oct5 & IEEE80211_RRM_CAPS_FTM_RANGE_REPORT);
-}
-
-static void bm_parse_ht_cap(bsal_client_info_t *info, uint16_t ht_cap_info, uint32_t mcs_set)
-{
-    int ht_mcs_max;
-    int ht_nss_max;
-
-    if ((ht_cap_info & IEEE80211_HTCAP_C_CHWIDTH40) && (info->datarate_info.max_chwidth == 0))
-    {
-        info->datarate_info.max_chwidth = 1;  // 40 MHz
-    }
-
-    ht_mcs_max = get_ht_mcs_max(mcs_set);
-    ht_nss_max = ht_mcs_max / 8 + 1;
-
-    if (info->datarate_info.max_MCS < ht_mcs_max)
-    {
-        info->datarate_info.max_MCS = ht_mcs_max % 8;  // we always normalize to VHT
-    }
-
-    if (info->datarate_info.max_streams < ht_nss_max)
-    {
-        info->datarate_info.max_streams = ht_nss_max;
-    }
-
-    // If SMPS is set to 0 it means "Capable of SM Power Save (Static)"
-    info->datarate_info.is_static_smps =
-        (ht_cap_info & IEEE80211_HTCAP_C_SM_MASK) == 0x00 ? 1 : 0;
-}
-
-static void bm_parse_pwr_cap(bsal_client_info_t *info, uint8_t max_tx_power)
-{
-    info->datarate_info.max_txpower = max_tx_power;
-}
-
-static void bm_parse_vht_cap(bsal_client_info_t *info, uint32_t vht_info, uint16_t rx_mcs_map)
-{
-    int vht_max;
-    int nss_max;
-
-    info->datarate_info.max_chwidth = 2;  // 80 MHz
-    if (vht_info & IEEE80211_VHTCAP_SHORTGI_160)
-    {
-        info->datarate_info.max_chwidth = 3;  // 160 MHz
-    }
-
-    vht_max = get_vht_mcs_max(rx_mcs_map);
-    nss_max = get_vht_nss_max(rx_mcs_map);
-
-    if (info->datarate_info.max_MCS < vht_max)
-    {
-        info->datarate_info.max_MCS = vht_max;
-    }
-    if (info->datarate_info.max_streams < nss_max)
-    {
-        info->datarate_info.max_streams = nss_max;
-    }
-
-    info->datarate_info.is_mu_mimo_supported = !!(vht_info & IEEE80211_VHTCAP_MU_BFORMEE);
-}
-
-static void set_client_legacy(bsal_client_info_t *info)
-{
-    // The 2.4/5G capabilities are tracked by BM based on probe request.
-    // Don't set it here. The phy_mode is also not set, as it can be calculated
-    // by the cloud if max BW, MCS and NSS are provided.
-    // Besides that, assume it is a legacy client. If capabilities are discovered,
-    // they will overwrite the below defaults. The NSS is set to '0' for legacy clients.
-    info->is_BTM_supported = 0;
-    info->is_RRM_supported = 0;
-    memset(&info->datarate_info, 0, sizeof(info->datarate_info));
-    memset(&info->rrm_caps, 0, sizeof(info->rrm_caps));
-}
-#endif
 
 int target_bsal_client_info(
         const char *ifname,
@@ -1383,7 +1706,6 @@ int target_bsal_client_info(
 {
     const iface_t *iface = NULL;
     INT apIndex;
-    const struct element *elem;
     INT ret;
     CHAR req_ies[1024];
     UINT req_ies_len;
@@ -1429,75 +1751,90 @@ int target_bsal_client_info(
         memcpy(info->assoc_ies, req_ies, req_ies_len);
         info->assoc_ies_len = req_ies_len;
 
-        set_client_legacy(info);
-
-        for_each_element(elem, req_ies, req_ies_len) {
-            switch (elem->id) {
-                case WLAN_EID_EXT_CAPAB:
-                    bm_parse_btm_supported(info, le32toh(*(uint32_t *)elem->data));
-                    break;
-                case WLAN_EID_RRM_ENABLED_CAPABILITIES:
-                    bm_parse_rrm_supported(info, elem->data[0], elem->data[1], elem->data[4]);
-                    break;
-                case WLAN_EID_HT_CAP:
-                    bm_parse_ht_cap(info, le16toh(*(uint16_t *)elem->data),
-                        le32toh(*(uint32_t *)&elem->data[3]));
-                    break;
-                case WLAN_EID_VHT_CAP:
-                    bm_parse_vht_cap(info, le32toh(*(uint32_t *)elem->data), le16toh(*(uint16_t*)&elem->data[4]));
-                    break;
-                case WLAN_EID_PWR_CAPABILITY:
-                    bm_parse_pwr_cap(info, elem->data[1]);
-                    break;
-                default:
-                    break;
-            }
-        }
+        bsal_parse_assoc_ies(info, (const uint8_t *)req_ies, req_ies_len);
     }
 
     return 0;
 }
 
-static int bssid_ifname_cmp(const void *_a, const void *_b)
+static int bsal_bssid_cmp(const void *a, const void *b)
 {
-    const bsal_neigh_key_t *a = _a;
-    const bsal_neigh_key_t *b = _b;
-    int rc;
+    return memcmp(a, b, BSAL_MAC_ADDR_LEN);
+}
 
-    rc = memcmp(&a->bssid, &b->bssid, sizeof(a->bssid));
-    if (rc != 0) return rc;
+static bsal_neigh_iface_t *bsal_neigh_iface_get(const char *ifname, bool create)
+{
+    bsal_neigh_iface_t *iface;
 
-    rc = memcmp(&a->ifname, &b->ifname, sizeof(a->ifname));
-    if (rc != 0) return rc;
+    iface = ds_tree_find(&bsal_neigh_ifaces, (void *)ifname);
+    if (iface || !create) return iface;
 
-    return 0;
+    iface = calloc(1, sizeof(*iface));
+    if (!iface)
+    {
+        LOGE("%s:%d: unable to allocate memory", __func__, __LINE__);
+        return NULL;
+    }
+
+    STRSCPY(iface->ifname, ifname);
+    ds_tree_init(&iface->neighbors, bsal_bssid_cmp, bsal_neighbor_t, dst_node);
+    ds_tree_insert(&bsal_neigh_ifaces, iface, iface->ifname);
+    return iface;
+}
+
+static void bsal_neigh_iface_free(bsal_neigh_iface_t *iface)
+{
+    bsal_neighbor_t *neighbor;
+    ds_tree_iter_t iter;
+
+    ds_tree_foreach_iter(&iface->neighbors, neighbor, &iter)
+    {
+        ds_tree_iremove(&iter);
+        free(neighbor);
+    }
+
+    free(iface->pushed);
+    free(iface);
 }
 
-static int bsal_send_update_neighbor_list(const char *ifname)
+static void bsal_neigh_ifaces_flush(void)
+{
+    bsal_neigh_iface_t *iface;
+    ds_tree_iter_t iter;
+
+    ds_tree_foreach_iter(&bsal_neigh_ifaces, iface, &iter)
+    {
+        ds_tree_iremove(&iter);
+        bsal_neigh_iface_free(iface);
+    }
+}
+
+static void bsal_neigh_iface_free_if_unused(bsal_neigh_iface_t *iface)
+{
+    if (iface->dirty || iface->neighbors_num > 0 || iface->pushed_num > 0) return;
+
+    ds_tree_remove(&bsal_neigh_ifaces, iface);
+    bsal_neigh_iface_free(iface);
+}
+
+static int bsal_send_update_neighbor_list(bsal_neigh_iface_t *iface)
 {
     bsal_neighbor_t         *iface_neighbor;
-    UINT                    iface_neighbors_number = 0;
     wifi_NeighborReport_t   *neighbor_reports = NULL;
     INT                     ap_index;
     uint32_t                i = 0;
     INT                     ret;
 
-    ds_tree_foreach(&bsal_ifaces_neighbors, iface_neighbor)
-    {
-        if (!strcmp(iface_neighbor->key.ifname, ifname))
-        {
-            iface_neighbors_number++;
-        }
-    }
-
-    if (!vif_ifname_to_idx(ifname, &ap_index))
+    if (!vif_ifname_to_idx(iface->ifname, &ap_index))
     {
+        LOGW("BSAL: %s: dropping neighbor list update, interface not found", iface->ifname);
+        iface->dirty = false;
         return -1;
     }
 
-    if (iface_neighbors_number > 0)
+    if (iface->neighbors_num > 0)
     {
-        neighbor_reports = calloc(iface_neighbors_number, sizeof(wifi_NeighborReport_t));
+        neighbor_reports = calloc(iface->neighbors_num, sizeof(wifi_NeighborReport_t));
         if (!neighbor_reports)
         {
             LOGE("%s:%d: unable to allocate memory", __func__, __LINE__);
@@ -1505,13 +1842,9 @@ static int bsal_send_update_neighbor_list(const char *ifname)
         }
 
         // fill in the wifi_hal list with neighbors
-        ds_tree_foreach(&bsal_ifaces_neighbors, iface_neighbor)
+        ds_tree_foreach(&iface->neighbors, iface_neighbor)
         {
-            if (strcmp(iface_neighbor->key.ifname, ifname))
-            {
-                continue;
-            }
-            if (i >= iface_neighbors_number)
+            if (i >= iface->neighbors_num)
             {
                 break;
             }
@@ -1524,30 +1857,163 @@ static int bsal_send_update_neighbor_list(const char *ifname)
         }
     }
 
-    ret =  wifi_setNeighborReports((UINT)ap_index, iface_neighbors_number, neighbor_reports);
-    if (neighbor_reports) free(neighbor_reports);
+    if (iface->pushed_num == iface->neighbors_num &&
+        (iface->neighbors_num == 0 ||
+         (iface->pushed &&
+          !memcmp(iface->pushed, neighbor_reports, iface->neighbors_num * sizeof(*neighbor_reports)))))
+    {
+        LOGD("BSAL: %s: neighbor list unchanged after %u changes, not pushed",
+             iface->ifname, iface->changes);
+        bsal_neigh_stats.unchanged++;
+        free(neighbor_reports);
+        iface->dirty = false;
+        iface->changes = 0;
+        return 0;
+    }
 
+    ret =  wifi_setNeighborReports((UINT)ap_index, iface->neighbors_num, neighbor_reports);
     if (ret != RETURN_OK)
     {
-        LOGE("%s: unable to setNeighborReports for %s", __func__, ifname);
+        LOGE("%s: unable to setNeighborReports for %s", __func__, iface->ifname);
+        bsal_neigh_stats.failures++;
+        free(neighbor_reports);
         return -1;
     }
 
+    bsal_neigh_stats.pushes++;
+    LOGI("BSAL: %s: pushed %u neighbors, %u changes coalesced "
+         "(total changes=%llu pushes=%llu unchanged=%llu failures=%llu)",
+         iface->ifname, iface->neighbors_num, iface->changes,
+         (unsigned long long)bsal_neigh_stats.changes,
+         (unsigned long long)bsal_neigh_stats.pushes,
+         (unsigned long long)bsal_neigh_stats.unchanged,
+         (unsigned long long)bsal_neigh_stats.failures);
+
+    free(iface->pushed);
+    iface->pushed = neighbor_reports;
+    iface->pushed_num = iface->neighbors_num;
+    iface->dirty = false;
+    iface->changes = 0;
     return 0;
 }
 
+static ev_tstamp bsal_neigh_backoff(unsigned int retries)
+{
+    ev_tstamp backoff = BSAL_NEIGH_PUSH_MAX_DELAY;
+
+    while (--retries > 0 && backoff < BSAL_NEIGH_PUSH_BACKOFF_MAX)
+    {
+        backoff *= 2;
+    }
+
+    return backoff < BSAL_NEIGH_PUSH_BACKOFF_MAX ? backoff : BSAL_NEIGH_PUSH_BACKOFF_MAX;
+}
+
+static void bsal_neigh_push_cb(struct ev_loop *loop, ev_timer *timer, int revents)
+{
+    bsal_neigh_iface_t *iface;
+    ds_tree_iter_t iter;
+    ev_tstamp now = ev_now(loop);
+    ev_tstamp next = 0;
+
+    for (   iface = ds_tree_ifirst(&iter, &bsal_neigh_ifaces);
+            iface != NULL;
+            iface = ds_tree_inext(&iter))
+    {
+        if (!iface->dirty) continue;
+
+        if (iface->retry_at > now)
+        {
+            // Backing off after a failure
+            if (next == 0 || iface->retry_at < next) next = iface->retry_at;
+            continue;
+        }
+
+        if (bsal_send_update_neighbor_list(iface) != 0 && iface->dirty)
+        {
+            iface->retries++;
+            iface->retry_at = now + bsal_neigh_backoff(iface->retries);
+            if (next == 0 || iface->retry_at < next) next = iface->retry_at;
+
+            if (iface->retries == BSAL_NEIGH_PUSH_RETRIES)
+            {
+                LOGE("BSAL: %s: neighbor list update failed %u times, retrying up to every %.0f s",
+                     iface->ifname, iface->retries, BSAL_NEIGH_PUSH_BACKOFF_MAX);
+            }
+            continue;
+        }
+
+        if (iface->retries >= BSAL_NEIGH_PUSH_RETRIES)
+        {
+            LOGI("BSAL: %s: neighbor list updated after %u failed attempts",
+                 iface->ifname, iface->retries);
+        }
+        iface->retries = 0;
+        iface->retry_at = 0;
+
+        if (iface->neighbors_num == 0 && iface->pushed_num == 0)
+        {
+            ds_tree_iremove(&iter);
+            bsal_neigh_iface_free(iface);
+        }
+    }
+
+    bsal_neigh_pending_since = 0;
+    if (next > 0)
+    {
+        ev_timer_set(timer, next - now, 0.);
+        ev_timer_start(loop, timer);
+    }
+}
+
+static void bsal_neigh_schedule(bsal_neigh_iface_t *iface)
+{
+    struct ev_loop *loop = bsal_evloop ? bsal_evloop : EV_DEFAULT;
+    ev_tstamp now = ev_now(loop);
+    ev_tstamp delay = BSAL_NEIGH_PUSH_DELAY;
+
+    iface->dirty = true;
+    iface->changes++;
+    iface->retry_at = 0;
+    bsal_neigh_stats.changes++;
+
+    if (_bsal_event_cb == NULL)
+    {
+        // Not initialized, there is no loop to defer to
+        bsal_send_update_neighbor_list(iface);
+        return;
+    }
+
+    if (bsal_neigh_pending_since == 0)
+    {
+        bsal_neigh_pending_since = now;
+    }
+
+    // Restart the quiet period, but do not hold the push back indefinitely
+    if (now + delay > bsal_neigh_pending_since + BSAL_NEIGH_PUSH_MAX_DELAY)
+    {
+        delay = bsal_neigh_pending_since + BSAL_NEIGH_PUSH_MAX_DELAY - now;
+        if (delay < 0.) delay = 0.;
+    }
+
+    ev_timer_stop(loop, &bsal_neigh_push_timer);
+    ev_timer_set(&bsal_neigh_push_timer, delay, 0.);
+    ev_timer_start(loop, &bsal_neigh_push_timer);
+}
+
 int target_bsal_rrm_set_neighbor(const char *ifname, const bsal_neigh_info_t *nr)
 {
+    bsal_neigh_iface_t  *iface;
     bsal_neighbor_t     *iface_neighbor;
-    bsal_neigh_key_t    key;
-    int                 ret;
 
-    memset(&key, 0, sizeof(key));
-    memcpy(key.bssid, nr->bssid, sizeof(key.bssid));
-    STRSCPY(key.ifname, ifname);
+    iface = bsal_neigh_iface_get(ifname, true);
+    if (!iface)
+    {
+        return -1;
+    }
 
     // Insert or modify neighbor in the list
-    iface_neighbor = ds_tree_find(&bsal_ifaces_neighbors, &key);
+    iface_neighbor = ds_tree_find(&iface->neighbors, (void *)nr->bssid);
     if (iface_neighbor)
     {
         memcpy(&iface_neighbor->nr, nr, sizeof(iface_neighbor->nr));
@@ -1558,41 +2024,33 @@ int target_bsal_rrm_set_neighbor(const char *ifname, const bsal_neigh_info_t *nr
         if (!iface_neighbor)
         {
             LOGE("%s:%d: unable to allocate memory", __func__, __LINE__);
+            bsal_neigh_iface_free_if_unused(iface);
             return -1;
         }
         memcpy(&iface_neighbor->nr, nr, sizeof(iface_neighbor->nr));
-        memcpy(&iface_neighbor->key, &key, sizeof(iface_neighbor->key));
-        ds_tree_insert(&bsal_ifaces_neighbors, iface_neighbor, &iface_neighbor->key);
+        memcpy(iface_neighbor->bssid, nr->bssid, sizeof(iface_neighbor->bssid));
+        ds_tree_insert(&iface->neighbors, iface_neighbor, iface_neighbor->bssid);
+        iface->neighbors_num++;
     }
 
     LOGD("BSAL: %s: inserted neighbor %s, "MAC_ADDR_FMT, __func__, ifname, MAC_ADDR_UNPACK(nr->bssid));
 
-    ret = bsal_send_update_neighbor_list(ifname);
-    if (ret)
-    {
-        ds_tree_remove(&bsal_ifaces_neighbors, iface_neighbor);
-        free(iface_neighbor);
-
-        LOGE("BSAL: %s: failed adding neighbor %s, "MAC_ADDR_FMT, __func__, ifname, MAC_ADDR_UNPACK(nr->bssid));
-        return ret;
-    }
-
-    LOGI("BSAL: %s: succesfully added neighbor %s, "MAC_ADDR_FMT, __func__, ifname, MAC_ADDR_UNPACK(nr->bssid));
+    bsal_neigh_schedule(iface);
 
     return 0;
 }
 
 int target_bsal_rrm_remove_neighbor(const char *ifname, const bsal_neigh_info_t *nr)
 {
-    bsal_neighbor_t     *iface_neighbor;
-    bsal_neigh_key_t    key;
-    int                 ret;
+    bsal_neigh_iface_t  *iface;
+    bsal_neighbor_t     *iface_neighbor = NULL;
 
-    memset(&key, 0, sizeof(key));
-    memcpy(key.bssid, nr->bssid, sizeof(key.bssid));
-    STRSCPY(key.ifname, ifname);
+    iface = bsal_neigh_iface_get(ifname, false);
+    if (iface)
+    {
+        iface_neighbor = ds_tree_find(&iface->neighbors, (void *)nr->bssid);
+    }
 
-    iface_neighbor = ds_tree_find(&bsal_ifaces_neighbors, &key);
     if (!iface_neighbor)
     {
         LOGD("%s: unable to find neighbor bssid="MAC_ADDR_FMT" ifaname=%s", __func__,
@@ -1600,18 +2058,13 @@ int target_bsal_rrm_remove_neighbor(const char *ifname, const bsal_neigh_info_t
         return 0;
     }
 
-    ds_tree_remove(&bsal_ifaces_neighbors, iface_neighbor);
-
-    ret = bsal_send_update_neighbor_list(ifname);
-    if (ret)
-    {
-        ds_tree_insert(&bsal_ifaces_neighbors, iface_neighbor, &key);
-        LOGE("BSAL: %s: failed removing neighbor %s, "MAC_ADDR_FMT, __func__, ifname, MAC_ADDR_UNPACK(nr->bssid));
-        return ret;
-    }
+    ds_tree_remove(&iface->neighbors, iface_neighbor);
+    iface->neighbors_num--;
     free(iface_neighbor);
 
-    LOGI("BSAL: %s: succesfully removed neighbor %s, "MAC_ADDR_FMT, __func__, ifname, MAC_ADDR_UNPACK(nr->bssid));
+    LOGD("BSAL: %s: removed neighbor %s, "MAC_ADDR_FMT, __func__, ifname, MAC_ADDR_UNPACK(nr->bssid));
+
+    bsal_neigh_schedule(iface);
 
     return 0;
 }
@@ -0,0 +1,330 @@
+/*
+Copyright (c) 2017, Plume Design Inc. All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+   1. Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+   2. Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+   3. Neither the name of the Plume Design Inc. nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL Plume Design Inc. BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+/*
+ * Client capabilities from association request IEs
+ *
+ * Shared by bsal.c and bsal_legacy.c. The IE buffer is walked once with
+ * bm_ie_parse(); every element kind of interest has a handler in
+ * bsal_ie_handlers[] that fills bsal_client_info_t. Handlers declare the
+ * minimum element length they read, so truncated or malformed elements are
+ * skipped instead of read past their end.
+ */
+
+#include <stdint.h>
+#include <string.h>
+
+#include "log.h"
+#include "target.h"
+#include "target_internal.h"
+#include "bm_ieee80211.h"
+
+/*****************************************************************************/
+
+static uint16_t bsal_ie_get_le16(const uint8_t *p)
+{
+    return (uint16_t)p[0] | ((uint16_t)p[1] << 8);
+}
+
+static uint32_t bsal_ie_get_le32(const uint8_t *p)
+{
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) |
+           ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static int get_ht_mcs_max(uint32_t mcs_set)
+{
+    int i;
+
+    LOGD("HT mcs_set = %x\n", mcs_set);
+    // We don't handle mcs_set == 0. Just return 0 in that case.
+    for (i = 0; i < 32; i++)
+    {
+        // Shift right the mcs_set until no more bits
+        // are set. Amount of the shifts equals to
+        // the position of highest bit set to '1'. Position
+        // of highest '1' determines the max supported
+        // MCS. We check here only for 0-31 MCS set.
+        mcs_set = mcs_set >> 1;
+        if (mcs_set == 0) break;
+    }
+
+    return i;
+}
+
+static int get_vht_mcs_max(uint16_t rx_mcs_map)
+{
+    int i;
+    int max_mcs = 0;
+
+    for (i = 0; i < 8; i++)
+    {
+        switch (rx_mcs_map & 0x03)
+        {
+            case 0x00:
+                max_mcs = max_mcs < 7 ? 7 : max_mcs;
+                break;
+            case 0x01:
+                max_mcs = max_mcs < 8 ? 8 : max_mcs;
+                break;
+            case 0x02:
+                max_mcs = max_mcs < 9 ? 9 : max_mcs;
+                break;
+            default:
+                // Not supported or invalid
+                break;
+        }
+
+        rx_mcs_map = rx_mcs_map >> 2;
+    }
+
+    return max_mcs;
+}
+
+static int get_he_mcs_max(uint16_t rx_mcs_map)
+{
+    int i;
+    int max_mcs = 0;
+
+    for (i = 0; i < 8; i++)
+    {
+        switch (rx_mcs_map & 0x03)
+        {
+            case 0x00:
+                max_mcs = max_mcs < 7 ? 7 : max_mcs;
+                break;
+            case 0x01:
+                max_mcs = max_mcs < 9 ? 9 : max_mcs;
+                break;
+            case 0x02:
+                max_mcs = max_mcs < 11 ? 11 : max_mcs;
+                break;
+            default:
+                // Not supported or invalid
+                break;
+        }
+
+        rx_mcs_map = rx_mcs_map >> 2;
+    }
+
+    return max_mcs;
+}
+
+// Same 2 bits per NSS layout for the VHT and HE MCS maps
+static int get_vht_nss_max(uint16_t rx_mcs_map)
+{
+    int i;
+    int number_of_spatial_streams = 0;
+
+    for (i = 0; i < 8; i++)
+    {
+        // Set number of spatial streams for highest found valid bit pair.
+        if ((rx_mcs_map & 0x03) != 0x03) number_of_spatial_streams = i + 1;
+        rx_mcs_map = rx_mcs_map >> 2;
+    }
+
+    return number_of_spatial_streams;
+}
+
+/*****************************************************************************/
+
+static void bm_parse_btm_supported(void *ctx, const uint8_t *data, uint8_t len)
+{
+    bsal_client_info_t *info = ctx;
+    uint8_t ext_caps[4] = { 0 };
+
+    // We only check the first 4 bytes from extended capabilities,
+    // the element may legitimately be shorter
+    memcpy(ext_caps, data, len < sizeof(ext_caps) ? len : sizeof(ext_caps));
+    info->is_BTM_supported = !!(bsal_ie_get_le32(ext_caps) & IEEE80211_EXTCAPIE_BSSTRANSITION);
+}
+
+static void bm_parse_rrm_supported(void *ctx, const uint8_t *data, uint8_t len)
+{
+    bsal_client_info_t *info = ctx;
+    uint8_t rm_cap_oct1 = data[0];
+    uint8_t rm_cap_oct2 = data[1];
+    uint8_t rm_cap_oct5 = data[4];
+
+    info->is_RRM_supported = true;
+    info->rrm_caps.link_meas = !!(rm_cap_oct1 & IEEE80211_RRM_CAPS_LINK_MEASUREMENT);
+    info->rrm_caps.neigh_rpt = !!(rm_cap_oct1 & IEEE80211_RRM_CAPS_NEIGHBOR_REPORT);
+    info->rrm_caps.bcn_rpt_passive = !!(rm_cap_oct1 & IEEE80211_RRM_CAPS_BEACON_REPORT_PASSIVE);
+    info->rrm_caps.bcn_rpt_active = !!(rm_cap_oct1 & IEEE80211_RRM_CAPS_BEACON_REPORT_ACTIVE);
+    info->rrm_caps.bcn_rpt_table = !!(rm_cap_oct1 & IEEE80211_RRM_CAPS_BEACON_REPORT_TABLE);
+    info->rrm_caps.lci_meas = !!(rm_cap_oct2 & IEEE80211_RRM_CAPS_LCI_MEASUREMENT);
+    info->rrm_caps.ftm_range_rpt = !!(rm_cap_oct5 & IEEE80211_RRM_CAPS_FTM_RANGE_REPORT);
+}
+
+static void bm_parse_ht_cap(void *ctx, const uint8_t *data, uint8_t len)
+{
+    bsal_client_info_t *info = ctx;
+    uint16_t ht_cap_info = bsal_ie_get_le16(&data[0]);
+    uint32_t mcs_set = bsal_ie_get_le32(&data[3]);
+    int ht_mcs_max;
+    int ht_nss_max;
+
+    if ((ht_cap_info & IEEE80211_HTCAP_C_CHWIDTH40) && (info->datarate_info.max_chwidth == 0))
+    {
+        info->datarate_info.max_chwidth = 1;  // 40 MHz
+    }
+
+    ht_mcs_max = get_ht_mcs_max(mcs_set);
+    ht_nss_max = ht_mcs_max / 8 + 1;
+
+    if (info->datarate_info.max_MCS < ht_mcs_max)
+    {
+        info->datarate_info.max_MCS = ht_mcs_max % 8;  // we always normalize to VHT
+    }
+
+    if (info->datarate_info.max_streams < ht_nss_max)
+    {
+        info->datarate_info.max_streams = ht_nss_max;
+    }
+
+    // If SMPS is set to 0 it means "Capable of SM Power Save (Static)"
+    info->datarate_info.is_static_smps =
+        (ht_cap_info & IEEE80211_HTCAP_C_SM_MASK) == 0x00 ? 1 : 0;
+}
+
+static void bm_parse_pwr_cap(void *ctx, const uint8_t *data, uint8_t len)
+{
+    bsal_client_info_t *info = ctx;
+
+    info->datarate_info.max_txpower = data[1];
+}
+
+static void bm_parse_vht_cap(void *ctx, const uint8_t *data, uint8_t len)
+{
+    bsal_client_info_t *info = ctx;
+    uint32_t vht_info = bsal_ie_get_le32(&data[0]);
+    uint16_t rx_mcs_map = bsal_ie_get_le16(&data[4]);
+    int vht_max;
+    int nss_max;
+
+    info->datarate_info.max_chwidth = 2;  // 80 MHz
+    if (vht_info & IEEE80211_VHTCAP_SHORTGI_160)
+    {
+        info->datarate_info.max_chwidth = 3;  // 160 MHz
+    }
+
+    vht_max = get_vht_mcs_max(rx_mcs_map);
+    nss_max = get_vht_nss_max(rx_mcs_map);
+
+    if (info->datarate_info.max_MCS < vht_max)
+    {
+        info->datarate_info.max_MCS = vht_max;
+    }
+    if (info->datarate_info.max_streams < nss_max)
+    {
+        info->datarate_info.max_streams = nss_max;
+    }
+
+    info->datarate_info.is_mu_mimo_supported = !!(vht_info & IEEE80211_VHTCAP_MU_BFORMEE);
+}
+
+/*
+ * HE Capabilities element body (after the Element ID Extension):
+ * HE MAC Capabilities (6), HE PHY Capabilities (11), then the
+ * Rx/Tx HE-MCS maps for <= 80 MHz (2 + 2).
+ */
+#define HE_CAP_PHY_OFFSET       6
+#define HE_CAP_MCS_OFFSET       17
+#define HE_CAP_MIN_LEN          21
+
+static void bm_parse_he_cap(void *ctx, const uint8_t *data, uint8_t len)
+{
+    bsal_client_info_t *info = ctx;
+    uint8_t phy_cap0 = data[HE_CAP_PHY_OFFSET];
+    uint16_t rx_mcs_map = bsal_ie_get_le16(&data[HE_CAP_MCS_OFFSET]);
+    int chwidth = 0;
+    int he_max;
+    int nss_max;
+
+    if (phy_cap0 & (IEEE80211_HE_PHYCAP_CHWIDTH_40_2G | IEEE80211_HE_PHYCAP_CHWIDTH_40_80_5G))
+    {
+        chwidth = 1;  // 40 MHz
+    }
+    if (phy_cap0 & IEEE80211_HE_PHYCAP_CHWIDTH_40_80_5G)
+    {
+        chwidth = 2;  // 80 MHz
+    }
+    if (phy_cap0 & IEEE80211_HE_PHYCAP_CHWIDTH_160_5G)
+    {
+        chwidth = 3;  // 160 MHz
+    }
+    if (info->datarate_info.max_chwidth < chwidth)
+    {
+        info->datarate_info.max_chwidth = chwidth;
+    }
+
+    he_max = get_he_mcs_max(rx_mcs_map);
+    nss_max = get_vht_nss_max(rx_mcs_map);
+
+    if (info->datarate_info.max_MCS < he_max)
+    {
+        info->datarate_info.max_MCS = he_max;
+    }
+    if (info->datarate_info.max_streams < nss_max)
+    {
+        info->datarate_info.max_streams = nss_max;
+    }
+}
+
+static const struct bm_ie_handler bsal_ie_handlers[] =
+{
+    { WLAN_EID_EXT_CAPAB,                   0,                              1,  bm_parse_btm_supported },
+    { WLAN_EID_RRM_ENABLED_CAPABILITIES,    0,                              5,  bm_parse_rrm_supported },
+    { WLAN_EID_HT_CAP,                      0,                              7,  bm_parse_ht_cap },
+    { WLAN_EID_VHT_CAP,                     0,                              6,  bm_parse_vht_cap },
+    { WLAN_EID_PWR_CAPABILITY,              0,                              2,  bm_parse_pwr_cap },
+    { WLAN_EID_EXTENSION,                   WLAN_EID_EXT_HE_CAPABILITIES,   HE_CAP_MIN_LEN, bm_parse_he_cap },
+};
+
+/*****************************************************************************/
+
+void bsal_parse_assoc_ies(bsal_client_info_t *info, const uint8_t *ies, size_t ies_len)
+{
+    unsigned int malformed;
+
+    // The 2.4/5G capabilities are tracked by BM based on probe request.
+    // Don't set it here. The phy_mode is also not set, as it can be calculated
+    // by the cloud if max BW, MCS and NSS are provided.
+    // Besides that, assume it is a legacy client. If capabilities are discovered,
+    // they will overwrite the below defaults. The NSS is set to '0' for legacy clients.
+    info->is_BTM_supported = 0;
+    info->is_RRM_supported = 0;
+    memset(&info->datarate_info, 0, sizeof(info->datarate_info));
+    memset(&info->rrm_caps, 0, sizeof(info->rrm_caps));
+
+    malformed = bm_ie_parse(ies, ies_len, bsal_ie_handlers,
+                            sizeof(bsal_ie_handlers) / sizeof(bsal_ie_handlers[0]), info);
+    if (malformed > 0)
+    {
+        LOGW("BSAL %u truncated element(s) skipped in association request IEs (%zu bytes)",
+             malformed, ies_len);
+    }
+}
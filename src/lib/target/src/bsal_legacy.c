@@ -30,12 +30,8 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "memutil.h"
 #include <kconfig.h>
 
-#ifdef CONFIG_RDK_HAS_ASSOC_REQ_IES
-#include <endian.h>
-#include "bm_ieee80211.h"
-#endif
-
 #include <errno.h>
+#include <pthread.h>
 
 /*****************************************************************************/
 
@@ -221,6 +217,78 @@ static void bsal_client_info_remove(const uint8_t *mac)
     FREE(client_info_cache);
 }
 
+#ifdef CONFIG_RDK_HAS_ASSOC_REQ_IES
+/*
+ * Capabilities parsed from the association request IEs, per client. The IEs
+ * only change when the client (re)associates, so they are fetched and parsed
+ * once per association. Connect and disconnect events (HAL thread) drop the
+ * entry, target_bsal_client_info() (event loop) fills it.
+ */
+#define BSAL_IE_CACHE_MAX   512
+
+typedef struct
+{
+    uint8_t             mac[BSAL_MAC_ADDR_LEN];
+    INT                 ap_index;
+    bsal_client_info_t  caps;
+    ds_tree_node_t      node;
+} bsal_ie_cache_t;
+
+static int bsal_mac_cmp(const void *a, const void *b)
+{
+    return memcmp(a, b, BSAL_MAC_ADDR_LEN);
+}
+
+static pthread_mutex_t  g_ie_cache_lock = PTHREAD_MUTEX_INITIALIZER;
+static ds_tree_t        g_ie_cache = DS_TREE_INIT(bsal_mac_cmp, bsal_ie_cache_t, node);
+static unsigned int     g_ie_cache_num;
+static unsigned int     g_ie_cache_gen;     // Bumped on every invalidation
+static uint64_t         g_ie_cache_hits;
+static uint64_t         g_ie_cache_misses;
+static uint64_t         g_ie_cache_invalidations;
+
+static void bsal_ie_cache_invalidate(const uint8_t *mac)
+{
+    bsal_ie_cache_t *entry;
+
+    pthread_mutex_lock(&g_ie_cache_lock);
+
+    g_ie_cache_gen++;
+    entry = ds_tree_find(&g_ie_cache, (void *)mac);
+    if (entry != NULL)
+    {
+        ds_tree_remove(&g_ie_cache, entry);
+        g_ie_cache_num--;
+        g_ie_cache_invalidations++;
+        FREE(entry);
+    }
+
+    pthread_mutex_unlock(&g_ie_cache_lock);
+}
+
+static void bsal_ie_cache_flush(void)
+{
+    bsal_ie_cache_t *entry;
+
+    pthread_mutex_lock(&g_ie_cache_lock);
+
+    LOGI("BSAL assoc IE cache: entries=%u hits=%llu misses=%llu invalidations=%llu",
+         g_ie_cache_num,
+         (unsigned long long)g_ie_cache_hits,
+         (unsigned long long)g_ie_cache_misses,
+         (unsigned long long)g_ie_cache_invalidations);
+
+    while ((entry = ds_tree_head(&g_ie_cache)) != NULL)
+    {
+        ds_tree_remove(&g_ie_cache, entry);
+        FREE(entry);
+    }
+    g_ie_cache_num = 0;
+
+    pthread_mutex_unlock(&g_ie_cache_lock);
+}
+#endif
+
 static void process_event(
         UINT steeringgroupIndex,
         wifi_steering_event_t *wifi_hal_event)
@@ -300,6 +368,9 @@ static void process_event(
                sizeof(bsal_event->data.connect.client_addr));
 
         bsal_client_info_update(&wifi_hal_event->data.connect);
+#ifdef CONFIG_RDK_HAS_ASSOC_REQ_IES
+        bsal_ie_cache_invalidate(wifi_hal_event->data.connect.client_mac);
+#endif
         break;
 
     case WIFI_STEERING_EVENT_CLIENT_DISCONNECT:
@@ -328,6 +399,9 @@ static void process_event(
         bsal_event->data.disconnect.reason = wifi_hal_event->data.disconnect.reason;
 
         bsal_client_info_remove(wifi_hal_event->data.disconnect.client_mac);
+#ifdef CONFIG_RDK_HAS_ASSOC_REQ_IES
+        bsal_ie_cache_invalidate(wifi_hal_event->data.disconnect.client_mac);
+#endif
         break;
 
     case WIFI_STEERING_EVENT_CLIENT_ACTIVITY:
@@ -583,6 +657,10 @@ int target_bsal_cleanup(void)
 
     _bsal_event_cb = NULL;
 
+#ifdef CONFIG_RDK_HAS_ASSOC_REQ_IES
+    bsal_ie_cache_flush();
+#endif
+
     LOGI("BSAL cleaned up");
 
     return 0;
@@ -1163,159 +1241,72 @@ error:
 }
 
 #ifdef CONFIG_RDK_HAS_ASSOC_REQ_IES
-static int get_ht_mcs_max(uint32_t mcs_set)
+/*
+ * Copy the cached capabilities of a client into info. On a miss *gen is set
+ * to the invalidation generation to pass to bsal_ie_cache_put().
+ */
+static bool bsal_ie_cache_get(INT apIndex, const uint8_t *mac_addr, bsal_client_info_t *info, unsigned int *gen)
 {
-    int i;
-
-    LOGD("HT mcs_set = %x\n", mcs_set);
-    // We don't handle mcs_set == 0. Just return 0 in that case.
-    for (i = 0; i < 32; i++)
-    {
-        // Shift right the mcs_set until no more bits
-        // are set. Amount of the shifts equals to
-        // the position of highest bit set to '1'. Position
-        // of highest '1' determines the max supported
-        // MCS. We check here only for 0-31 MCS set.
-        mcs_set = mcs_set >> 1;
-        if (mcs_set == 0) break;
-    }
-
-    return i;
-}
+    bsal_ie_cache_t *entry;
+    bool hit = false;
 
-static int get_vht_mcs_max(uint16_t rx_mcs_map)
-{
-    int i;
-    int max_mcs = 0;
+    pthread_mutex_lock(&g_ie_cache_lock);
 
-    for (i = 0; i < 8; i++)
+    entry = ds_tree_find(&g_ie_cache, (void *)mac_addr);
+    if (entry != NULL && entry->ap_index == apIndex)
     {
-        switch (rx_mcs_map & 0x03)
-        {
-            case 0x00:
-                max_mcs = max_mcs < 7 ? 7 : max_mcs;
-                break;
-            case 0x01:
-                max_mcs = max_mcs < 8 ? 8 : max_mcs;
-                break;
-            case 0x02:
-                max_mcs = max_mcs < 9 ? 9 : max_mcs;
-                break;
-            default:
-                // Not supported or invalid
-                break;
-        }
-
-        rx_mcs_map = rx_mcs_map >> 2;
+        info->is_BTM_supported = entry->caps.is_BTM_supported;
+        info->is_RRM_supported = entry->caps.is_RRM_supported;
+        info->datarate_info = entry->caps.datarate_info;
+        info->rrm_caps = entry->caps.rrm_caps;
+        memcpy(info->assoc_ies, entry->caps.assoc_ies, entry->caps.assoc_ies_len);
+        info->assoc_ies_len = entry->caps.assoc_ies_len;
+        g_ie_cache_hits++;
+        hit = true;
     }
-
-    return max_mcs;
-}
-
-static int get_vht_nss_max(uint16_t rx_mcs_map)
-{
-    int i;
-    int number_of_spatial_streams = 0;
-
-    for (i = 0; i < 8; i++)
+    else
     {
-        // Set number of spatial streams for highest found valid bit pair.
-        if ((rx_mcs_map & 0x03) != 0x03) number_of_spatial_streams = i + 1;
-        rx_mcs_map = rx_mcs_map >> 2;
+        g_ie_cache_misses++;
+        *gen = g_ie_cache_gen;
     }
 
-    return number_of_spatial_streams;
-}
+    pthread_mutex_unlock(&g_ie_cache_lock);
 
-static void bm_parse_btm_supported(bsal_client_info_t *info, uint32_t ext_caps)
-{
-    // We only check the first 4 bytes from extended capabilities
-    info->is_BTM_supported = !!(ext_caps & IEEE80211_EXTCAPIE_BSSTRANSITION);
+    return hit;
 }
 
-static void bm_parse_rrm_supported(bsal_client_info_t *info, uint8_t rm_cap_oct1,
-                                uint8_t rm_cap_oct2, uint8_t rm_cap_oct5)
+static void bsal_ie_cache_put(INT apIndex, const uint8_t *mac_addr, const bsal_client_info_t *info, unsigned int gen)
 {
-    info->is_RRM_supported = true;
-    info->rrm_caps.link_meas = !!(rm_cap_oct1 & IEEE80211_RRM_CAPS_LINK_MEASUREMENT);
-    info->rrm_caps.neigh_rpt = !!(rm_cap_oct1 & IEEE80211_RRM_CAPS_NEIGHBOR_REPORT);
-    info->rrm_caps.bcn_rpt_passive = !!(rm_cap_oct1 & IEEE80211_RRM_CAPS_BEACON_REPORT_PASSIVE);
-    info->rrm_caps.bcn_rpt_active = !!(rm_cap_oct1 & IEEE80211_RRM_CAPS_BEACON_REPORT_ACTIVE);
-    info->rrm_caps.bcn_rpt_table = !!(rm_cap_oct1 & IEEE80211_RRM_CAPS_BEACON_REPORT_TABLE);
-    info->rrm_caps.lci_meas = !!(rm_cap_oct2 & IEEE80211_RRM_CAPS_LCI_MEASUREMENT);
-    info->rrm_caps.ftm_range_rpt = !!(rm_cap_oct5 & IEEE80211_RRM_CAPS_FTM_RANGE_REPORT);
-}
-
-static void bm_parse_ht_cap(bsal_client_info_t *info, uint16_t ht_cap_info, uint32_t mcs_set)
-{
-    int ht_mcs_max;
-    int ht_nss_max;
-
-    if ((ht_cap_info & IEEE80211_HTCAP_C_CHWIDTH40) && (info->datarate_info.max_chwidth == 0))
-    {
-        info->datarate_info.max_chwidth = 1;  // 40 MHz
-    }
+    bsal_ie_cache_t *entry;
 
-    ht_mcs_max = get_ht_mcs_max(mcs_set);
-    ht_nss_max = ht_mcs_max / 8 + 1;
+    pthread_mutex_lock(&g_ie_cache_lock);
 
-    if (info->datarate_info.max_MCS < ht_mcs_max)
-    {
-        info->datarate_info.max_MCS = ht_mcs_max % 8;  // we always normalize to VHT
-    }
+    // A (dis)connect event arrived while the IEs were fetched, they may be stale
+    if (gen != g_ie_cache_gen) goto out;
 
-    if (info->datarate_info.max_streams < ht_nss_max)
+    entry = ds_tree_find(&g_ie_cache, (void *)mac_addr);
+    if (entry == NULL)
     {
-        info->datarate_info.max_streams = ht_nss_max;
-    }
-
-    // If SMPS is set to 0 it means "Capable of SM Power Save (Static)"
-    info->datarate_info.is_static_smps =
-        (ht_cap_info & IEEE80211_HTCAP_C_SM_MASK) == 0x00 ? 1 : 0;
-}
-
-static void bm_parse_pwr_cap(bsal_client_info_t *info, uint8_t max_tx_power)
-{
-    info->datarate_info.max_txpower = max_tx_power;
-}
-
-static void bm_parse_vht_cap(bsal_client_info_t *info, uint32_t vht_info, uint16_t rx_mcs_map)
-{
-    int vht_max;
-    int nss_max;
-
-    info->datarate_info.max_chwidth = 2;  // 80 MHz
-    if (vht_info & IEEE80211_VHTCAP_SHORTGI_160)
-    {
-        info->datarate_info.max_chwidth = 3;  // 160 MHz
-    }
-
-    vht_max = get_vht_mcs_max(rx_mcs_map);
-    nss_max = get_vht_nss_max(rx_mcs_map);
+        if (g_ie_cache_num >= BSAL_IE_CACHE_MAX)
+        {
+            // Disconnect events were missed, drop an arbitrary entry
+            entry = ds_tree_head(&g_ie_cache);
+            ds_tree_remove(&g_ie_cache, entry);
+            g_ie_cache_num--;
+            FREE(entry);
+        }
 
-    if (info->datarate_info.max_MCS < vht_max)
-    {
-        info->datarate_info.max_MCS = vht_max;
-    }
-    if (info->datarate_info.max_streams < nss_max)
-    {
-        info->datarate_info.max_streams = nss_max;
+        entry = CALLOC(1, sizeof(*entry));
+        memcpy(entry->mac, mac_addr, sizeof(entry->mac));
+        ds_tree_insert(&g_ie_cache, entry, entry->mac);
+        g_ie_cache_num++;
     }
 
-    info->datarate_info.is_mu_mimo_supported = !!(vht_info & IEEE80211_VHTCAP_MU_BFORMEE);
-}
+    entry->ap_index = apIndex;
+    entry->caps = *info;
 
-static void set_client_legacy(bsal_client_info_t *info)
-{
-    // The 2.4/5G capabilities are tracked by BM based on probe request.
-    // Don't set it here. The phy_mode is also not set, as it can be calculated
-    // by the cloud if max BW, MCS and NSS are provided.
-    // Besides that, assume it is a legacy client. If capabilities are discovered,
-    // they will overwrite the below defaults. The NSS is set to '0' for legacy clients.
-    info->is_BTM_supported = 0;
-    info->is_RRM_supported = 0;
-    memset(&info->datarate_info, 0, sizeof(info->datarate_info));
-    memset(&info->rrm_caps, 0, sizeof(info->rrm_caps));
+out:
+    pthread_mutex_unlock(&g_ie_cache_lock);
 }
 #endif
 
@@ -1327,10 +1318,10 @@ int target_bsal_client_info(
     const iface_t *iface = NULL;
     INT apIndex;
 #ifdef CONFIG_RDK_HAS_ASSOC_REQ_IES
-    const struct element *elem;
     INT ret;
     CHAR req_ies[1024];
     UINT req_ies_len;
+    unsigned int gen = 0;
 #endif
 
     iface = group_get_iface_by_name(ifname);
@@ -1353,6 +1344,8 @@ int target_bsal_client_info(
 #ifdef CONFIG_RDK_HAS_ASSOC_REQ_IES
     if (!info->connected) return 0;
 
+    if (bsal_ie_cache_get(apIndex, mac_addr, info, &gen)) return 0;
+
     memset(req_ies, 0, sizeof(req_ies));
     ret = wifi_getAssociationReqIEs(apIndex, (const mac_address_t *)mac_addr,
             req_ies, sizeof(req_ies), &req_ies_len);
@@ -1373,30 +1366,9 @@ int target_bsal_client_info(
     memcpy(info->assoc_ies, req_ies, req_ies_len);
     info->assoc_ies_len = req_ies_len;
 
-    set_client_legacy(info);
+    bsal_parse_assoc_ies(info, (const uint8_t *)req_ies, req_ies_len);
 
-    for_each_element(elem, req_ies, req_ies_len) {
-        switch (elem->id) {
-            case WLAN_EID_EXT_CAPAB:
-                bm_parse_btm_supported(info, le32toh(*(uint32_t *)elem->data));
-                break;
-            case WLAN_EID_RRM_ENABLED_CAPABILITIES:
-                bm_parse_rrm_supported(info, elem->data[0], elem->data[1], elem->data[4]);
-                break;
-            case WLAN_EID_HT_CAP:
-                bm_parse_ht_cap(info, le16toh(*(uint16_t *)elem->data),
-                    le32toh(*(uint32_t *)&elem->data[3]));
-                break;
-            case WLAN_EID_VHT_CAP:
-                bm_parse_vht_cap(info, le32toh(*(uint32_t *)elem->data), le16toh(*(uint16_t*)&elem->data[4]));
-                break;
-            case WLAN_EID_PWR_CAPABILITY:
-                bm_parse_pwr_cap(info, elem->data[1]);
-                break;
-            default:
-                break;
-        }
-    }
+    bsal_ie_cache_put(apIndex, mac_addr, info, gen);
 #endif
 
     return 0;
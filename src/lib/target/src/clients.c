@@ -37,7 +37,15 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #define MODULE_ID LOG_MODULE_ID_OSA
 
-#define HAL_CB_QUEUE_MAX    20
+/*
+ * HAL association events are handed over from the HAL callback thread(s) to
+ * the event loop through a preallocated lock-free ring. Producers reserve a
+ * slot with a CAS on the tail and publish it through the per-slot sequence
+ * number, the event loop is the only consumer. Neither side ever blocks, so a
+ * burst of (dis)associations cannot stall the HAL thread behind slow HAL calls
+ * made while draining.
+ */
+#define HAL_CB_RING_SIZE_MIN    16
 
 typedef struct
 {
@@ -53,21 +61,28 @@ static ds_tree_t            connected_clients;
 
 typedef struct
 {
+    size_t                  seq;
     INT                     ssid_index;
 #ifdef WIFI_HAL_VERSION_3_PHASE2
     wifi_associated_dev3_t  sta;
 #else
     wifi_associated_dev_t   sta;
 #endif
-
-    ds_dlist_node_t         node;
 } hal_cb_entry_t;
 
+typedef struct
+{
+    hal_cb_entry_t         *slots;
+    size_t                  mask;
+    size_t                  head;           // Consumer position
+    size_t                  tail;           // Producer reservation position
+    unsigned int            overflows;      // Events dropped because ring was full
+    unsigned int            high_water;     // Max observed ring occupancy
+} hal_cb_ring_t;
+
 static struct ev_loop      *hal_cb_loop = NULL;
-static pthread_mutex_t      hal_cb_lock;
 static ev_async             hal_cb_async;
-static ds_dlist_t           hal_cb_queue;
-static int                  hal_cb_queue_len = 0;
+static hal_cb_ring_t        hal_cb_ring;
 
 static struct target_radio_ops g_rops;
 
@@ -245,6 +260,99 @@ static client_t *clients_disconnection(INT apIndex, const char *mac)
     return NULL;
 }
 
+static void hal_cb_ring_init(hal_cb_ring_t *ring, size_t size)
+{
+    size_t depth = HAL_CB_RING_SIZE_MIN;
+    size_t i;
+
+    while (depth < size) depth <<= 1;
+
+    ring->slots = CALLOC(depth, sizeof(*ring->slots));
+    ring->mask = depth - 1;
+    ring->head = 0;
+    ring->tail = 0;
+    ring->overflows = 0;
+    ring->high_water = 0;
+
+    for (i = 0; i < depth; i++)
+    {
+        ring->slots[i].seq = i;
+    }
+}
+
+static hal_cb_entry_t *hal_cb_ring_reserve(hal_cb_ring_t *ring, size_t *out_pos)
+{
+    hal_cb_entry_t *slot;
+    size_t          pos;
+    size_t          seq;
+    ssize_t         diff;
+
+    pos = __atomic_load_n(&ring->tail, __ATOMIC_RELAXED);
+    for (;;)
+    {
+        slot = &ring->slots[pos & ring->mask];
+        seq = __atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE);
+        diff = (ssize_t)seq - (ssize_t)pos;
+
+        if (diff == 0)
+        {
+            if (__atomic_compare_exchange_n(&ring->tail, &pos, pos + 1, true,
+                                            __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+            {
+                *out_pos = pos;
+                return slot;
+            }
+        }
+        else if (diff < 0)
+        {
+            // Consumer hasn't released this slot yet, the ring is full
+            return NULL;
+        }
+        else
+        {
+            pos = __atomic_load_n(&ring->tail, __ATOMIC_RELAXED);
+        }
+    }
+}
+
+static void hal_cb_ring_publish(hal_cb_ring_t *ring, hal_cb_entry_t *slot, size_t pos)
+{
+    unsigned int used;
+    unsigned int hwm;
+
+    __atomic_store_n(&slot->seq, pos + 1, __ATOMIC_RELEASE);
+
+    used = (unsigned int)(pos + 1 - __atomic_load_n(&ring->head, __ATOMIC_RELAXED));
+    hwm = __atomic_load_n(&ring->high_water, __ATOMIC_RELAXED);
+    while (used > hwm)
+    {
+        if (__atomic_compare_exchange_n(&ring->high_water, &hwm, used, true,
+                                        __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+        {
+            break;
+        }
+    }
+}
+
+static bool hal_cb_ring_pop(hal_cb_ring_t *ring, hal_cb_entry_t *out)
+{
+    hal_cb_entry_t *slot;
+    size_t          pos = ring->head;
+
+    slot = &ring->slots[pos & ring->mask];
+    if (__atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE) != pos + 1)
+    {
+        return false;
+    }
+
+    memcpy(out, slot, sizeof(*out));
+
+    __atomic_store_n(&slot->seq, pos + ring->mask + 1, __ATOMIC_RELEASE);
+    __atomic_store_n(&ring->head, pos + 1, __ATOMIC_RELAXED);
+
+    return true;
+}
+
 #ifdef WIFI_HAL_VERSION_3_PHASE2
 static INT clients_hal_assocdev_cb(INT ssid_index, wifi_associated_dev3_t *sta)
 #else
@@ -252,34 +360,35 @@ static INT clients_hal_assocdev_cb(INT ssid_index, wifi_associated_dev_t *sta)
 #endif
 {
     hal_cb_entry_t      *cbe;
-    INT                 ret = RETURN_ERR;
-
-    pthread_mutex_lock(&hal_cb_lock);
+    size_t              pos;
 
-    if (hal_cb_queue_len == HAL_CB_QUEUE_MAX)
+    if (hal_cb_ring.slots == NULL)
     {
-        LOGW("clients_hal_assocdev_cb: Queue is full! Ignoring event...");
-        goto exit;
+        return RETURN_ERR;
     }
 
-    cbe = CALLOC(1, sizeof(*cbe));
-    cbe->ssid_index = ssid_index;
-    memcpy(&cbe->sta, sta, sizeof(cbe->sta));
-
-    ds_dlist_insert_tail(&hal_cb_queue, cbe);
-    hal_cb_queue_len++;
-    ret = RETURN_OK;
+    cbe = hal_cb_ring_reserve(&hal_cb_ring, &pos);
+    if (cbe == NULL)
+    {
+        // Reported from the event loop, don't log from the HAL thread
+        __atomic_add_fetch(&hal_cb_ring.overflows, 1, __ATOMIC_RELAXED);
+    }
+    else
+    {
+        cbe->ssid_index = ssid_index;
+        memcpy(&cbe->sta, sta, sizeof(cbe->sta));
+        hal_cb_ring_publish(&hal_cb_ring, cbe, pos);
+    }
 
-exit:
-    pthread_mutex_unlock(&hal_cb_lock);
-    if (ret == RETURN_OK && hal_cb_loop)
+    // Kick the loop even on overflow so that already queued events get drained
+    if (hal_cb_loop)
     {
         if (!ev_async_pending(&hal_cb_async))
         {
             ev_async_send(hal_cb_loop, &hal_cb_async);
         }
     }
-    return ret;
+    return cbe != NULL ? RETURN_OK : RETURN_ERR;
 }
 
 static INT clients_hal_dissocdev_cb(INT ssid_index, char *mac, INT event_type)
@@ -300,46 +409,63 @@ static INT clients_hal_dissocdev_cb(INT ssid_index, char *mac, INT event_type)
     return clients_hal_assocdev_cb(ssid_index, &sta);
 }
 
+static void clients_hal_ring_report(void)
+{
+    static unsigned int reported_overflows = 0;
+    static unsigned int reported_high_water = 0;
+    unsigned int        overflows;
+    unsigned int        high_water;
+
+    overflows = __atomic_load_n(&hal_cb_ring.overflows, __ATOMIC_RELAXED);
+    if (overflows != reported_overflows)
+    {
+        LOGW("%s: ring full, dropped %u events (%u total, depth %zu)", __func__,
+             overflows - reported_overflows, overflows, hal_cb_ring.mask + 1);
+        reported_overflows = overflows;
+    }
+
+    high_water = __atomic_load_n(&hal_cb_ring.high_water, __ATOMIC_RELAXED);
+    if (high_water > reported_high_water)
+    {
+        LOGI("%s: ring high-water mark %u/%zu", __func__,
+             high_water, hal_cb_ring.mask + 1);
+        reported_high_water = high_water;
+    }
+}
+
 static void clients_hal_async_cb(EV_P_ ev_async *w, int revents)
 {
-    ds_dlist_iter_t     qiter;
-    hal_cb_entry_t      *cbe;
+    hal_cb_entry_t      cbe;
     os_macaddr_t        macaddr;
     char                mac[20];
     char                ifname[256];
     client_t            *client;
 
-    pthread_mutex_lock(&hal_cb_lock);
+    clients_hal_ring_report();
 
-    cbe = ds_dlist_ifirst(&qiter, &hal_cb_queue);
-    while (cbe)
+    // Each event is copied out of the ring before processing, so the slot
+    // is released to producers before any HAL call is made.
+    while (hal_cb_ring_pop(&hal_cb_ring, &cbe))
     {
-        ds_dlist_iremove(&qiter);
-        hal_cb_queue_len--;
-
-        memcpy(&macaddr, cbe->sta.cli_MACAddress, sizeof(macaddr));
+        memcpy(&macaddr, cbe.sta.cli_MACAddress, sizeof(macaddr));
         snprintf(mac, sizeof(mac), PRI(os_macaddr_lower_t), FMT(os_macaddr_t, macaddr));
 
         memset(ifname, 0, sizeof(ifname));
-        if (wifi_getApName(cbe->ssid_index, ifname) != RETURN_OK)
+        if (wifi_getApName(cbe.ssid_index, ifname) != RETURN_OK)
         {
-            LOGE("%s: cannot get AP name for index %d", __func__, cbe->ssid_index);
-            FREE(cbe);
-            cbe = ds_dlist_inext(&qiter);
+            LOGE("%s: cannot get AP name for index %d", __func__, cbe.ssid_index);
             continue;
         }
 
-        if (cbe->sta.cli_Active)
+        if (cbe.sta.cli_Active)
         {
             if (kconfig_enabled(CONFIG_RDK_MULTI_PSK_SUPPORT))
             {
                 wifi_key_multi_psk_t key;
                 memset(&key, 0, sizeof(key));
-                if (wifi_getMultiPskClientKey(cbe->ssid_index, cbe->sta.cli_MACAddress, &key) != RETURN_OK)
+                if (wifi_getMultiPskClientKey(cbe.ssid_index, cbe.sta.cli_MACAddress, &key) != RETURN_OK)
                 {
                     LOGE("%s: cannot get key id for index %s. Skipping client", __func__, mac);
-                    FREE(cbe);
-                    cbe = ds_dlist_inext(&qiter);
                     continue;
                 }
                 else
@@ -347,22 +473,22 @@ static void clients_hal_async_cb(EV_P_ ev_async *w, int revents)
                     if (strlen(key.wifi_keyId) == 0)
                     {
                         // Empty keyid means that password is stored in config file
-                        clients_connection(cbe->ssid_index, mac, cached_key_ids[cbe->ssid_index]);
+                        clients_connection(cbe.ssid_index, mac, cached_key_ids[cbe.ssid_index]);
                     }
                     else
                     {
-                        clients_connection(cbe->ssid_index, mac, key.wifi_keyId);
+                        clients_connection(cbe.ssid_index, mac, key.wifi_keyId);
                     }
                 }
             }
             else
             {
-                clients_connection(cbe->ssid_index, mac, cached_key_ids[cbe->ssid_index]);
+                clients_connection(cbe.ssid_index, mac, cached_key_ids[cbe.ssid_index]);
             }
         }
         else
         {
-            client = clients_disconnection(cbe->ssid_index, mac);
+            client = clients_disconnection(cbe.ssid_index, mac);
             if (client)
             {
                 ds_tree_remove(&connected_clients, client);
@@ -373,12 +499,8 @@ static void clients_hal_async_cb(EV_P_ ev_async *w, int revents)
                 LOGW("%s: Disconnect untracked client %s. Skipping removal", __func__, mac);
             }
         }
-
-        FREE(cbe);
-        cbe = ds_dlist_inext(&qiter);
     }
 
-    pthread_mutex_unlock(&hal_cb_lock);
     return;
 }
 
@@ -512,12 +634,8 @@ bool clients_hal_init(const struct target_radio_ops *rops)
     }
     hal_cb_loop = wifihal_evloop;
 
-    // Init CB Queue
-    ds_dlist_init(&hal_cb_queue, hal_cb_entry_t, node);
-    hal_cb_queue_len = 0;
-
-    // Init mutex lock for queue
-    pthread_mutex_init(&hal_cb_lock, NULL);
+    // Init CB ring
+    hal_cb_ring_init(&hal_cb_ring, CONFIG_RDK_CLIENTS_HAL_CB_RING_SIZE);
 
     // Init async watcher
     ev_async_init(&hal_cb_async, clients_hal_async_cb);
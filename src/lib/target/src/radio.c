@@ -39,6 +39,7 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "os_nif.h"
 #include "memutil.h"
 #include "kconfig.h"
+#include "ds_tree.h"
 
 #ifndef __WIFI_HAL_H__
 #include <ccsp/wifi_hal.h>
@@ -49,6 +50,7 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #define CSA_TBTT                        25
 #define RESYNC_UPDATE_DELAY_SECONDS     5
+#define RESYNC_MAX_VAPS                 (MAX_NUM_RADIOS * MAX_NUM_VAP_PER_RADIO)
 
 /*****************************************************************************/
 
@@ -376,6 +378,56 @@ static ev_timer radio_resync_all_task_timer;
 static struct target_radio_ops g_rops;
 static bool g_resync_ongoing = false;
 
+/*
+ * Objects to be refreshed by the next radio_resync_all_task() run. Events
+ * mark only what they may have changed, the healthcheck marks everything.
+ */
+typedef struct
+{
+    bool        full;
+    bool        radio[MAX_NUM_RADIOS];          // Radio state and all its VIF states
+    bool        radio_vaps[MAX_NUM_RADIOS];     // Radio has at least one dirty VAP
+    bool        vif[RESYNC_MAX_VAPS];
+    bool        clients[RESYNC_MAX_VAPS];
+} radio_resync_dirty_t;
+
+typedef struct
+{
+    uint64_t    runs;
+    uint64_t    full_runs;
+    uint64_t    radios;                         // Radio states refreshed
+    uint64_t    vifs;                           // VIF states refreshed
+    uint64_t    clients;                        // Client tables refreshed
+    double      last_duration;
+    double      max_duration;
+    double      total_duration;
+} radio_resync_stats_t;
+
+static radio_resync_dirty_t g_resync_dirty;
+static radio_resync_stats_t g_resync_stats;
+
+/*
+ * Last Radio/VIF state published to the manager, keyed by if_name. A state
+ * identical to the last published one is not reported again.
+ */
+typedef struct
+{
+    char            if_name[64];
+    void           *state;
+    ds_tree_node_t  node;
+} state_shadow_t;
+
+typedef struct
+{
+    uint64_t        published;
+    uint64_t        suppressed;
+} state_shadow_stats_t;
+
+static ds_tree_t g_rstate_shadow = DS_TREE_INIT((ds_key_cmp_t *)strcmp, state_shadow_t, node);
+static ds_tree_t g_vstate_shadow = DS_TREE_INIT((ds_key_cmp_t *)strcmp, state_shadow_t, node);
+static state_shadow_stats_t g_rstate_shadow_stats;
+static state_shadow_stats_t g_vstate_shadow_stats;
+
 psk_key_id_t *cached_key_ids;
 
 bool target_radio_config_need_reset()
@@ -395,6 +447,31 @@ bool target_radio_config_need_reset()
 
 static void healthcheck_task(struct ev_loop *loop, ev_timer *watcher, int revents)
 {
+    topology_stats_t topo;
+
+    topology_stats_get(&topo);
+    LOGD("Topology cache: hits=%llu misses=%llu invalidations=%llu",
+         (unsigned long long)topo.hits,
+         (unsigned long long)topo.misses,
+         (unsigned long long)topo.invalidations);
+
+    LOGD("Re-sync: runs=%llu full=%llu radios=%llu vifs=%llu client_tables=%llu "
+         "last=%.0fms max=%.0fms total=%.0fms",
+         (unsigned long long)g_resync_stats.runs,
+         (unsigned long long)g_resync_stats.full_runs,
+         (unsigned long long)g_resync_stats.radios,
+         (unsigned long long)g_resync_stats.vifs,
+         (unsigned long long)g_resync_stats.clients,
+         g_resync_stats.last_duration * 1000,
+         g_resync_stats.max_duration * 1000,
+         g_resync_stats.total_duration * 1000);
+
+    LOGD("State updates: radio published=%llu suppressed=%llu, vif published=%llu suppressed=%llu",
+         (unsigned long long)g_rstate_shadow_stats.published,
+         (unsigned long long)g_rstate_shadow_stats.suppressed,
+         (unsigned long long)g_vstate_shadow_stats.published,
+         (unsigned long long)g_vstate_shadow_stats.suppressed);
+
     LOGI("Healthcheck re-sync");
     radio_trigger_resync();
     ev_timer_stop(wifihal_evloop, &healthcheck_timer);
@@ -852,6 +929,82 @@ static bool radio_state_get(
     return true;
 }
 
+/*
+ * Compares the state against the last published copy and stores it.
+ * Returns true if the state differs and has to be published.
+ *
+ * Both radio_state_get() and vif_state_get() zero the whole structure
+ * before filling it in, so a byte-wise comparison is sufficient.
+ */
+static bool state_shadow_update(
+        ds_tree_t *tree,
+        const char *if_name,
+        const void *state,
+        size_t size)
+{
+    state_shadow_t *shadow;
+
+    shadow = ds_tree_find(tree, (void *)if_name);
+    if (shadow != NULL)
+    {
+        if (!memcmp(shadow->state, state, size)) return false;
+        memcpy(shadow->state, state, size);
+        return true;
+    }
+
+    shadow = CALLOC(1, sizeof(*shadow));
+    STRSCPY(shadow->if_name, if_name);
+    shadow->state = CALLOC(1, size);
+    memcpy(shadow->state, state, size);
+    ds_tree_insert(tree, shadow, shadow->if_name);
+
+    return true;
+}
+
+static void state_shadow_remove(ds_tree_t *tree, const char *if_name)
+{
+    state_shadow_t *shadow;
+
+    shadow = ds_tree_find(tree, (void *)if_name);
+    if (shadow == NULL) return;
+
+    ds_tree_remove(tree, shadow);
+    FREE(shadow->state);
+    FREE(shadow);
+}
+
+static void state_shadow_clear(ds_tree_t *tree)
+{
+    state_shadow_t *shadow;
+    ds_tree_iter_t iter;
+
+    ds_tree_foreach_iter(tree, shadow, &iter)
+    {
+        ds_tree_iremove(&iter);
+        FREE(shadow->state);
+        FREE(shadow);
+    }
+}
+
+void radio_state_shadow_invalidate(const char *if_name)
+{
+    state_shadow_remove(&g_rstate_shadow, if_name);
+    state_shadow_remove(&g_vstate_shadow, if_name);
+}
+
+static void radio_rops_rstate(struct schema_Wifi_Radio_State *rstate, bool force)
+{
+    if (!state_shadow_update(&g_rstate_shadow, rstate->if_name, rstate, sizeof(*rstate)) && !force)
+    {
+        LOGT("%s: radio state unchanged, not publishing", rstate->if_name);
+        g_rstate_shadow_stats.suppressed++;
+        return;
+    }
+
+    g_rstate_shadow_stats.published++;
+    g_rops.op_rstate(rstate);
+}
+
 static bool radio_state_update(UINT radioIndex)
 {
     struct schema_Wifi_Radio_State  rstate;
@@ -863,7 +1016,7 @@ static bool radio_state_update(UINT radioIndex)
         return false;
     }
     LOGN("Updating state for radio index %d...", radioIndex);
-    g_rops.op_rstate(&rstate);
+    radio_rops_rstate(&rstate, false);
 
     return true;
 }
@@ -1073,7 +1226,7 @@ bool target_radio_config_init2()
         radio_state_get(i, &rstate);
         radio_copy_config_from_state(i, &rstate, &rconfig);
         g_rops.op_rconf(&rconfig);
-        g_rops.op_rstate(&rstate);
+        radio_rops_rstate(&rstate, true);
 
         memset(&vap_info_map, 0, sizeof(wifi_vap_info_map_t));
 
@@ -1109,7 +1262,7 @@ bool target_radio_config_init2()
             }
 
             g_rops.op_vconf(&vconfig, rconfig.if_name);
-            g_rops.op_vstate(&vstate, rstate.if_name);
+            radio_rops_vstate_force(&vstate, rstate.if_name);
         }
     }
 
@@ -1138,45 +1291,12 @@ bool target_radio_config_init2()
 
 bool radio_ifname_to_idx(const char *ifname, INT *outRadioIndex)
 {
-    INT ret;
-    ULONG r;
-    INT radio_index = -1;
-    char radio_ifname[128];
-    wifi_hal_capability_t cap;
-
-    memset(&cap, 0, sizeof(cap));
-
-    ret = wifi_getHalCapability(&cap);
-    if (ret != RETURN_OK)
-    {
-        LOGE("%s: failed to get HAL capabilities", __func__);
-        return false;
-    }
-
-    for (r = 0; r < cap.wifi_prop.numRadios; r++)
-    {
-        memset(radio_ifname, 0, sizeof(radio_ifname));
-        ret = wifi_getRadioIfName(r, radio_ifname);
-        if (ret != RETURN_OK)
-        {
-            LOGE("%s: failed to get radio ifname for idx %ld", __func__,
-                    r);
-            return false;
-        }
-        if (!strncmp(radio_ifname, ifname, sizeof(radio_ifname)))
-        {
-                radio_index = r;
-                break;
-        }
-    }
-
-    if (radio_index == -1)
+    if (!topology_radio_ifname_to_idx(ifname, outRadioIndex))
     {
         LOGE("Cannot get radio index for %s", ifname);
         return false;
     }
 
-    *outRadioIndex = radio_index;
     return true;
 }
 
@@ -1193,6 +1313,9 @@ bool target_radio_config_set2(
         return false;
     }
 
+    // Make sure the state following a config change is always reported
+    radio_state_shadow_invalidate(rconf->if_name);
+
     if (changed->enabled)
     {
         ret = wifi_setRadioEnable(radioIndex, rconf->enabled);
@@ -1219,10 +1342,54 @@ bool target_radio_config_set2(
         }
     }
 
-    radio_trigger_resync();
+    radio_trigger_resync_radio(radioIndex);
     return true;
 }
 
+static bool radio_resync_radio_needed(const radio_resync_dirty_t *dirty, ULONG radio_index)
+{
+    if (dirty->full) return true;
+    if (radio_index >= MAX_NUM_RADIOS) return false;
+    return dirty->radio[radio_index] || dirty->radio_vaps[radio_index];
+}
+
+static void radio_resync_schedule(void)
+{
+    if (!g_resync_ongoing)
+    {
+        g_resync_ongoing = true;
+        LOGI("Radio re-sync scheduled");
+        ev_timer_stop(wifihal_evloop, &radio_resync_all_task_timer);
+        ev_timer_set (&radio_resync_all_task_timer, RESYNC_UPDATE_DELAY_SECONDS, 0);
+        ev_timer_start(wifihal_evloop, &radio_resync_all_task_timer);
+    } else
+    {
+        LOGT("Radio re-sync already ongoing!");
+    }
+}
+
+/*
+ * Put back a dirty set that could not be refreshed, merged with whatever was
+ * marked meanwhile. radio_resync_all_task() schedules the retry run once it
+ * is done.
+ */
+static void radio_resync_dirty_restore(const radio_resync_dirty_t *dirty)
+{
+    int i;
+
+    g_resync_dirty.full |= dirty->full;
+    for (i = 0; i < MAX_NUM_RADIOS; i++)
+    {
+        g_resync_dirty.radio[i] |= dirty->radio[i];
+        g_resync_dirty.radio_vaps[i] |= dirty->radio_vaps[i];
+    }
+    for (i = 0; i < RESYNC_MAX_VAPS; i++)
+    {
+        g_resync_dirty.vif[i] |= dirty->vif[i];
+        g_resync_dirty.clients[i] |= dirty->clients[i];
+    }
+}
+
 static void radio_resync_all_task(struct ev_loop *loop, ev_timer *watcher, int revents)
 {
     ULONG i;
@@ -1231,10 +1398,37 @@ static void radio_resync_all_task(struct ev_loop *loop, ev_timer *watcher, int r
     wifi_vap_info_map_t vap_info_map;
     wifi_vap_index_t vap_index;
     wifi_hal_capability_t cap;
+    radio_resync_dirty_t dirty;
+    bool radio_dirty;
+    bool vif_dirty;
+    bool clients_dirty;
+    unsigned int num_radios = 0;
+    unsigned int num_vifs = 0;
+    unsigned int num_clients = 0;
+    ev_tstamp started;
+    ev_tstamp duration;
+    radio_resync_dirty_t retry;
+    bool retry_radio = false;
+    bool failed = true;
 
     memset(&cap, 0, sizeof(cap));
 
-    LOGT("Re-sync started");
+    // Take the dirty set, events arriving from now on schedule the next run
+    dirty = g_resync_dirty;
+    memset(&g_resync_dirty, 0, sizeof(g_resync_dirty));
+
+    started = ev_time();
+    LOGT("Re-sync started (%s)", dirty.full ? "full" : "partial");
+
+    /*
+     * A full run (e.g. the healthcheck) also repairs rows that were deleted
+     * or overwritten in OVSDB behind our back, so publish every state again
+     */
+    if (dirty.full)
+    {
+        state_shadow_clear(&g_rstate_shadow);
+        state_shadow_clear(&g_vstate_shadow);
+    }
 
     ret = wifi_getHalCapability(&cap);
     if (ret != RETURN_OK)
@@ -1245,10 +1439,25 @@ static void radio_resync_all_task(struct ev_loop *loop, ev_timer *watcher, int r
 
     for (i = 0; i < cap.wifi_prop.numRadios; i++)
     {
-        if (!radio_state_update(i))
+        if (!radio_resync_radio_needed(&dirty, i)) continue;
+
+        radio_dirty = dirty.full || dirty.radio[i];
+
+        if (radio_dirty)
         {
-            LOGW("Cannot update radio state for radio index %lu", i);
-            continue;
+            if (radio_state_update(i))
+            {
+                num_radios++;
+            }
+            else
+            {
+                // Retry the radio state only, its VIFs are refreshed below
+                LOGW("Cannot update radio state for radio index %lu", i);
+                memset(&retry, 0, sizeof(retry));
+                retry.radio[i] = true;
+                radio_resync_dirty_restore(&retry);
+                retry_radio = true;
+            }
         }
 
         memset(&vap_info_map, 0, sizeof(wifi_vap_info_map_t));
@@ -1263,28 +1472,64 @@ static void radio_resync_all_task(struct ev_loop *loop, ev_timer *watcher, int r
         {
             vap_index = vap_info_map.vap_array[j].vap_index;
 
+            vif_dirty = radio_dirty;
+            clients_dirty = dirty.full;
+            if (vap_index < RESYNC_MAX_VAPS)
+            {
+                vif_dirty |= dirty.vif[vap_index];
+                clients_dirty |= dirty.clients[vap_index];
+            }
+
+            if (!vif_dirty && !clients_dirty) continue;
+
             // Silentely skip VAPs that are not controlled by OpenSync
             if (!vap_controlled(vap_info_map.vap_array[j].vap_name)) continue;
 
             // Silently skip ifaces that are not enabled
             if (!vap_info_map.vap_array[j].u.bss_info.enabled) continue;
 
-            // Fetch existing clients
-            if (!clients_hal_fetch_existing(vap_index))
+            if (clients_dirty)
             {
-                LOGW("Fetching existing clients for %s failed", vap_info_map.vap_array[j].vap_name);
+                // Fetch existing clients
+                if (!clients_hal_fetch_existing(vap_index))
+                {
+                    LOGW("Fetching existing clients for %s failed", vap_info_map.vap_array[j].vap_name);
+                }
+                num_clients++;
             }
 
-            if (!vif_state_update(vap_index))
+            if (vif_dirty)
             {
-                LOGW("Cannot update VIF state for SSID index %u", vap_index);
+                if (!vif_state_update(vap_index))
+                {
+                    LOGW("Cannot update VIF state for SSID index %u", vap_index);
+                }
+                num_vifs++;
             }
         }
     }
 
+    failed = false;
+
 out:
-    LOGT("Re-sync completed");
+    if (failed) radio_resync_dirty_restore(&dirty);
+
+    duration = ev_time() - started;
+
+    g_resync_stats.runs++;
+    if (dirty.full) g_resync_stats.full_runs++;
+    g_resync_stats.radios += num_radios;
+    g_resync_stats.vifs += num_vifs;
+    g_resync_stats.clients += num_clients;
+    g_resync_stats.last_duration = duration;
+    g_resync_stats.total_duration += duration;
+    if (duration > g_resync_stats.max_duration) g_resync_stats.max_duration = duration;
+
+    LOGT("Re-sync %s (%s): radios=%u vifs=%u client_tables=%u in %.0fms",
+         failed ? "failed" : "completed", dirty.full ? "full" : "partial", num_radios, num_vifs, num_clients, duration * 1000);
     g_resync_ongoing = false;
+
+    if (failed || retry_radio) radio_resync_schedule();
 }
 
 bool target_radio_init(const struct target_radio_ops *ops)
@@ -1313,22 +1558,44 @@ bool target_radio_init(const struct target_radio_ops *ops)
 
 void radio_trigger_resync()
 {
-    if (!g_resync_ongoing)
+    g_resync_dirty.full = true;
+    radio_resync_schedule();
+}
+
+void radio_trigger_resync_radio(INT radioIndex)
+{
+    if (radioIndex < 0 || radioIndex >= MAX_NUM_RADIOS)
     {
-        g_resync_ongoing = true;
-        LOGI("Radio re-sync scheduled");
-        ev_timer_stop(wifihal_evloop, &radio_resync_all_task_timer);
-        ev_timer_set (&radio_resync_all_task_timer, RESYNC_UPDATE_DELAY_SECONDS, 0);
-        ev_timer_start(wifihal_evloop, &radio_resync_all_task_timer);
-    } else
+        radio_trigger_resync();
+        return;
+    }
+
+    g_resync_dirty.radio[radioIndex] = true;
+    radio_resync_schedule();
+}
+
+void radio_trigger_resync_vif(INT ssidIndex, bool clients)
+{
+    INT radioIndex;
+
+    if (ssidIndex < 0 || ssidIndex >= RESYNC_MAX_VAPS ||
+        !topology_ssid_index_to_radio(ssidIndex, &radioIndex, NULL) ||
+        radioIndex < 0 || radioIndex >= MAX_NUM_RADIOS)
     {
-        LOGT("Radio re-sync already ongoing!");
+        radio_trigger_resync();
+        return;
     }
+
+    g_resync_dirty.vif[ssidIndex] = true;
+    if (clients) g_resync_dirty.clients[ssidIndex] = true;
+    g_resync_dirty.radio_vaps[radioIndex] = true;
+    radio_resync_schedule();
 }
 
-bool radio_rops_vstate(
+static bool radio_rops_vstate_publish(
         struct schema_Wifi_VIF_State *vstate,
-        const char *radio_ifname)
+        const char *radio_ifname,
+        bool force)
 {
     if (!g_rops.op_vstate)
     {
@@ -1336,10 +1603,32 @@ bool radio_rops_vstate(
         return false;
     }
 
+    if (!state_shadow_update(&g_vstate_shadow, vstate->if_name, vstate, sizeof(*vstate)) && !force)
+    {
+        LOGT("%s: VIF state unchanged, not publishing", vstate->if_name);
+        g_vstate_shadow_stats.suppressed++;
+        return true;
+    }
+
+    g_vstate_shadow_stats.published++;
     g_rops.op_vstate(vstate, radio_ifname);
     return true;
 }
 
+bool radio_rops_vstate(
+        struct schema_Wifi_VIF_State *vstate,
+        const char *radio_ifname)
+{
+    return radio_rops_vstate_publish(vstate, radio_ifname, false);
+}
+
+bool radio_rops_vstate_force(
+        struct schema_Wifi_VIF_State *vstate,
+        const char *radio_ifname)
+{
+    return radio_rops_vstate_publish(vstate, radio_ifname, true);
+}
+
 bool radio_rops_vconfig(
         struct schema_Wifi_VIF_Config *vconf,
         const char *radio_ifname)
@@ -30,6 +30,7 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "os.h"
 #include "os_nif.h"
 #include "log.h"
+#include "ds_tree.h"
 #include "const.h"
 
 #include "target.h"
@@ -39,7 +40,7 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #define MODULE_ID LOG_MODULE_ID_OSA
 #define RADIO_MAX_DEVICE_QTY       3
-#define STATS_SCAN_MAX_RECORDS     300
+#define STATS_SCAN_MAX_RECORDS     8192    // Upper bound on HAL results processed per scan
 
 static struct {
     char                *phymode;
@@ -165,38 +166,7 @@ int stats_mcs_nss_bw_to_dpp_index(int mcs, int nss, int bw)
 
 static bool radio_entry_to_hal_radio_index(radio_entry_t *radio_cfg, int *radioIndex)
 {
-    INT ret;
-    ULONG r;
-    char radio_ifname[128];
-    wifi_hal_capability_t cap;
-
-    memset(&cap, 0, sizeof(cap));
-
-    ret = wifi_getHalCapability(&cap);
-    if (ret != RETURN_OK)
-    {
-        LOGE("%s: failed to get HAL capabilities", __func__);
-        return false;
-    }
-
-    *radioIndex = -1;
-    for (r = 0; r < cap.wifi_prop.numRadios; r++)
-    {
-        memset(radio_ifname, 0, sizeof(radio_ifname));
-        ret = wifi_getRadioIfName(r, radio_ifname);
-        if (ret != RETURN_OK)
-        {
-            LOGE("%s: failed to get radio ifname for idx %ld\n", __func__, r);
-            return false;
-        }
-        if (!strncmp(radio_ifname, radio_cfg->phy_name, sizeof(radio_ifname)))
-        {
-            *radioIndex = r;
-            break;
-        }
-    }
-
-    if (*radioIndex == -1)
+    if (!topology_radio_ifname_to_idx(radio_cfg->phy_name, radioIndex))
     {
         LOGE("%s: cannot find radio index for %s", __func__, radio_cfg->phy_name);
         return false;
@@ -259,14 +229,310 @@ static int auto_rssi_to_above_noise_floor(int rssi)
  *  CLIENT
  *****************************************************************************/
 
+/*
+ * Client records are handed over to SM, which keeps them across polls and
+ * returns them through target_client_record_free(). They are carved out of
+ * slabs and recycled through a free list, so that steady state polling
+ * does not allocate.
+ */
+#define STATS_CLIENT_SLAB_RECORDS   32
+
+typedef union stats_client_slot
+{
+    stats_client_record_t           record;
+    union stats_client_slot        *next_free;
+} stats_client_slot_t;
+
+typedef struct stats_client_slab
+{
+    struct stats_client_slab       *next;
+    stats_client_slot_t             slots[STATS_CLIENT_SLAB_RECORDS];
+} stats_client_slab_t;
+
+typedef struct
+{
+    stats_client_slab_t            *slabs;
+    stats_client_slot_t            *free;
+    unsigned int                    slabs_num;
+    unsigned int                    in_use;
+    unsigned int                    in_use_max;
+    uint64_t                        allocs;         // Records handed out
+    uint64_t                        frees;          // Records returned
+} stats_client_pool_t;
+
+static stats_client_pool_t g_client_pool;
+
 static void stats_client_record_free(stats_client_record_t *client_entry)
 {
-    FREE(client_entry);
+    stats_client_slot_t *slot = (stats_client_slot_t *)client_entry;
+
+    if (client_entry == NULL) return;
+
+    slot->next_free = g_client_pool.free;
+    g_client_pool.free = slot;
+    g_client_pool.in_use--;
+    g_client_pool.frees++;
 }
 
 static stats_client_record_t* stats_client_record_alloc()
 {
-    return CALLOC(1, sizeof(stats_client_record_t));
+    stats_client_slab_t *slab;
+    stats_client_slot_t *slot;
+    int i;
+
+    if (g_client_pool.free == NULL)
+    {
+        slab = CALLOC(1, sizeof(*slab));
+        for (i = STATS_CLIENT_SLAB_RECORDS - 1; i >= 0; i--)
+        {
+            slab->slots[i].next_free = g_client_pool.free;
+            g_client_pool.free = &slab->slots[i];
+        }
+        slab->next = g_client_pool.slabs;
+        g_client_pool.slabs = slab;
+        g_client_pool.slabs_num++;
+
+        LOGD("Client record pool grown to %u records",
+             g_client_pool.slabs_num * STATS_CLIENT_SLAB_RECORDS);
+    }
+
+    slot = g_client_pool.free;
+    g_client_pool.free = slot->next_free;
+
+    g_client_pool.allocs++;
+    g_client_pool.in_use++;
+    if (g_client_pool.in_use > g_client_pool.in_use_max)
+    {
+        g_client_pool.in_use_max = g_client_pool.in_use;
+    }
+
+    memset(&slot->record, 0, sizeof(slot->record));
+    return &slot->record;
+}
+
+/*
+ * The associated device list fetched for every VAP carries the client byte,
+ * frame, tx retry and tx error counters as well, so they can be taken from
+ * there instead of calling wifi_getApAssociatedDeviceStats() once per client.
+ * Not every HAL fills them in, so the first busy client is fetched both ways
+ * and the per-client call is kept if the list comes back empty. The list has
+ * no rx retry and rx error counters, those are not reported in bulk mode.
+ *
+ * The list counters are ULONG, which can wrap more than once between two
+ * polls at gigabit rates where it is 32 bits wide, so such targets always
+ * use the per-client call and its 64-bit counters.
+ */
+typedef enum
+{
+    STATS_CLIENT_MODE_PROBE = 0,
+    STATS_CLIENT_MODE_BULK,
+    STATS_CLIENT_MODE_PER_CLIENT,
+} stats_client_mode_t;
+
+static stats_client_mode_t g_client_stats_mode = STATS_CLIENT_MODE_PROBE;
+
+/*
+ * Bulk mode has no per-connection handle, so connections are told apart by
+ * polling: a client that was not listed on its VAP in the previous poll gets
+ * a new connection id. The HAL association callbacks are registered by WM
+ * only and are not available to the stats code.
+ */
+#define STATS_CLIENT_CONN_VAPS      (MAX_NUM_RADIOS * MAX_NUM_VAP_PER_RADIO)
+
+typedef struct
+{
+    mac_address_t                   mac;
+    ULLONG                          conn_id;
+    unsigned int                    poll;           // Last poll listing the client
+    ds_tree_node_t                  node;
+} stats_client_conn_t;
+
+typedef struct
+{
+    ds_tree_t                       conns;
+    unsigned int                    poll;
+    bool                            init;
+} stats_client_vap_conns_t;
+
+static stats_client_vap_conns_t g_client_conns[STATS_CLIENT_CONN_VAPS];
+static ULLONG g_client_conn_seq;
+
+/*
+ * Width of the driver counters behind the HAL client stats, per field. Set
+ * by CONFIG_RDK_CLIENT_STATS_COUNTER_BITS, or learned by stats_counter_delta()
+ * while unknown.
+ */
+#if CONFIG_RDK_CLIENT_STATS_COUNTER_BITS == 64
+#define STATS_CLIENT_COUNTER_WIDTH  STATS_COUNTER_64
+#elif CONFIG_RDK_CLIENT_STATS_COUNTER_BITS == 32
+#define STATS_CLIENT_COUNTER_WIDTH  STATS_COUNTER_32
+#else
+#define STATS_CLIENT_COUNTER_WIDTH  STATS_COUNTER_AUTO
+#endif
+
+static struct
+{
+    stats_counter_width_t           cli_tx_bytes;
+    stats_counter_width_t           cli_rx_bytes;
+    stats_counter_width_t           cli_tx_frames;
+    stats_counter_width_t           cli_rx_frames;
+    stats_counter_width_t           cli_tx_retries;
+    stats_counter_width_t           cli_rx_retries;
+    stats_counter_width_t           cli_tx_errors;
+    stats_counter_width_t           cli_rx_errors;
+} g_client_counter_width =
+{
+    .cli_tx_bytes   = STATS_CLIENT_COUNTER_WIDTH,
+    .cli_rx_bytes   = STATS_CLIENT_COUNTER_WIDTH,
+    .cli_tx_frames  = STATS_CLIENT_COUNTER_WIDTH,
+    .cli_rx_frames  = STATS_CLIENT_COUNTER_WIDTH,
+    .cli_tx_retries = STATS_CLIENT_COUNTER_WIDTH,
+    .cli_rx_retries = STATS_CLIENT_COUNTER_WIDTH,
+    .cli_tx_errors  = STATS_CLIENT_COUNTER_WIDTH,
+    .cli_rx_errors  = STATS_CLIENT_COUNTER_WIDTH,
+};
+
+static const char *stats_client_mode_str(stats_client_mode_t mode)
+{
+    switch (mode)
+    {
+        case STATS_CLIENT_MODE_BULK:        return "bulk";
+        case STATS_CLIENT_MODE_PER_CLIENT:  return "per-client";
+        default:                            return "probe";
+    }
+}
+
+static void stats_client_mode_probe(int apIndex, wifi_associated_dev3_t *assoc_dev)
+{
+    wifi_associated_dev_stats_t stats;
+    mac_address_str_t mac_str;
+    ULLONG handle = 0;
+    int ret;
+
+    if (sizeof(ULONG) < sizeof(uint64_t))
+    {
+        g_client_stats_mode = STATS_CLIENT_MODE_PER_CLIENT;
+        LOGI("Client stats: 32-bit associated device list counters, using %s mode",
+             stats_client_mode_str(g_client_stats_mode));
+        return;
+    }
+
+    dpp_mac_to_str(assoc_dev->cli_MACAddress, mac_str);
+
+    memset(&stats, 0, sizeof(stats));
+    ret = wifi_getApAssociatedDeviceStats(apIndex, &assoc_dev->cli_MACAddress, &stats, &handle);
+    if (ret != RETURN_OK)
+    {
+        // Nothing to compare the list against, probe again on the next poll
+        LOGD("Client stats: wifi_getApAssociatedDeviceStats() failed for %s, still probing", mac_str);
+        return;
+    }
+
+    if (stats.cli_tx_frames == 0 && stats.cli_rx_frames == 0)
+    {
+        // Idle client, nothing to compare against yet
+        return;
+    }
+
+    if (assoc_dev->cli_PacketsSent == 0 && assoc_dev->cli_PacketsReceived == 0)
+    {
+        g_client_stats_mode = STATS_CLIENT_MODE_PER_CLIENT;
+    }
+    else
+    {
+        g_client_stats_mode = STATS_CLIENT_MODE_BULK;
+    }
+
+    LOGI("Client stats: probed %s on apIndex %d, using %s mode",
+         mac_str, apIndex, stats_client_mode_str(g_client_stats_mode));
+}
+
+static int stats_client_mac_cmp(const void *a, const void *b)
+{
+    return memcmp(a, b, sizeof(mac_address_t));
+}
+
+static void stats_client_conn_poll_begin(int apIndex)
+{
+    stats_client_vap_conns_t *vap;
+
+    if (apIndex < 0 || apIndex >= STATS_CLIENT_CONN_VAPS) return;
+
+    vap = &g_client_conns[apIndex];
+    if (!vap->init)
+    {
+        ds_tree_init(&vap->conns, stats_client_mac_cmp, stats_client_conn_t, node);
+        vap->init = true;
+    }
+    vap->poll++;
+}
+
+/*
+ * Drop the clients that were not listed in this poll, so that they get a
+ * new connection id when they show up again.
+ */
+static void stats_client_conn_poll_end(int apIndex)
+{
+    stats_client_vap_conns_t *vap;
+    stats_client_conn_t *conn;
+    ds_tree_iter_t iter;
+
+    if (apIndex < 0 || apIndex >= STATS_CLIENT_CONN_VAPS) return;
+
+    vap = &g_client_conns[apIndex];
+    ds_tree_foreach_iter(&vap->conns, conn, &iter)
+    {
+        if (conn->poll == vap->poll) continue;
+        ds_tree_iremove(&iter);
+        FREE(conn);
+    }
+}
+
+static ULLONG stats_client_conn_id(int apIndex, mac_address_t mac)
+{
+    stats_client_vap_conns_t *vap;
+    stats_client_conn_t *conn;
+
+    if (apIndex < 0 || apIndex >= STATS_CLIENT_CONN_VAPS) return 0;
+
+    vap = &g_client_conns[apIndex];
+    conn = ds_tree_find(&vap->conns, mac);
+    if (conn == NULL)
+    {
+        conn = CALLOC(1, sizeof(*conn));
+        memcpy(conn->mac, mac, sizeof(conn->mac));
+        conn->conn_id = ++g_client_conn_seq;
+        ds_tree_insert(&vap->conns, conn, conn->mac);
+    }
+    conn->poll = vap->poll;
+
+    return conn->conn_id;
+}
+
+static void stats_client_bulk_fill(
+        stats_client_record_t      *client_entry,
+        int                         apIndex,
+        wifi_associated_dev3_t     *assoc_dev)
+{
+    wifi_associated_dev_stats_t *stats = &client_entry->stats;
+
+    stats->cli_tx_bytes   = assoc_dev->cli_BytesSent;
+    stats->cli_rx_bytes   = assoc_dev->cli_BytesReceived;
+    stats->cli_tx_frames  = assoc_dev->cli_PacketsSent;
+    stats->cli_rx_frames  = assoc_dev->cli_PacketsReceived;
+    stats->cli_tx_retries = assoc_dev->cli_RetransCount;
+    stats->cli_tx_errors  = assoc_dev->cli_ErrorsSent;
+    client_entry->rx_counters_na = true;
+    // Last data rates are reported in kbps
+    stats->cli_tx_rate    = assoc_dev->cli_LastDataDownlinkRate / 1000.0;
+    stats->cli_rx_rate    = assoc_dev->cli_LastDataUplinkRate / 1000.0;
+
+    /*
+     * There is no per-connection handle without the per-client call. A
+     * reconnect that falls between two polls keeps the connection id and
+     * is left to stats_counter_delta() to detect as a reset.
+     */
+    client_entry->stats_cookie = stats_client_conn_id(apIndex, assoc_dev->cli_MACAddress);
 }
 
 static bool stats_client_fetch(
@@ -276,7 +542,8 @@ static bool stats_client_fetch(
         int                         radioIndex,
         int                         apIndex,
         char                       *apName,
-        wifi_associated_dev3_t     *assoc_dev)
+        wifi_associated_dev3_t     *assoc_dev,
+        unsigned int               *hal_calls)
 {
     stats_client_record_t *client_entry = NULL;
     mac_address_str_t mac_str;
@@ -293,8 +560,15 @@ static bool stats_client_fetch(
     dpp_mac_to_str(assoc_dev->cli_MACAddress, mac_str);
 
     // STATS
-    memcpy(&client_entry->dev3, assoc_dev, sizeof(client_entry->dev3));
+    client_entry->snr = assoc_dev->cli_SNR;
 
+    if (g_client_stats_mode == STATS_CLIENT_MODE_BULK)
+    {
+        stats_client_bulk_fill(client_entry, apIndex, assoc_dev);
+        goto out;
+    }
+
+    (*hal_calls)++;
     ret = wifi_getApAssociatedDeviceStats(
             apIndex,
             &assoc_dev->cli_MACAddress,
@@ -328,9 +602,18 @@ bool stats_clients_get(
     ULONG s;
     wifi_vap_info_map_t map;
     wifi_vap_info_t *vap_info;
+    unsigned int hal_calls = 0;
+    unsigned int clients = 0;
+    uint64_t start_ms = get_timestamp();
+    bool bulk;
 
     memset(&map, 0, sizeof(wifi_vap_info_map_t));
 
+    if (!kconfig_enabled(CONFIG_RDK_CLIENTS_STATS_BULK))
+    {
+        g_client_stats_mode = STATS_CLIENT_MODE_PER_CLIENT;
+    }
+
     if (!radio_entry_to_hal_radio_index(radio_cfg, &radio_index))
     {
         LOGE("%s: radio not found: %s", __func__, radio_cfg->phy_name);
@@ -366,6 +649,7 @@ bool stats_clients_get(
 
         client_array = NULL;
         client_num = 0;
+        hal_calls++;
         ret = wifi_getApAssociatedDeviceDiagnosticResult3(vap_info->vap_index, &client_array, &client_num);
         if (ret != RETURN_OK)
         {
@@ -377,16 +661,37 @@ bool stats_clients_get(
         LOGT("%s %s %u %s: fetch client list: %d clients",
              radio_cfg->phy_name, vap_info->vap_name, vap_info->vap_index, vap_info->u.bss_info.ssid, client_num);
 
+        if (client_num > 0 && g_client_stats_mode == STATS_CLIENT_MODE_PROBE)
+        {
+            hal_calls++;
+            stats_client_mode_probe(vap_info->vap_index, &client_array[0]);
+        }
+
+        bulk = (g_client_stats_mode == STATS_CLIENT_MODE_BULK);
+        if (bulk) stats_client_conn_poll_begin(vap_info->vap_index);
+
         for (i = 0; i < (int)client_num; i++)
         {
             stats_client_fetch(
                     radio_cfg, vap_info->u.bss_info.ssid, client_list,
-                    radio_index, vap_info->vap_index, vap_info->vap_name, &client_array[i]);
+                    radio_index, vap_info->vap_index, vap_info->vap_name, &client_array[i],
+                    &hal_calls);
         }
+        clients += client_num;
+
+        if (bulk) stats_client_conn_poll_end(vap_info->vap_index);
 
         free(client_array);
     }
 
+    LOGT("%s: client stats: %s mode, %u clients, %u HAL calls, %llu ms",
+         radio_cfg->phy_name, stats_client_mode_str(g_client_stats_mode), clients, hal_calls,
+         (unsigned long long)(get_timestamp() - start_ms));
+
+    LOGT("Client record pool: slabs=%u in_use=%u in_use_max=%u allocs=%llu frees=%llu",
+         g_client_pool.slabs_num, g_client_pool.in_use, g_client_pool.in_use_max,
+         (unsigned long long)g_client_pool.allocs, (unsigned long long)g_client_pool.frees);
+
     return true;
 }
 
@@ -397,6 +702,9 @@ bool stats_clients_convert(
         dpp_client_record_t       *client_result)
 {
     mac_address_str_t mac_str;
+    stats_delta_stats_t delta_stats;
+    int anomalies = 0;
+
     dpp_mac_to_str(data_new->info.mac, mac_str);
 
     /*LOG(TRACE,"%s %s n:%p %p %p o:%p %p %p r:%p", __FUNCTION__, mac_str,
@@ -404,25 +712,15 @@ bool stats_clients_convert(
             data_old, data_old->stats_tx, data_old->stats_rx,
             client_result);*/
 
-#define CALC_DELTA_32(A,B) ((uint32_t)(A) - (uint32_t)(B))
-
-#define GET_DELTA(Y) CALC_DELTA_32(data_new->Y, data_old->Y)
-
-#define ADD_DELTA(X,Y) ADD_DELTA_TO(client_result, X, Y)
-
-#define ADD_DELTA_TO(A,X,Y) \
+#define ADD_DELTA(X,Y) \
     do { \
-        if (data_old->Y > data_new->Y) { \
-            LOGI("Inconsistent data from driver for %s: %lld > %lld. Skipping.",\
-                                                    #Y, data_old->Y, data_new->Y); \
-            data_old->Y = 0; \
-            data_new->Y = 0; \
+        uint64_t _delta; \
+        if (stats_counter_delta(data_old->stats.Y, data_new->stats.Y, \
+                                &g_client_counter_width.Y, &_delta) != STATS_DELTA_OK) \
+        { \
+            anomalies++; \
         } \
-        A->X = GET_DELTA(Y); \
-        LOG(TRACE, "Client %s stats %s=%llu (delta  %llu - %llu = %llu)", \
-                mac_str, #X, (unsigned long long)A->X, \
-                (unsigned long long)data_new->Y, (unsigned long long)data_old->Y, \
-                (unsigned long long)GET_DELTA(Y)); \
+        client_result->X = _delta; \
     } while (0)
 
 
@@ -455,19 +753,40 @@ bool stats_clients_convert(
         // whatever the driver reported with the last stat reading.
         LOGD("New connection - clear old stat records");
         memset(&data_old->stats, 0, sizeof(data_old->stats));
-        memset(&data_old->dev3, 0, sizeof(data_old->dev3));
+        data_old->snr = 0;
+        stats_counter_reinit();
+    }
+
+    ADD_DELTA(stats.bytes_tx,   cli_tx_bytes);
+    ADD_DELTA(stats.bytes_rx,   cli_rx_bytes);
+    ADD_DELTA(stats.frames_tx,  cli_tx_frames);
+    ADD_DELTA(stats.frames_rx,  cli_rx_frames);
+    ADD_DELTA(stats.retries_tx, cli_tx_retries);
+    ADD_DELTA(stats.errors_tx,  cli_tx_errors);
+    if (!data_new->rx_counters_na)
+    {
+        ADD_DELTA(stats.retries_rx, cli_rx_retries);
+        ADD_DELTA(stats.errors_rx,  cli_rx_errors);
     }
 
-    ADD_DELTA(stats.bytes_tx,   stats.cli_tx_bytes);
-    ADD_DELTA(stats.bytes_rx,   stats.cli_rx_bytes);
-    ADD_DELTA(stats.frames_tx,  stats.cli_tx_frames);
-    ADD_DELTA(stats.frames_rx,  stats.cli_rx_frames);
-    ADD_DELTA(stats.retries_tx, stats.cli_tx_retries);
-    ADD_DELTA(stats.retries_rx, stats.cli_rx_retries);
-    ADD_DELTA(stats.errors_tx,  stats.cli_tx_errors);
-    ADD_DELTA(stats.errors_rx,  stats.cli_rx_errors);
+    if (anomalies > 0)
+    {
+        stats_delta_stats_get(&delta_stats);
+        LOGD("Client %s: %d counters wrapped or restarted (total wraps=%llu resets=%llu reinits=%llu)",
+             mac_str, anomalies,
+             (unsigned long long)delta_stats.wraps,
+             (unsigned long long)delta_stats.resets,
+             (unsigned long long)delta_stats.reinits);
+    }
+
+    LOGT("Client %s stats bytes_tx=%llu bytes_rx=%llu frames_tx=%llu frames_rx=%llu",
+         mac_str,
+         (unsigned long long)client_result->stats.bytes_tx,
+         (unsigned long long)client_result->stats.bytes_rx,
+         (unsigned long long)client_result->stats.frames_tx,
+         (unsigned long long)client_result->stats.frames_rx);
 
-    client_result->stats.rssi = data_new->dev3.cli_SNR;
+    client_result->stats.rssi = data_new->snr;
     LOG(TRACE, "Client %s stats %s=%d", mac_str, "stats.rssi", client_result->stats.rssi);
 
     /* 11ax compatible HAL implementation should provide an average tx/rx rates [mbps] that
@@ -525,7 +844,7 @@ bool stats_survey_get(
         if (scan_type == RADIO_SCAN_TYPE_ONCHAN)
         {
             survey_record->info.chan = chan_list[i];
-            survey_record->info.timestamp_ms = get_timestamp();
+            survey_record->info.timestamp_ms = survey_data.timestamp_ms;
 
             survey_record->stats.survey_bss.chan_active   = survey_data.chan[i].ch_utilization_total;
             survey_record->stats.survey_bss.chan_busy     = survey_data.chan[i].ch_utilization_busy;
@@ -551,7 +870,7 @@ bool stats_survey_get(
         else
         {
             survey_record->info.chan = chan_list[i];
-            survey_record->info.timestamp_ms = get_timestamp();
+            survey_record->info.timestamp_ms = survey_data.timestamp_ms;
 
             survey_record->stats.survey_obss.chan_active   = (uint32_t)survey_data.chan[i].ch_utilization_total;
             survey_record->stats.survey_obss.chan_busy     = (uint32_t)survey_data.chan[i].ch_utilization_busy;
@@ -767,63 +1086,210 @@ static bool stats_scan_initiate(
  *  SCAN
  *****************************************************************************/
 
+/*
+ * Scans are scheduled per radio. Each radio has its own context with one
+ * active request and queues of pending ones, so independent radios scan
+ * concurrently while requests for a busy radio wait their turn, on-channel
+ * first, then off-channel, then full scans.
+ *
+ * The HAL does not signal scan completion. Results are polled, starting
+ * once the requested dwell time has elapsed and backing off exponentially
+ * up to STATS_SCAN_POLL_MAX, until STATS_SCAN_TIMEOUT.
+ */
+typedef enum
+{
+    STATS_SCAN_PRIO_ONCHAN = 0,
+    STATS_SCAN_PRIO_OFFCHAN,
+    STATS_SCAN_PRIO_FULL,
+    STATS_SCAN_PRIO_QTY
+} stats_scan_prio_t;
+
 typedef struct
 {
     radio_entry_t                  *radio_cfg;
     radio_scan_type_t               scan_type;
+    uint32_t                       *chan_list;
+    uint32_t                        chan_num;
+    int32_t                         dwell_time;
     stats_scan_cb_t                *scan_cb;
     void                           *scan_ctx;
+    ev_tstamp                       queued_at;
+    ev_tstamp                       started_at;
+    ds_dlist_node_t                 node;
 } stats_scan_request_t;
 
-#define STATS_SCAN_RESULT_POLL_TIME       0.2
+typedef struct
+{
+    bool                            initialized;
+    int                             radio_index;
+    ev_timer                        timer;
+    ev_tstamp                       poll_interval;
+    ev_tstamp                       deadline;
+    unsigned int                    polls;
+    stats_scan_request_t           *active;
+    ds_dlist_t                      queue[STATS_SCAN_PRIO_QTY];
+    wifi_neighbor_ap2_t            *results;
+    uint32_t                        results_size;
+} stats_scan_ctx_t;
+
+#define STATS_SCAN_POLL_MIN         0.1
+#define STATS_SCAN_POLL_MAX         2.0
 // Need to wait 20s for FULL chan results
-#define STATS_SCAN_RESULT_POLL_TIMEOUT    100  // 100 * 0.2 = 20 sec
+#define STATS_SCAN_TIMEOUT          20.0
 
-static wifi_neighbor_ap2_t* g_scan_results = NULL;
-static uint32_t             g_scan_results_size;
-static ev_timer             g_scan_result_timer;
-static int32_t              g_scan_result_timeout;
+static stats_scan_ctx_t g_scan_ctx[MAX_NUM_RADIOS];
 
-static void stats_scan_result_timer_set(
-        ev_timer                   *timer,
-        bool                        enable)
+static void stats_scan_results_fetch(EV_P_ ev_timer *w, int revents);
+
+static stats_scan_prio_t stats_scan_prio(radio_scan_type_t scan_type)
 {
-    if (enable)
+    switch (scan_type)
     {
-        ev_timer_again(EV_DEFAULT, timer);
+        case RADIO_SCAN_TYPE_ONCHAN:    return STATS_SCAN_PRIO_ONCHAN;
+        case RADIO_SCAN_TYPE_OFFCHAN:   return STATS_SCAN_PRIO_OFFCHAN;
+        default:                        return STATS_SCAN_PRIO_FULL;
     }
-    else
+}
+
+static stats_scan_ctx_t *stats_scan_ctx_get(radio_entry_t *radio_cfg)
+{
+    stats_scan_ctx_t *ctx;
+    int radio_index;
+    int i;
+
+    if (!radio_entry_to_hal_radio_index(radio_cfg, &radio_index) ||
+        radio_index < 0 || radio_index >= MAX_NUM_RADIOS)
+    {
+        return NULL;
+    }
+
+    ctx = &g_scan_ctx[radio_index];
+    if (!ctx->initialized)
+    {
+        ctx->radio_index = radio_index;
+        for (i = 0; i < STATS_SCAN_PRIO_QTY; i++)
+        {
+            ds_dlist_init(&ctx->queue[i], stats_scan_request_t, node);
+        }
+        ev_init(&ctx->timer, stats_scan_results_fetch);
+        ctx->timer.data = ctx;
+        ctx->initialized = true;
+    }
+
+    return ctx;
+}
+
+static void stats_scan_request_free(stats_scan_request_t *request)
+{
+    FREE(request->chan_list);
+    FREE(request);
+}
+
+static bool stats_scan_request_start(stats_scan_ctx_t *ctx, stats_scan_request_t *request)
+{
+    radio_entry_t *radio_cfg = request->radio_cfg;
+    ev_tstamp first_poll;
+
+    if (!stats_scan_initiate(
+                radio_cfg,
+                request->chan_list,
+                request->chan_num,
+                request->scan_type,
+                request->dwell_time))
+    {
+        return false;
+    }
+
+    request->started_at = ev_now(EV_DEFAULT);
+    ctx->active = request;
+    ctx->polls = 0;
+    ctx->deadline = request->started_at + STATS_SCAN_TIMEOUT;
+
+    // Results cannot be complete before every channel was dwelled on
+    first_poll = (request->dwell_time * request->chan_num) / 1000.0;
+    if (first_poll < STATS_SCAN_POLL_MIN) first_poll = STATS_SCAN_POLL_MIN;
+    if (first_poll > STATS_SCAN_TIMEOUT) first_poll = STATS_SCAN_TIMEOUT;
+    ctx->poll_interval = STATS_SCAN_POLL_MIN;
+
+    ev_timer_set(&ctx->timer, first_poll, 0.);
+    ev_timer_start(EV_DEFAULT, &ctx->timer);
+    return true;
+}
+
+static void stats_scan_dispatch(stats_scan_ctx_t *ctx)
+{
+    stats_scan_request_t *request;
+    int i;
+
+    while (ctx->active == NULL)
+    {
+        request = NULL;
+        for (i = 0; i < STATS_SCAN_PRIO_QTY && request == NULL; i++)
+        {
+            request = ds_dlist_remove_head(&ctx->queue[i]);
+        }
+        if (request == NULL) return;
+
+        if (stats_scan_request_start(ctx, request)) return;
+
+        LOG(ERR,
+                "Failed to start queued %s %s scan",
+                radio_get_name_from_type(request->radio_cfg->type),
+                radio_get_scan_name_from_type(request->scan_type));
+
+        if (request->scan_cb)
+        {
+            request->scan_cb(request->scan_ctx, false);
+        }
+        stats_scan_request_free(request);
+    }
+}
+
+static void stats_scan_request_done(stats_scan_ctx_t *ctx, bool scan_status)
+{
+    stats_scan_request_t *request = ctx->active;
+    ev_tstamp now = ev_now(EV_DEFAULT);
+
+    ev_timer_stop(EV_DEFAULT, &ctx->timer);
+    ctx->active = NULL;
+
+    LOGD("Scan %s %s %s: queued %.0f ms, scanned %.0f ms, %u polls",
+         radio_get_name_from_type(request->radio_cfg->type),
+         radio_get_scan_name_from_type(request->scan_type),
+         scan_status ? "completed" : "failed",
+         (request->started_at - request->queued_at) * 1000,
+         (now - request->started_at) * 1000,
+         ctx->polls);
+
+    // Notify upper layer about scan status (blocking)
+    if (request->scan_cb)
     {
-        ev_timer_stop(EV_DEFAULT, timer);
+        request->scan_cb(request->scan_ctx, scan_status);
     }
+    stats_scan_request_free(request);
+
+    stats_scan_dispatch(ctx);
 }
 
 static void stats_scan_results_fetch(EV_P_ ev_timer *w, int revents)
 {
-    int                          scan_status = false;
-    stats_scan_request_t         *request_ctx = (stats_scan_request_t *) w->data;
+    stats_scan_ctx_t             *ctx = (stats_scan_ctx_t *) w->data;
+    stats_scan_request_t         *request_ctx = ctx->active;
     radio_entry_t                *radio_cfg = request_ctx->radio_cfg;
     radio_type_t                 radio_type = radio_cfg->type;
     radio_scan_type_t            scan_type = request_ctx->scan_type;
-    int radio_index;
     bool ret;
 
-    // The driver scans and adds results to the buffer specified.
-    // Since we do no know when scanning is finished, we need to poll for info.
-    // We poll in steps of 250ms. Max waiting time is 5s.
-
-    if (!radio_entry_to_hal_radio_index(radio_cfg, &radio_index))
-    {
-        goto exit;
-    }
+    ctx->polls++;
 
-    free(g_scan_results);
-    g_scan_results = NULL;
+    free(ctx->results);
+    ctx->results = NULL;
+    ctx->results_size = 0;
 
 #ifdef WIFI_HAL_VERSION_3_PHASE2
-    ret = wifi_getNeighboringWiFiStatus(radio_index, false, &g_scan_results, &g_scan_results_size);
+    ret = wifi_getNeighboringWiFiStatus(ctx->radio_index, false, &ctx->results, &ctx->results_size);
 #else
-    ret = wifi_getNeighboringWiFiStatus(radio_index, &g_scan_results, &g_scan_results_size);
+    ret = wifi_getNeighboringWiFiStatus(ctx->radio_index, &ctx->results, &ctx->results_size);
 #endif
     if (ret != RETURN_OK)
     {
@@ -835,9 +1301,16 @@ static void stats_scan_results_fetch(EV_P_ ev_timer *w, int revents)
                     radio_get_name_from_type(radio_type),
                     radio_get_scan_name_from_type(scan_type));
 
-            if (--g_scan_result_timeout > 0)
+            if (ev_now(EV_A) < ctx->deadline)
             {
-                goto restart_timer;
+                ev_timer_set(w, ctx->poll_interval, 0.);
+                ev_timer_start(EV_A, w);
+                ctx->poll_interval *= 2;
+                if (ctx->poll_interval > STATS_SCAN_POLL_MAX)
+                {
+                    ctx->poll_interval = STATS_SCAN_POLL_MAX;
+                }
+                return;
             }
 
             LOG(ERR,
@@ -866,22 +1339,11 @@ static void stats_scan_results_fetch(EV_P_ ev_timer *w, int revents)
         goto exit;
     }
 
-    // Mark results scan_status
-    scan_status = true;
+    stats_scan_request_done(ctx, true);
+    return;
 
 exit:
-    stats_scan_result_timer_set(w, false);
-    g_scan_result_timeout = STATS_SCAN_RESULT_POLL_TIMEOUT;
-
-clean:
-    // Notify upper layer about scan status (blocking)
-    if (request_ctx->scan_cb)
-    {
-        request_ctx->scan_cb(request_ctx->scan_ctx, scan_status);
-    }
-
-restart_timer:
-    return;
+    stats_scan_request_done(ctx, false);
 }
 
 bool stats_scan_start(
@@ -893,30 +1355,41 @@ bool stats_scan_start(
         stats_scan_cb_t            *scan_cb,
         void                       *scan_ctx)
 {
-    if (!stats_scan_initiate(
-                radio_cfg,
-                chan_list,
-                chan_num,
-                scan_type,
-                dwell_time))
+    stats_scan_ctx_t *ctx;
+    stats_scan_request_t *request;
+
+    ctx = stats_scan_ctx_get(radio_cfg);
+    if (ctx == NULL)
     {
         return false;
     }
 
-    static stats_scan_request_t scan_request;  /* TODO: unify sm_scan_request */
-
-    memset (&scan_request, 0, sizeof(scan_request));
-    scan_request.radio_cfg  = radio_cfg;
-    scan_request.scan_type  = scan_type;
-    scan_request.scan_cb    = scan_cb;
-    scan_request.scan_ctx   = scan_ctx;
+    request = CALLOC(1, sizeof(*request));
+    request->radio_cfg  = radio_cfg;
+    request->scan_type  = scan_type;
+    request->chan_num   = chan_num;
+    request->chan_list  = CALLOC(chan_num + 1, sizeof(*request->chan_list));
+    memcpy(request->chan_list, chan_list, chan_num * sizeof(*request->chan_list));
+    request->dwell_time = dwell_time;
+    request->scan_cb    = scan_cb;
+    request->scan_ctx   = scan_ctx;
+    request->queued_at  = ev_now(EV_DEFAULT);
+
+    if (ctx->active != NULL)
+    {
+        LOGD("Scan %s %s queued behind %s",
+             radio_get_name_from_type(radio_cfg->type),
+             radio_get_scan_name_from_type(scan_type),
+             radio_get_scan_name_from_type(ctx->active->scan_type));
+        ds_dlist_insert_tail(&ctx->queue[stats_scan_prio(scan_type)], request);
+        return true;
+    }
 
-    // Start result polling timer
-    ev_init (&g_scan_result_timer, stats_scan_results_fetch);
-    g_scan_result_timer.repeat =  STATS_SCAN_RESULT_POLL_TIME;
-    g_scan_result_timer.data = &scan_request;
-    stats_scan_result_timer_set(&g_scan_result_timer, true);
-    g_scan_result_timeout = STATS_SCAN_RESULT_POLL_TIMEOUT;
+    if (!stats_scan_request_start(ctx, request))
+    {
+        stats_scan_request_free(request);
+        return false;
+    }
 
     return true;
 }
@@ -925,7 +1398,50 @@ bool stats_scan_stop(
         radio_entry_t              *radio_cfg,
         radio_scan_type_t           scan_type)
 {
-    stats_scan_result_timer_set(&g_scan_result_timer, false);
+    stats_scan_ctx_t *ctx;
+    stats_scan_request_t *request;
+    ds_dlist_iter_t qiter;
+    ds_dlist_t *queue;
+    ds_dlist_t dropped = DS_DLIST_INIT(stats_scan_request_t, node);
+
+    ctx = stats_scan_ctx_get(radio_cfg);
+    if (ctx == NULL)
+    {
+        return false;
+    }
+
+    // Drop pending requests of this type, then the one in progress
+    queue = &ctx->queue[stats_scan_prio(scan_type)];
+    for (   request = ds_dlist_ifirst(&qiter, queue);
+            request != NULL;
+            request = ds_dlist_inext(&qiter))
+    {
+        if (request->scan_type != scan_type) continue;
+        ds_dlist_iremove(&qiter);
+        ds_dlist_insert_tail(&dropped, request);
+    }
+
+    // Pending requests were accepted, complete them as failed. Done after
+    // the queue walk, as the callback may start a new scan.
+    while ((request = ds_dlist_remove_head(&dropped)) != NULL)
+    {
+        if (request->scan_cb)
+        {
+            request->scan_cb(request->scan_ctx, false);
+        }
+        stats_scan_request_free(request);
+    }
+
+    // A scan of another type keeps running and still reports through its
+    // own callback
+    if (ctx->active != NULL && ctx->active->scan_type == scan_type)
+    {
+        ev_timer_stop(EV_DEFAULT, &ctx->timer);
+        stats_scan_request_free(ctx->active);
+        ctx->active = NULL;
+        stats_scan_dispatch(ctx);
+    }
+
     return true;
 }
 
@@ -979,6 +1495,84 @@ bool stats_scan_hal_to_dpp_record_array(
     return true;
 }
 
+/*
+ * Neighbors are deduplicated on (channel, BSSID) through an open addressing
+ * hash table. The key packs the binary BSSID and the channel into 64 bits,
+ * with the top bit set so that 0 marks an empty slot. The table is kept
+ * across scans and only grows.
+ */
+#define STATS_SCAN_KEY_USED         (1ULL << 63)
+
+static uint64_t *g_scan_dedup_table;
+static uint32_t g_scan_dedup_size;
+static stats_scan_dedup_stats_t g_scan_dedup_stats;
+
+static bool stats_scan_bssid_to_key(const char *bssid, uint32_t chan, uint64_t *key)
+{
+    uint64_t k = 0;
+    int nibble;
+    int i;
+
+    // "xx:xx:xx:xx:xx:xx"
+    for (i = 0; i < 17; i++)
+    {
+        if (i % 3 == 2)
+        {
+            if (bssid[i] != ':') return false;
+            continue;
+        }
+
+        if (bssid[i] >= '0' && bssid[i] <= '9') nibble = bssid[i] - '0';
+        else if (bssid[i] >= 'a' && bssid[i] <= 'f') nibble = bssid[i] - 'a' + 10;
+        else if (bssid[i] >= 'A' && bssid[i] <= 'F') nibble = bssid[i] - 'A' + 10;
+        else return false;
+
+        k = (k << 4) | (uint64_t)nibble;
+    }
+
+    *key = STATS_SCAN_KEY_USED | ((uint64_t)(chan & 0xffff) << 48) | k;
+    return true;
+}
+
+static void stats_scan_dedup_init(uint32_t qty)
+{
+    uint32_t size = 64;
+
+    // Keep the load factor at or below 1/2
+    while (size < qty * 2) size <<= 1;
+
+    if (size > g_scan_dedup_size)
+    {
+        FREE(g_scan_dedup_table);
+        g_scan_dedup_table = CALLOC(size, sizeof(*g_scan_dedup_table));
+        g_scan_dedup_size = size;
+        return;
+    }
+
+    memset(g_scan_dedup_table, 0, g_scan_dedup_size * sizeof(*g_scan_dedup_table));
+}
+
+// Returns true if the key was already present
+static bool stats_scan_dedup_insert(uint64_t key)
+{
+    uint32_t mask = g_scan_dedup_size - 1;
+    uint32_t i = (uint32_t)((key * 0x9E3779B97F4A7C15ULL) >> 32) & mask;
+
+    while (g_scan_dedup_table[i] != 0)
+    {
+        if (g_scan_dedup_table[i] == key) return true;
+        i = (i + 1) & mask;
+    }
+
+    g_scan_dedup_table[i] = key;
+    return false;
+}
+
+void stats_scan_dedup_stats_get(stats_scan_dedup_stats_t *stats)
+{
+    memcpy(stats, &g_scan_dedup_stats, sizeof(*stats));
+}
+
 static bool stats_scan_extract_neighbors_from_ssids(
         radio_type_t                radio_type,
         uint32_t                   *chan_list,
@@ -988,19 +1582,16 @@ static bool stats_scan_extract_neighbors_from_ssids(
         uint32_t                    scan_result_qty,
         dpp_neighbor_list_t        *neighbor_list)
 {
-#define LAST_5_BYTE_EQ(bssid1, bssid2)  (strncmp(bssid1+3, bssid2+3, 14) == 0)
-#define BSSID_CMP(bssid1, bssid2)       strcmp(bssid1+8, bssid2+8)
     dpp_neighbor_record_t          *rec_new;
     uint32_t                        rec_new_count=0;
-    dpp_neighbor_record_t          *rec_cmp;
-    uint32_t                        rec_cmp_count=0;
-
-    uint32_t                        chan_index;
-    uint32_t                        chan_found = false;
+    uint8_t                         chan_map[256 / 8];
+    uint64_t                        key;
 
     dpp_neighbor_record_list_t     *neighbor = NULL;
     dpp_neighbor_record_t          *neighbor_entry = NULL;
     uint32_t                        neighbor_qty = 0;
+    uint32_t                        offchan_qty = 0;
+    uint32_t                        dup_qty = 0;
 
     if (    (scan_results == NULL)
          || (neighbor_list == NULL)
@@ -1009,6 +1600,17 @@ static bool stats_scan_extract_neighbors_from_ssids(
         return false;
     }
 
+    memset(chan_map, 0, sizeof(chan_map));
+    for (rec_new_count = 0; rec_new_count < chan_num; rec_new_count++)
+    {
+        if (chan_list[rec_new_count] < 256)
+        {
+            chan_map[chan_list[rec_new_count] / 8] |= 1 << (chan_list[rec_new_count] % 8);
+        }
+    }
+
+    stats_scan_dedup_init(scan_result_qty);
+
     // Remove multiple SSID's per neighbor AP
     for (   rec_new_count = 0;
             rec_new_count < scan_result_qty;
@@ -1023,41 +1625,18 @@ static bool stats_scan_extract_neighbors_from_ssids(
         }
 
         // Skip entries that are not on scanned channel
-        chan_found = false;
-        for (   chan_index = 0;
-                chan_index < chan_num;
-                chan_index++)
-        {
-            if (rec_new->chan == chan_list[chan_index])
-            {
-                chan_found = true;
-                break;
-            }
-        }
-
-        if (!chan_found)
+        if (rec_new->chan >= 256 || !(chan_map[rec_new->chan / 8] & (1 << (rec_new->chan % 8))))
         {
+            offchan_qty++;
             continue;
         }
 
-        // Find duplicate entries and mark them not seen
-        for (   rec_cmp_count = rec_new_count + 1;
-                rec_cmp_count < scan_result_qty;
-                rec_cmp_count++)
+        // Skip duplicate entries
+        if (stats_scan_bssid_to_key(rec_new->bssid, rec_new->chan, &key) &&
+            stats_scan_dedup_insert(key))
         {
-            rec_cmp = &scan_results[rec_cmp_count];
-
-            if (rec_new->chan != rec_cmp->chan)
-            {
-                continue;
-            }
-
-            // Skip duplicate entries
-            if (strcmp(rec_new->bssid, rec_cmp->bssid) == 0)
-            {
-                rec_cmp->lastseen = 0;
-                continue;
-            }
+            dup_qty++;
+            continue;
         }
 
         neighbor = dpp_neighbor_record_alloc();
@@ -1071,12 +1650,27 @@ static bool stats_scan_extract_neighbors_from_ssids(
         neighbor_qty++;
     }
 
+    g_scan_dedup_stats.scans++;
+    g_scan_dedup_stats.raw += scan_result_qty;
+    g_scan_dedup_stats.offchan += offchan_qty;
+    g_scan_dedup_stats.duplicates += dup_qty;
+    g_scan_dedup_stats.neighbors += neighbor_qty;
+    if (scan_result_qty > g_scan_dedup_stats.raw_max)
+    {
+        g_scan_dedup_stats.raw_max = scan_result_qty;
+    }
+
     LOG(TRACE,
-        "Parsing %s %s scan (removed %d entries of %d)",
+        "Parsing %s %s scan (removed %d entries of %d: %u duplicates, %u off-channel; "
+        "total raw=%llu neighbors=%llu)",
         radio_get_name_from_type(radio_type),
         radio_get_scan_name_from_type(scan_type),
         (scan_result_qty - neighbor_qty),
-        scan_result_qty);
+        scan_result_qty,
+        dup_qty,
+        offchan_qty,
+        (unsigned long long)g_scan_dedup_stats.raw,
+        (unsigned long long)g_scan_dedup_stats.neighbors);
 
     return true;
 }
@@ -1088,9 +1682,11 @@ bool stats_scan_get(
         radio_scan_type_t           scan_type,
         dpp_neighbor_report_data_t *scan_results)
 {
-    dpp_neighbor_record_t scan_records[STATS_SCAN_MAX_RECORDS];
+    dpp_neighbor_record_t *scan_records;
+    int scan_records_size;
     int scan_result_qty = 0;
     radio_type_t radio_type;
+    stats_scan_ctx_t *ctx;
     bool ret;
 
     if (scan_results == NULL)
@@ -1100,15 +1696,29 @@ bool stats_scan_get(
 
     radio_type = radio_cfg->type;
 
+    ctx = stats_scan_ctx_get(radio_cfg);
+    if (ctx == NULL)
+    {
+        return false;
+    }
+
+    // Sized to the HAL result, excess results are dropped with a warning
+    scan_records_size = STATS_SCAN_MAX_RECORDS;
+    if (ctx->results_size < STATS_SCAN_MAX_RECORDS)
+    {
+        scan_records_size = ctx->results_size;
+    }
+    scan_records = CALLOC(scan_records_size + 1, sizeof(*scan_records));
+
     ret = stats_scan_hal_to_dpp_record_array(
             radio_cfg,
             chan_list,
             chan_num,
             scan_type,
-            g_scan_results,
-            g_scan_results_size,
+            ctx->results,
+            ctx->results_size,
             scan_records,
-            ARRAY_SIZE(scan_records),
+            scan_records_size,
             &scan_result_qty);
     if (!ret)
     {
@@ -1116,6 +1726,7 @@ bool stats_scan_get(
                 "Fetch %s %s scan",
                 radio_get_name_from_type(radio_type),
                 radio_get_scan_name_from_type(scan_type));
+        FREE(scan_records);
         return false;
     }
 
@@ -1130,6 +1741,7 @@ bool stats_scan_get(
             scan_records,
             scan_result_qty,
             &scan_results->list);
+    FREE(scan_records);
     if (!success)
     {
         LOG(ERR,
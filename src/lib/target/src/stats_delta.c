@@ -0,0 +1,122 @@
+/*
+Copyright (c) 2017, Plume Design Inc. All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+   1. Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+   2. Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+   3. Neither the name of the Plume Design Inc. nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL Plume Design Inc. BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+/*
+ * Counter delta engine
+ *
+ * HAL counters are sampled periodically and reported as deltas. Between two
+ * samples a counter may legitimately advance, wrap its 32-bit range (many
+ * drivers still keep 32-bit counters behind the 64-bit HAL fields), or go
+ * backwards because the driver restarted it. stats_counter_delta() tells
+ * these cases apart so that a wrap yields the real delta instead of zero or
+ * an absurd value.
+ *
+ * The caller tells the counter width when it is known. For STATS_COUNTER_AUTO
+ * the width is learned: the first value above 32 bits proves a 64-bit
+ * counter, until then a counter going backwards from below 2^32 is guessed
+ * to be a 32-bit wrap.
+ *
+ * The engine has no state besides the anomaly counters and does no HAL
+ * calls, so it can be driven with synthetic sequences.
+ */
+
+#include <stdint.h>
+#include <string.h>
+
+#include "log.h"
+
+#include "target.h"
+#include "target_internal.h"
+
+#define MODULE_ID LOG_MODULE_ID_OSA
+
+/*
+ * A wrapped 32-bit counter is only accepted as a wrap if the resulting delta
+ * is less than half of the counter range, otherwise it is a restart.
+ */
+#define STATS_DELTA_WRAP_MAX_32     (UINT32_MAX / 2)
+
+static stats_delta_stats_t g_delta_stats;
+
+stats_delta_type_t stats_counter_delta(
+        uint64_t old_value,
+        uint64_t new_value,
+        stats_counter_width_t *width,
+        uint64_t *delta)
+{
+    uint64_t wrapped;
+
+    if (*width == STATS_COUNTER_AUTO &&
+        (old_value > UINT32_MAX || new_value > UINT32_MAX))
+    {
+        LOGI("Counter value %llu exceeds 32 bits, treating the counter as 64-bit",
+             (unsigned long long)(old_value > new_value ? old_value : new_value));
+        g_delta_stats.learned_64++;
+        *width = STATS_COUNTER_64;
+    }
+
+    if (*width == STATS_COUNTER_32)
+    {
+        old_value &= UINT32_MAX;
+        new_value &= UINT32_MAX;
+    }
+
+    if (new_value >= old_value)
+    {
+        *delta = new_value - old_value;
+        return STATS_DELTA_OK;
+    }
+
+    /*
+     * A real 64-bit counter does not wrap. With the width still unknown the
+     * values never exceeded 32 bits, so fall back to guessing a 32-bit wrap.
+     */
+    if (*width != STATS_COUNTER_64)
+    {
+        wrapped = ((uint64_t)UINT32_MAX - old_value) + new_value + 1;
+        if (wrapped <= STATS_DELTA_WRAP_MAX_32)
+        {
+            g_delta_stats.wraps++;
+            *delta = wrapped;
+            return STATS_DELTA_WRAP;
+        }
+    }
+
+    // Counter was restarted, count from zero
+    g_delta_stats.resets++;
+    *delta = new_value;
+    return STATS_DELTA_RESET;
+}
+
+void stats_counter_reinit(void)
+{
+    g_delta_stats.reinits++;
+}
+
+void stats_delta_stats_get(stats_delta_stats_t *stats)
+{
+    memcpy(stats, &g_delta_stats, sizeof(*stats));
+}
@@ -51,6 +51,8 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "target.h"
 #include "target_internal.h"
 #include "kconfig.h"
+#include "ds_dlist.h"
+#include "memutil.h"
 
 #ifndef __WIFI_HAL_H__
 #include <ccsp/wifi_hal.h>
@@ -61,6 +63,8 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #define MODULE_ID               LOG_MODULE_ID_HAL
 
 #define SYNC_RETRY      3
+#define SYNC_RX_MSGS    4       // Receive buffer size, in messages
+#define SYNC_TX_QUEUE   64      // Max outbound messages waiting for the socket
 
 /*****************************************************************************/
 
@@ -107,6 +111,34 @@ static int                  sync_fd          = -1;
 
 static ev_timer sync_timer;
 
+/*
+ * MeshAgent socket is a stream: inbound messages may arrive split or
+ * several at a time, outbound ones wait in a bounded queue while the
+ * socket is full.
+ */
+typedef struct
+{
+    MeshSync            msg;
+    size_t              off;            // Bytes already sent
+    ds_dlist_node_t     node;
+} sync_tx_entry_t;
+
+typedef struct
+{
+    unsigned int        rx_msgs;
+    unsigned int        rx_malformed;
+    unsigned int        tx_msgs;
+    unsigned int        tx_queued;      // Messages that had to wait for EV_WRITE
+    unsigned int        tx_dropped;
+    unsigned int        tx_depth_max;
+} sync_stats_t;
+
+static uint8_t              sync_rx_buf[SYNC_RX_MSGS * sizeof(MeshSync)];
+static size_t               sync_rx_len = 0;
+static ds_dlist_t           sync_tx_queue = DS_DLIST_INIT(sync_tx_entry_t, node);
+static unsigned int         sync_tx_depth = 0;
+static sync_stats_t         sync_stats;
+
 /*****************************************************************************/
 
 static void                 sync_reconnect(void);
@@ -149,7 +181,6 @@ static void sync_process_msg(MeshSync *mp)
     INT                             ret;
     char                            radio_ifname[128];
     char                            ssid_ifname[128];
-    bool                            resync = false;
 
 
 #define MK_SSID_IFNAME(idx)     do { \
@@ -188,7 +219,7 @@ static void sync_process_msg(MeshSync *mp)
             {
                 LOGE("Cannot update config table for SSID: %s", mp->data.wifiSSIDName.ssid);
             }
-            resync = true;
+            radio_trigger_resync_vif(mp->data.wifiSSIDName.index, false);
             break;
 
         case MESH_WIFI_AP_SECURITY:
@@ -209,7 +240,7 @@ static void sync_process_msg(MeshSync *mp)
             {
                 LOGE("Cannot update config table for SSID: %s", mp->data.wifiSSIDName.ssid);
             }
-            resync = true;
+            radio_trigger_resync_vif(mp->data.wifiAPSecurity.index, false);
             break;
 
         case MESH_WIFI_AP_ADD_ACL_DEVICE:
@@ -231,7 +262,7 @@ static void sync_process_msg(MeshSync *mp)
                         LOGE("Cannot add ACL from Mesh Agent, index=%d", mp->data.wifiAPAddAclDevice.index);
                     }
                 }
-                resync = true;
+                radio_trigger_resync_vif(mp->data.wifiAPAddAclDevice.index, false);
             }
             break;
 
@@ -254,7 +285,7 @@ static void sync_process_msg(MeshSync *mp)
                         LOGE("Cannot del ACL from Mesh Agent, index=%d", mp->data.wifiAPDelAclDevice.index);
                     }
                 }
-                resync = true;
+                radio_trigger_resync_vif(mp->data.wifiAPDelAclDevice.index, false);
             }
             break;
 
@@ -280,7 +311,7 @@ static void sync_process_msg(MeshSync *mp)
                         LOGE("Cannot update ACL mode from Mesh Agent, index=%d", mp->data.wifiMacAddrControlMode.index);
                     }
                 }
-                resync = true;
+                radio_trigger_resync_vif(mp->data.wifiMacAddrControlMode.index, false);
             }
             break;
 
@@ -296,7 +327,7 @@ static void sync_process_msg(MeshSync *mp)
             LOGI("... %s SSID advertise now '%s'",
                     ssid_ifname,
                     mp->data.wifiSSIDAdvertise.enable ? "true" : "false");
-            resync = true;
+            radio_trigger_resync_vif(mp->data.wifiSSIDAdvertise.index, false);
             break;
 
         case MESH_URL_CHANGE:
@@ -308,7 +339,7 @@ static void sync_process_msg(MeshSync *mp)
         case MESH_WIFI_RESET:
             BREAK_IF_NOT_MGR(WM);
             LOGI("... Wifi Reset '%s'", mp->data.wifiReset.reset ? "true" : "false");
-            resync = true;
+            radio_trigger_resync();
             break;
 
         case MESH_SUBNET_CHANGE:
@@ -327,7 +358,7 @@ static void sync_process_msg(MeshSync *mp)
                 break;
             }
             LOGI("... %s: Kick all devices", ssid_ifname);
-            resync = true;
+            radio_trigger_resync_vif(mp->data.wifiAPKickAllAssocDevices.index, true);
             break;
 
         case MESH_WIFI_AP_KICK_ASSOC_DEVICE:
@@ -340,7 +371,7 @@ static void sync_process_msg(MeshSync *mp)
                 break;
             }
             LOGI("... %s: Kick device '%s'", ssid_ifname, mp->data.wifiAPKickAssocDevice.mac);
-            resync = true;
+            radio_trigger_resync_vif(mp->data.wifiAPKickAssocDevice.index, true);
             break;
 
         case MESH_WIFI_RADIO_CHANNEL:
@@ -354,7 +385,7 @@ static void sync_process_msg(MeshSync *mp)
                 break;
             }
             LOGI("... %s: changed channel to %d", radio_ifname, mp->data.wifiRadioChannel.channel);
-            resync = true;
+            radio_trigger_resync_radio(radioIndex);
             break;
 
         case MESH_WIFI_RADIO_CHANNEL_MODE:
@@ -373,7 +404,7 @@ static void sync_process_msg(MeshSync *mp)
                     mp->data.wifiRadioChannelMode.gOnlyFlag ? "true" : "false",
                     mp->data.wifiRadioChannelMode.nOnlyFlag ? "true" : "false",
                     mp->data.wifiRadioChannelMode.acOnlyFlag ? "true" : "false");
-            resync = true;
+            radio_trigger_resync_radio(radioIndex);
             break;
 
         case MESH_STATE_CHANGE:
@@ -467,54 +498,156 @@ static void sync_process_msg(MeshSync *mp)
     }
 #undef MK_SSID_IFNAME
 #undef MK_RADIO_IFNAME
-    if (sync_mgr == SYNC_MGR_WM && resync == true)
+
+    return;
+}
+
+static void sync_tx_watch(bool enable)
+{
+    int events = EV_READ | (enable ? EV_WRITE : 0);
+
+    if ((sync_evio.events & (EV_READ | EV_WRITE)) == events) return;
+
+    ev_io_stop(wifihal_evloop, &sync_evio);
+    ev_io_set(&sync_evio, sync_fd, events);
+    ev_io_start(wifihal_evloop, &sync_evio);
+}
+
+static void sync_tx_queue_flush(void)
+{
+    sync_tx_entry_t     *entry;
+
+    while ((entry = ds_dlist_remove_head(&sync_tx_queue)) != NULL)
     {
-        LOGD("Re-sync triggered by MeshAgent");
-        radio_trigger_resync();
+        FREE(entry);
     }
+    sync_tx_depth = 0;
+}
 
-    return;
+/*
+ * Send as much of the queue as the socket accepts. Returns false if the
+ * connection failed.
+ */
+static bool sync_tx_queue_send(void)
+{
+    sync_tx_entry_t     *entry;
+    ssize_t             ret;
+
+    while ((entry = ds_dlist_head(&sync_tx_queue)) != NULL)
+    {
+        ret = send(sync_fd, (uint8_t *)&entry->msg + entry->off,
+                   sizeof(entry->msg) - entry->off, MSG_DONTWAIT | MSG_NOSIGNAL);
+        if (ret < 0)
+        {
+            if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) break;
+
+            LOGE("Sync client failed to send message type \"%s\", errno = %d",
+                 sync_message_name(entry->msg.msgType), errno);
+            return false;
+        }
+
+        entry->off += ret;
+        if (entry->off < sizeof(entry->msg)) break;
+
+        ds_dlist_remove(&sync_tx_queue, entry);
+        FREE(entry);
+        sync_tx_depth--;
+        sync_stats.tx_msgs++;
+    }
+
+    if (sync_tx_depth == 0 && (sync_evio.events & EV_WRITE))
+    {
+        LOGI("Sync client send queue drained (queued %u, dropped %u, max depth %u)",
+             sync_stats.tx_queued, sync_stats.tx_dropped, sync_stats.tx_depth_max);
+    }
+
+    sync_tx_watch(sync_tx_depth > 0);
+    return true;
 }
 
-static void sync_evio_cb(struct ev_loop *loop, ev_io *watcher, int revents)
+static void sync_rx_process(void)
 {
     MeshSync            mmsg;
-    int                 ret;
+    size_t              off = 0;
 
-    if (revents & EV_ERROR)
+    while (sync_rx_len - off >= sizeof(mmsg))
     {
-        LOGE("Sync client MSGQ reported a socket error, reconnecting...");
-        sync_reconnect();
-        return;
+        memcpy(&mmsg, sync_rx_buf + off, sizeof(mmsg));
+        off += sizeof(mmsg);
+
+        if (mmsg.msgType >= MESH_SYNC_MSG_TOTAL)
+        {
+            LOGE("Sync client received unsupported msg type (%d >= %d)",
+                 mmsg.msgType, MESH_SYNC_MSG_TOTAL);
+            sync_stats.rx_malformed++;
+            continue;
+        }
+
+        sync_stats.rx_msgs++;
+        sync_process_msg(&mmsg);
+
+        // A message handler may have dropped the connection and the buffer
+        if (sync_fd < 0) return;
     }
 
-    ret = recv(sync_fd, &mmsg, sizeof(mmsg), MSG_DONTWAIT);
-    if (ret <= 0)
+    // Keep the partial message, if any, at the start of the buffer
+    sync_rx_len -= off;
+    if (off > 0 && sync_rx_len > 0)
     {
-        LOGE("Sync client failed to read message, errno %d, reconnecting...", errno);
+        memmove(sync_rx_buf, sync_rx_buf + off, sync_rx_len);
+    }
+}
+
+static void sync_evio_cb(struct ev_loop *loop, ev_io *watcher, int revents)
+{
+    ssize_t             ret;
+
+    if (revents & EV_ERROR)
+    {
+        LOGE("Sync client MSGQ reported a socket error, reconnecting...");
         sync_reconnect();
         return;
     }
-    else if (ret != sizeof(mmsg))
+
+    if (revents & EV_WRITE)
     {
-        LOGE("Sync client received malformed packet (length %d != %d)", ret, (int)sizeof(mmsg));
-        return;
+        if (!sync_tx_queue_send())
+        {
+            sync_reconnect();
+            return;
+        }
     }
 
-    if (mmsg.msgType >= MESH_SYNC_MSG_TOTAL)
+    if (!(revents & EV_READ)) return;
+
+    // Drain the socket, processing all complete messages
+    for (;;)
     {
-        LOGE("Sync client received unsupported msg type (%d >= %d)",
-             mmsg.msgType, MESH_SYNC_MSG_TOTAL);
-        return;
+        ret = recv(sync_fd, sync_rx_buf + sync_rx_len,
+                   sizeof(sync_rx_buf) - sync_rx_len, MSG_DONTWAIT);
+        if (ret < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR))
+        {
+            break;
+        }
+        if (ret <= 0)
+        {
+            LOGE("Sync client failed to read message, errno %d, reconnecting...",
+                 ret == 0 ? 0 : errno);
+            sync_reconnect();
+            return;
+        }
+
+        sync_rx_len += ret;
+        sync_rx_process();
+        if (sync_fd < 0) return;
     }
 
-    sync_process_msg(&mmsg);
     return;
 }
 
 static bool sync_send_msg(MeshSync *mp)
 {
-    int ret;
+    sync_tx_entry_t     *entry;
 
     if (sync_fd < 0)
     {
@@ -523,23 +656,33 @@ static bool sync_send_msg(MeshSync *mp)
         return false;
     }
 
-    ret = send(sync_fd, (void *)mp, sizeof(*mp), MSG_DONTWAIT);
-    if (ret <= 0)
+    if (sync_tx_depth >= SYNC_TX_QUEUE)
     {
-        if (errno == EAGAIN || errno == EWOULDBLOCK)
-        {
-            LOGW("Sync client was too busy to send message type \"%s\", dropped...",
-                 sync_message_name(mp->msgType));
-        }
-        else
-        {
-            LOGE("Sync client failed to send message type \"%s\", errno = %d",
-                 sync_message_name(mp->msgType), errno);
-        }
+        sync_stats.tx_dropped++;
+        LOGW("Sync client send queue full, message type \"%s\" dropped (dropped %u)",
+             sync_message_name(mp->msgType), sync_stats.tx_dropped);
+        return false;
+    }
 
+    entry = CALLOC(1, sizeof(*entry));
+    memcpy(&entry->msg, mp, sizeof(entry->msg));
+    ds_dlist_insert_tail(&sync_tx_queue, entry);
+    sync_tx_depth++;
+
+    if (!sync_tx_queue_send())
+    {
+        sync_reconnect();
         return false;
     }
 
+    if (sync_tx_depth > 0)
+    {
+        sync_stats.tx_queued++;
+        if (sync_tx_depth > sync_stats.tx_depth_max) sync_stats.tx_depth_max = sync_tx_depth;
+        LOGD("Sync client busy, message type \"%s\" queued (depth %u)",
+             sync_message_name(mp->msgType), sync_tx_depth);
+    }
+
     return true;
 }
 
@@ -616,7 +759,15 @@ static void sync_disconnect(void)
     close(sync_fd);
     sync_fd = -1;
 
-    LOGI("Sync client disconnected from Mesh-Agent");
+    // Unsent and partially received messages are lost with the connection
+    sync_stats.tx_dropped += sync_tx_depth;
+    sync_tx_queue_flush();
+    sync_rx_len = 0;
+
+    LOGI("Sync client disconnected from Mesh-Agent (rx %u, rx malformed %u, tx %u, "
+         "tx queued %u, tx dropped %u, tx max depth %u)",
+         sync_stats.rx_msgs, sync_stats.rx_malformed, sync_stats.tx_msgs,
+         sync_stats.tx_queued, sync_stats.tx_dropped, sync_stats.tx_depth_max);
     return;
 }
 
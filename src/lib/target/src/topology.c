@@ -0,0 +1,341 @@
+/*
+Copyright (c) 2017, Plume Design Inc. All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+   1. Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+   2. Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+   3. Neither the name of the Plume Design Inc. nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL Plume Design Inc. BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+/*
+ * Topology cache
+ *
+ * Radio, VAP and interface name layout reported by the HAL does not change
+ * at runtime, yet almost every stats poll, survey, scan and VIF state refresh
+ * needs to translate between radio ifnames, SSID indexes and VAP map
+ * positions. Each such translation used to cost a full wifi_getHalCapability()
+ * plus a handful of wifi_getRadioIfName()/wifi_getSSIDRadioIndex() calls,
+ * which are IPC round trips on most RDK platforms.
+ *
+ * The cache is built lazily on first use and stays valid until
+ * topology_invalidate() is called on an explicit topology event.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <pthread.h>
+
+#include "os.h"
+#include "log.h"
+#include "ds_tree.h"
+#include "util.h"
+
+#include "target.h"
+#include "target_internal.h"
+
+#define MODULE_ID LOG_MODULE_ID_OSA
+
+#define TOPOLOGY_MAX_VAPS   (MAX_NUM_RADIOS * MAX_NUM_VAP_PER_RADIO)
+
+typedef struct
+{
+    char                ifname[WIFIHAL_MAX_BUFFER];
+    INT                 ssid_index;
+    INT                 radio_index;
+    INT                 vap_pos;    // Position in wifi_vap_info_map_t.vap_array
+    ds_tree_node_t      dst_node;
+} topology_vap_t;
+
+static struct
+{
+    pthread_mutex_t     lock;
+    bool                valid;
+    bool                complete;   // Every radio reported its VAP map
+
+    UINT                num_radios;
+    char                radio_ifname[MAX_NUM_RADIOS][WIFIHAL_MAX_BUFFER];
+
+    UINT                num_vaps;
+    topology_vap_t      vaps[TOPOLOGY_MAX_VAPS];
+    topology_vap_t     *by_ssid_index[TOPOLOGY_MAX_VAPS];
+    ds_tree_t           by_ifname;
+
+    topology_stats_t    stats;
+} g_topo =
+{
+    .lock = PTHREAD_MUTEX_INITIALIZER,
+    .valid = false,
+};
+
+/*****************************************************************************/
+
+static topology_vap_t *topology_vap_by_ssid_index(INT ssid_index)
+{
+    if (ssid_index < 0 || ssid_index >= TOPOLOGY_MAX_VAPS) return NULL;
+    return g_topo.by_ssid_index[ssid_index];
+}
+
+static topology_vap_t *topology_vap_get(INT ssid_index)
+{
+    topology_vap_t *vap;
+
+    if (ssid_index < 0 || ssid_index >= TOPOLOGY_MAX_VAPS) return NULL;
+
+    vap = g_topo.by_ssid_index[ssid_index];
+    if (vap != NULL) return vap;
+
+    if (g_topo.num_vaps >= TOPOLOGY_MAX_VAPS) return NULL;
+
+    vap = &g_topo.vaps[g_topo.num_vaps++];
+    vap->ssid_index = ssid_index;
+    vap->radio_index = -1;
+    vap->vap_pos = -1;
+    g_topo.by_ssid_index[ssid_index] = vap;
+
+    return vap;
+}
+
+static bool topology_build(void)
+{
+    INT                             ret;
+    UINT                            r;
+    UINT                            i;
+    wifi_hal_capability_t           cap;
+    wifi_interface_name_idex_map_t *imap;
+    wifi_vap_info_map_t             vmap;
+    topology_vap_t                 *vap;
+
+    memset(&g_topo.radio_ifname, 0, sizeof(g_topo.radio_ifname));
+    memset(&g_topo.vaps, 0, sizeof(g_topo.vaps));
+    memset(&g_topo.by_ssid_index, 0, sizeof(g_topo.by_ssid_index));
+    ds_tree_init(&g_topo.by_ifname, (ds_key_cmp_t *)strcmp, topology_vap_t, dst_node);
+    g_topo.num_radios = 0;
+    g_topo.num_vaps = 0;
+    g_topo.complete = false;
+
+    memset(&cap, 0, sizeof(cap));
+    ret = wifi_getHalCapability(&cap);
+    if (ret != RETURN_OK)
+    {
+        LOGE("%s: failed to get HAL capabilities", __func__);
+        return false;
+    }
+
+    if (cap.wifi_prop.numRadios > MAX_NUM_RADIOS)
+    {
+        LOGW("%s: HAL reports %u radios, limiting to %d", __func__,
+             cap.wifi_prop.numRadios, MAX_NUM_RADIOS);
+        cap.wifi_prop.numRadios = MAX_NUM_RADIOS;
+    }
+
+    for (r = 0; r < cap.wifi_prop.numRadios; r++)
+    {
+        char radio_ifname[128];
+
+        memset(radio_ifname, 0, sizeof(radio_ifname));
+        ret = wifi_getRadioIfName(r, radio_ifname);
+        if (ret != RETURN_OK)
+        {
+            LOGE("%s: failed to get radio ifname for idx %u", __func__, r);
+            return false;
+        }
+        STRSCPY(g_topo.radio_ifname[r], radio_ifname);
+    }
+    g_topo.num_radios = cap.wifi_prop.numRadios;
+
+    imap = cap.wifi_prop.interface_map;
+    for (i = 0; i < TOPOLOGY_MAX_VAPS; i++)
+    {
+        if (imap[i].vap_name[0] == '\0') continue;
+
+        vap = topology_vap_get(imap[i].index);
+        if (vap == NULL)
+        {
+            LOGW("%s: skipping %s, SSID index %d out of range", __func__,
+                 imap[i].vap_name, imap[i].index);
+            continue;
+        }
+
+        if (vap->ifname[0] != '\0') continue;
+        STRSCPY(vap->ifname, imap[i].vap_name);
+        ds_tree_insert(&g_topo.by_ifname, vap, vap->ifname);
+    }
+
+    g_topo.complete = true;
+    for (r = 0; r < g_topo.num_radios; r++)
+    {
+        memset(&vmap, 0, sizeof(vmap));
+        if (wifi_getRadioVapInfoMap(r, &vmap) != RETURN_OK)
+        {
+            // Names are still usable, VAP positions of this radio are
+            // looked up again on the next miss
+            LOGW("%s: failed to get VAP map for radio %u", __func__, r);
+            g_topo.complete = false;
+            continue;
+        }
+
+        for (i = 0; i < vmap.num_vaps; i++)
+        {
+            vap = topology_vap_get(vmap.vap_array[i].vap_index);
+            if (vap == NULL) continue;
+
+            vap->radio_index = r;
+            vap->vap_pos = i;
+        }
+    }
+
+    LOGI("%s: cached %u radios, %u VAPs%s", __func__, g_topo.num_radios, g_topo.num_vaps,
+         g_topo.complete ? "" : " (incomplete)");
+
+    return true;
+}
+
+/*
+ * Must be called with g_topo.lock held. Counts the lookup as a hit when the
+ * cache was already valid and as a miss when it had to be (re)built.
+ */
+static bool topology_ensure(void)
+{
+    if (g_topo.valid)
+    {
+        g_topo.stats.hits++;
+        return true;
+    }
+
+    g_topo.stats.misses++;
+    g_topo.valid = topology_build();
+
+    return g_topo.valid;
+}
+
+/*****************************************************************************/
+
+void topology_invalidate(void)
+{
+    pthread_mutex_lock(&g_topo.lock);
+    if (g_topo.valid)
+    {
+        g_topo.valid = false;
+        g_topo.stats.invalidations++;
+        LOGD("%s: hits=%llu misses=%llu invalidations=%llu", __func__,
+             (unsigned long long)g_topo.stats.hits,
+             (unsigned long long)g_topo.stats.misses,
+             (unsigned long long)g_topo.stats.invalidations);
+    }
+    pthread_mutex_unlock(&g_topo.lock);
+}
+
+void topology_stats_get(topology_stats_t *stats)
+{
+    pthread_mutex_lock(&g_topo.lock);
+    *stats = g_topo.stats;
+    pthread_mutex_unlock(&g_topo.lock);
+}
+
+bool topology_radio_ifname_to_idx(const char *radio_ifname, INT *radio_index)
+{
+    bool    found = false;
+    UINT    r;
+
+    pthread_mutex_lock(&g_topo.lock);
+    if (!topology_ensure()) goto exit;
+
+    for (r = 0; r < g_topo.num_radios; r++)
+    {
+        if (!strcmp(g_topo.radio_ifname[r], radio_ifname))
+        {
+            *radio_index = r;
+            found = true;
+            break;
+        }
+    }
+
+exit:
+    pthread_mutex_unlock(&g_topo.lock);
+    return found;
+}
+
+bool topology_radio_idx_to_ifname(INT radio_index, char *radio_ifname, size_t radio_ifname_size)
+{
+    bool found = false;
+
+    pthread_mutex_lock(&g_topo.lock);
+    if (!topology_ensure()) goto exit;
+
+    if (radio_index >= 0 && (UINT)radio_index < g_topo.num_radios)
+    {
+        strscpy(radio_ifname, g_topo.radio_ifname[radio_index], radio_ifname_size);
+        found = true;
+    }
+
+exit:
+    pthread_mutex_unlock(&g_topo.lock);
+    return found;
+}
+
+bool topology_vif_ifname_to_idx(const char *ifname, INT *ssid_index)
+{
+    bool            found = false;
+    topology_vap_t *vap;
+
+    pthread_mutex_lock(&g_topo.lock);
+    if (!topology_ensure()) goto exit;
+
+    vap = ds_tree_find(&g_topo.by_ifname, (void *)ifname);
+    if (vap != NULL)
+    {
+        *ssid_index = vap->ssid_index;
+        found = true;
+    }
+
+exit:
+    pthread_mutex_unlock(&g_topo.lock);
+    return found;
+}
+
+bool topology_ssid_index_to_radio(INT ssid_index, INT *radio_index, INT *vap_pos)
+{
+    bool            found = false;
+    topology_vap_t *vap;
+
+    pthread_mutex_lock(&g_topo.lock);
+    if (!topology_ensure()) goto exit;
+
+    vap = topology_vap_by_ssid_index(ssid_index);
+    if ((vap == NULL || vap->radio_index < 0) && !g_topo.complete)
+    {
+        // A VAP map was missing when the cache was built, try again
+        g_topo.valid = false;
+        g_topo.stats.invalidations++;
+        if (!topology_ensure()) goto exit;
+        vap = topology_vap_by_ssid_index(ssid_index);
+    }
+
+    if (vap != NULL && vap->radio_index >= 0)
+    {
+        if (radio_index != NULL) *radio_index = vap->radio_index;
+        if (vap_pos != NULL) *vap_pos = vap->vap_pos;
+        found = true;
+    }
+
+exit:
+    pthread_mutex_unlock(&g_topo.lock);
+    return found;
+}
@@ -51,10 +51,6 @@ static c_item_t map_enable_disable[] =
     C_ITEM_STR(false,                   "disabled")
 };
 
-#define ACL_BUF_SIZE   1024
-#define MAX_ACL_NUMBER   64
-
-
 static c_item_t map_acl_modes[] =
 {
     C_ITEM_STR(wifi_mac_filter_mode_white_list, "whitelist"),
@@ -129,10 +125,11 @@ bool ssid_index_to_vap_info(UINT ssid_index, wifi_vap_info_map_t *map, wifi_vap_
 {
     UINT i;
     INT radio_idx = -1;
+    INT vap_pos = -1;
 
-    if (wifi_getSSIDRadioIndex(ssid_index, &radio_idx) != RETURN_OK)
+    if (!topology_ssid_index_to_radio(ssid_index, &radio_idx, &vap_pos))
     {
-        LOGE("wifi_getSSIDRadioIndex() FAILED ssid_index=%d", ssid_index);
+        LOGE("Cannot find radio index for ssid_index %d", ssid_index);
         return false;
     }
 
@@ -140,6 +137,16 @@ bool ssid_index_to_vap_info(UINT ssid_index, wifi_vap_info_map_t *map, wifi_vap_
 
     if (wifi_getRadioVapInfoMap(radio_idx, map) == RETURN_OK)
     {
+        if (vap_pos >= 0 && (UINT)vap_pos < map->num_vaps &&
+            map->vap_array[vap_pos].vap_index == ssid_index)
+        {
+            *vap_info = &map->vap_array[vap_pos];
+            return true;
+        }
+
+        // VAP map layout changed under us, rebuild the cache on next lookup
+        topology_invalidate();
+
         for (i = 0; i < map->num_vaps; i++)
         {
             if (map->vap_array[i].vap_index == ssid_index)
@@ -154,107 +161,17 @@ bool ssid_index_to_vap_info(UINT ssid_index, wifi_vap_info_map_t *map, wifi_vap_
     return false;
 }
 
-#ifdef WIFI_HAL_VERSION_3_PHASE2
 static bool acl_to_state(
         const wifi_vap_info_t *vap_info,
         struct schema_Wifi_VIF_State *vstate)
 {
-    INT             status = RETURN_ERR;
-    mac_address_t   acl_list[MAX_ACL_NUMBER] = {0};
-    UINT            acl_number;
-    const char      none_mac_list_type[] = "none";
-    char            acl_string[MAC_STR_LEN] = {0};
-    unsigned int    i;
-
-    if (vap_info->u.bss_info.mac_filter_enable)
-    {
-        SCHEMA_SET_STR(vstate->mac_list_type,
-            c_get_str_by_key(map_acl_modes, vap_info->u.bss_info.mac_filter_mode));
-        if (strlen(vstate->mac_list_type) == 0)
-        {
-            LOGE("%s: Unknown ACL mode (%u)", vap_info->vap_name,
-                vap_info->u.bss_info.mac_filter_mode);
-            return false;
-        }
-    }
-    else
-    {
-        SCHEMA_SET_STR(vstate->mac_list_type, none_mac_list_type);
-    }
-
-    status = wifi_getApAclDevices(vap_info->vap_index, acl_list, MAX_ACL_NUMBER, &acl_number);
-    if (status != RETURN_OK)
-    {
-        LOGE("%s: Failed to obtain ACL list (status %d)!", vap_info->vap_name, status);
-        return false;
-    }
-
-    vstate->mac_list_present = true;
-
-    for (i = 0; i < acl_number; i++)
-    {
-        snprintf(acl_string, sizeof(acl_string), MAC_ADDR_FMT, MAC_ADDR_UNPACK(acl_list[i]));
-        SCHEMA_VAL_APPEND(vstate->mac_list, acl_string);
-    }
-
-    return true;
-}
-
-static bool acl_to_config(const wifi_vap_info_t *vap_info, struct schema_Wifi_VIF_Config *vconf)
-{
-    INT             status = RETURN_ERR;
-    mac_address_t   acl_list[MAX_ACL_NUMBER] = {0};
-    UINT            acl_number;
+    mac_address_t   *acl_list = NULL;
+    UINT            acl_number = 0;
     const char      none_mac_list_type[] = "none";
     char            acl_string[MAC_STR_LEN] = {0};
     unsigned int    i;
 
-    if (vap_info->u.bss_info.mac_filter_enable)
-    {
-        SCHEMA_SET_STR(vconf->mac_list_type,
-            c_get_str_by_key(map_acl_modes, vap_info->u.bss_info.mac_filter_mode));
-        if (strlen(vconf->mac_list_type) == 0)
-        {
-            LOGE("%s: Unknown ACL mode (%u)", vap_info->vap_name,
-                vap_info->u.bss_info.mac_filter_mode);
-            return false;
-        }
-    }
-    else
-    {
-        SCHEMA_SET_STR(vconf->mac_list_type, none_mac_list_type);
-    }
-
-    status = wifi_getApAclDevices(vap_info->vap_index, acl_list, MAX_ACL_NUMBER, &acl_number);
-    if (status != RETURN_OK)
-    {
-        LOGE("%s: Failed to obtain ACL list (status %d)!", vap_info->vap_name, status);
-        return false;
-    }
-
-    vconf->mac_list_present = true;
-
-    for (i = 0; i < acl_number; i++)
-    {
-        snprintf(acl_string, sizeof(acl_string), MAC_ADDR_FMT, MAC_ADDR_UNPACK(acl_list[i]));
-        SCHEMA_VAL_APPEND(vconf->mac_list, acl_string);
-    }
-
-    return true;
-}
-#else
-static bool acl_to_state(
-        const wifi_vap_info_t *vap_info,
-        struct schema_Wifi_VIF_State *vstate)
-{
-    const size_t  mac_str_len = 17;
-    const char    mac_list_separator[] = ",\n";
-    char          acl_buf[ACL_BUF_SIZE];
-    char          *p;
-    char          *s = NULL;
-    INT           status = RETURN_ERR;
-    const char    none_mac_list_type[] = "none";
-
+#ifndef WIFI_HAL_VERSION_3_PHASE2
     if (!kconfig_enabled(CONFIG_RDK_SYNC_EXT_HOME_ACLS))
     {
         // Don't obtain home AP ACLs
@@ -263,6 +180,7 @@ static bool acl_to_state(
             return true;
         }
     }
+#endif
 
     if (vap_info->u.bss_info.mac_filter_enable)
     {
@@ -280,51 +198,38 @@ static bool acl_to_state(
         SCHEMA_SET_STR(vstate->mac_list_type, none_mac_list_type);
     }
 
-    memset(acl_buf, 0, sizeof(acl_buf));
-    status = wifi_getApAclDevices(vap_info->vap_index, acl_buf, sizeof(acl_buf));
-    if (status != RETURN_OK)
+    if (!acl_hal_get(vap_info->vap_index, &acl_list, &acl_number))
     {
-        LOGE("%s: Failed to obtain ACL list (status %d)!", vap_info->vap_name, status);
+        LOGE("%s: Failed to obtain ACL list!", vap_info->vap_name);
         return false;
     }
 
-    if ((strnlen(acl_buf, sizeof(acl_buf))) == sizeof(acl_buf))
+    vstate->mac_list_present = true;
+
+    if (acl_number > ARRAY_SIZE(vstate->mac_list))
     {
-        LOGE("%s: ACL List too long for buffer size!", vap_info->vap_name);
-        return false;
+        LOGW("%s: ACL has %u entries, reporting the first %zu",
+             vap_info->vap_name, acl_number, ARRAY_SIZE(vstate->mac_list));
+        acl_number = ARRAY_SIZE(vstate->mac_list);
     }
-    vstate->mac_list_present = true;
 
-    for (p = strtok_r(acl_buf, mac_list_separator, &s);
-         p != NULL;
-         p = strtok_r(NULL, mac_list_separator, &s))
+    for (i = 0; i < acl_number; i++)
     {
-        if (strlen(p) == 0)
-        {
-            break;
-        }
-        else if (strlen(p) != mac_str_len)
-        {
-            LOGW("%s: ACL has malformed MAC \"%s\"", vap_info->vap_name, p);
-        }
-        else
-        {
-            SCHEMA_VAL_APPEND(vstate->mac_list, p);
-        }
+        acl_mac_to_str(acl_list[i], acl_string, sizeof(acl_string));
+        SCHEMA_VAL_APPEND(vstate->mac_list, acl_string);
     }
 
+    FREE(acl_list);
     return true;
 }
 
 static bool acl_to_config(const wifi_vap_info_t *vap_info, struct schema_Wifi_VIF_Config *vconf)
 {
-    const size_t  mac_str_len = 17;
-    const char    mac_list_separator[] = ",\n";
-    char          acl_buf[ACL_BUF_SIZE];
-    char          *p;
-    char          *s = NULL;
-    INT           status = RETURN_ERR;
-    const char    none_mac_list_type[] = "none";
+    mac_address_t   *acl_list = NULL;
+    UINT            acl_number = 0;
+    const char      none_mac_list_type[] = "none";
+    char            acl_string[MAC_STR_LEN] = {0};
+    unsigned int    i;
 
     if (vap_info->u.bss_info.mac_filter_enable)
     {
@@ -342,200 +247,31 @@ static bool acl_to_config(const wifi_vap_info_t *vap_info, struct schema_Wifi_VI
         SCHEMA_SET_STR(vconf->mac_list_type, none_mac_list_type);
     }
 
-    memset(acl_buf, 0, sizeof(acl_buf));
-    status = wifi_getApAclDevices(vap_info->vap_index, acl_buf, sizeof(acl_buf));
-    if (status != RETURN_OK)
+    if (!acl_hal_get(vap_info->vap_index, &acl_list, &acl_number))
     {
-        LOGE("%s: Failed to obtain ACL list (status %d)!", vap_info->vap_name, status);
+        LOGE("%s: Failed to obtain ACL list!", vap_info->vap_name);
         return false;
     }
 
-    if ((strnlen(acl_buf, sizeof(acl_buf))) == sizeof(acl_buf))
-    {
-        LOGE("%s: ACL List too long for buffer size!", vap_info->vap_name);
-        return false;
-    }
     vconf->mac_list_present = true;
 
-    for (p = strtok_r(acl_buf, mac_list_separator, &s);
-         p != NULL;
-         p = strtok_r(NULL, mac_list_separator, &s))
-    {
-        if (strlen(p) == 0)
-        {
-            break;
-        }
-        else if (strlen(p) != mac_str_len)
-        {
-            LOGW("%s: ACL has malformed MAC \"%s\"", vap_info->vap_name, p);
-        }
-        else
-        {
-            SCHEMA_VAL_APPEND(vconf->mac_list, p);
-        }
-    }
-
-    return true;
-}
-#endif
-
-// Takes a single buffer of MAC strings and separates them into an (pre-allocated) array of MACs
-static bool acl_buf_to_acl_list(INT vap_index, char *acl_buf, char (*acl_list)[MAC_STR_LEN], UINT *acl_list_size)
-{
-    const char mac_list_separator[] = ",\n";
-    char *s = NULL;
-    UINT i = 0;
-
-    for (char *p = strtok_r(acl_buf, mac_list_separator, &s);
-         p != NULL;
-         p = strtok_r(NULL, mac_list_separator, &s))
-    {
-        if (strlen(p) != MAC_STR_LEN - 1)
-        {
-            LOGE("%s: VAP index: %d: ACL has malformed MAC \"%s\"", __func__, vap_index, p);
-            return false;
-        }
-        else
-        {
-            LOGD("%s: VAP index = %d: parsed ACL MAC: %s", __func__, vap_index, p);
-            if (i >= *acl_list_size)
-            {
-                LOGE("%s: VAP index: %d: ACL List longer than previously declared (%u)!",
-                     __func__, vap_index, *acl_list_size);
-                return false;
-            }
-
-            strscpy(acl_list[i++], p, MAC_STR_LEN);
-        }
-    }
-
-    if (i < *acl_list_size)
-    {
-        LOGW("%s: VAP index: %d: ACL List shorter (%u) than previously declared (%u)!",
-             __func__, vap_index, i, *acl_list_size);
-        *acl_list_size = i;
-    }
-
-    return true;
-}
-
-// If true is returned, provides the ACL list as a MAC array and its size.
-// The array needs to be freed after use
-static bool get_acl_list(INT vap_index, char (**acl_list_p)[MAC_STR_LEN], UINT *acl_list_size)
-{
-    char          acl_buf[ACL_BUF_SIZE];
-    INT           status = RETURN_ERR;
-
-    memset(acl_buf, 0, sizeof(acl_buf));
-
-    status = wifi_getApAclDeviceNum(vap_index, acl_list_size);
-    if (status != RETURN_OK)
-    {
-        LOGE("%s: Failed to obtain ACL list count for VAP index: %d (status %d)!",
-             __func__, vap_index, status);
-        return false;
-    }
-
-    LOGD("%s: VAP index = %d: ACL list size: %u", __func__, vap_index, *acl_list_size);
-
-    if (*acl_list_size == 0)
-    {
-        *acl_list_p = NULL;
-        return true;
-    }
-
-    status = wifi_getApAclDevices(vap_index, acl_buf, sizeof(acl_buf));
-    if (status != RETURN_OK)
+    if (acl_number > ARRAY_SIZE(vconf->mac_list))
     {
-        LOGE("%s: Failed to obtain ACL list for VAP index: %d (status %d)!",
-             __func__, vap_index, status);
-        return false;
+        LOGW("%s: ACL has %u entries, reporting the first %zu",
+             vap_info->vap_name, acl_number, ARRAY_SIZE(vconf->mac_list));
+        acl_number = ARRAY_SIZE(vconf->mac_list);
     }
 
-    if ((strnlen(acl_buf, sizeof(acl_buf))) == sizeof(acl_buf))
-    {
-        LOGE("%s: VAP index: %d: ACL list too long for buffer size!", __func__, vap_index);
-        return false;
-    }
-
-    *acl_list_p = CALLOC(*acl_list_size, MAC_STR_LEN);
-
-    if (!acl_buf_to_acl_list(vap_index, acl_buf, *acl_list_p, acl_list_size))
+    for (i = 0; i < acl_number; i++)
     {
-        LOGE("%s: VAP index: %d: Failed preparing ACL list", __func__, vap_index);
-        FREE(*acl_list_p);
-        return false;
+        acl_mac_to_str(acl_list[i], acl_string, sizeof(acl_string));
+        SCHEMA_VAL_APPEND(vconf->mac_list, acl_string);
     }
 
+    FREE(acl_list);
     return true;
 }
 
-// Checks if current ACL contains entries not present on target list and if so, removes them
-static void remove_not_needed_acls(INT vap_index,
-                                   char (*current_acl_list)[MAC_STR_LEN], UINT current_acl_list_num,
-                                   const struct schema_Wifi_VIF_Config *vconf)
-{
-    for (UINT j = 0; j < current_acl_list_num; j++)
-    {
-        bool found = false;
-        for (int i = 0; i < vconf->mac_list_len; i++)
-        {
-            if (strcmp(vconf->mac_list[i], current_acl_list[j]) == 0)
-            {
-                found = true;
-                break;
-            }
-        }
-        if (!found)
-        {
-            INT ret;
-            LOGT("%s: call wifi_delApAclDevice(%d, \"%s\")", __func__, vap_index, current_acl_list[j]);
-
-            ret = wifi_delApAclDevice(vap_index, current_acl_list[j]);
-
-            LOGD("%s: wifi_delApAclDevice(%d, \"%s\") = %d",
-                 __func__, vap_index, current_acl_list[j], ret);
-            if (ret != RETURN_OK)
-            {
-                LOGW("%s: VAP index %d: Failed to remove \"%s\" from ACL", __func__, vap_index, current_acl_list[j]);
-            }
-        }
-    }
-}
-
-// Checks if target ACL contains entries not present on the current list and if so, adds them
-static void add_needed_acls(INT vap_index,
-                            char (*current_acl_list)[MAC_STR_LEN], UINT current_acl_list_num,
-                            const struct schema_Wifi_VIF_Config *vconf)
-{
-    for (int i = 0; i < vconf->mac_list_len; i++)
-    {
-        bool found = false;
-        for (UINT j = 0; j < current_acl_list_num; j++)
-        {
-            if (strcmp(vconf->mac_list[i], current_acl_list[j]) == 0)
-            {
-                found = true;
-                break;
-            }
-        }
-        if (!found)
-        {
-            INT ret;
-            LOGT("%s: call wifi_addApAclDevice(%d, \"%s\")", __func__, vap_index, vconf->mac_list[i]);
-
-            ret = wifi_addApAclDevice(vap_index, (char *)vconf->mac_list[i]);
-
-            LOGD("%s: wifi_addApAclDevice(%d, \"%s\") = %d",
-                 __func__, vap_index, vconf->mac_list[i], ret);
-            if (ret != RETURN_OK)
-            {
-                LOGW("%s: VAP index %d: Failed to add \"%s\" to ACL", __func__, vap_index, vconf->mac_list[i]);
-            }
-        }
-    }
-}
-
 static void acl_apply(
         INT ssid_index,
         const struct schema_Wifi_VIF_Config *vconf,
@@ -578,47 +314,10 @@ static void acl_apply(
 
     if (changed->mac_list)
     {
-#ifdef WIFI_HAL_VERSION_3_PHASE2
-        INT i;
-        INT ret;
-        // First, flush the table
-        ret = wifi_delApAclDevices(ssid_index);
-        LOGD("[WIFI_HAL SET] wifi_delApAclDevices(%d) = %d",
-                                   ssid_index, ret);
-
-        // Set ACL list
-        for (i = 0; i < vconf->mac_list_len; i++)
-        {
-            mac_address_t mac = {0};
-
-            if (sscanf((char *)vconf->mac_list[i], MAC_ADDR_FMT, MAC_ADDR_UNPACK(&mac)) < (int)sizeof(mac))
-            {
-                LOGW("%s: Failed to convert ACL %s", vap_info->vap_name, (char *)vconf->mac_list[i]);
-                continue;
-            }
-            ret = wifi_addApAclDevice(ssid_index, mac);
-            LOGD("[WIFI_HAL SET] wifi_addApAclDevice(%d, "MAC_ADDR_FMT") = %d",
-                                      ssid_index, MAC_ADDR_UNPACK(mac), ret);
-            if (ret != RETURN_OK)
-            {
-                LOGW("%s: Failed to add "MAC_ADDR_FMT" to ACL", vap_info->vap_name, MAC_ADDR_UNPACK(mac));
-            }
-        }
-#else
-        char (*acl_list)[MAC_STR_LEN];
-        UINT acl_list_num;
-        if (!get_acl_list(ssid_index, &acl_list, &acl_list_num))
-        {
-            LOGE("%s: Failed to get ACL list", vap_info->vap_name);
-            return;
-        }
-
-        remove_not_needed_acls(ssid_index, acl_list, acl_list_num, vconf);
-
-        add_needed_acls(ssid_index, acl_list, acl_list_num, vconf);
-
-        FREE(acl_list);
-#endif
+        // Apply only the difference to the current list
+        acl_hal_apply(ssid_index, vap_info->vap_name,
+                      vap_info->u.bss_info.mac_filter_mode == wifi_mac_filter_mode_black_list,
+                      vconf);
     }
 }
 
@@ -1172,11 +871,9 @@ bool vif_get_radio_ifname(
         char *radio_ifname,
         size_t radio_ifname_size)
 {
-    INT ret;
     INT radio_idx;
 
-    ret = wifi_getSSIDRadioIndex(ssidIndex, &radio_idx);
-    if (ret != RETURN_OK)
+    if (!topology_ssid_index_to_radio(ssidIndex, &radio_idx, NULL))
     {
         LOGE("%s: cannot get radio idx for SSID index %d\n", __func__, ssidIndex);
         return false;
@@ -1184,9 +881,7 @@ bool vif_get_radio_ifname(
 
     if (radio_ifname_size != 0 && radio_ifname != NULL)
     {
-        memset(radio_ifname, 0, radio_ifname_size);
-        ret = wifi_getRadioIfName(radio_idx, radio_ifname);
-        if (ret != RETURN_OK)
+        if (!topology_radio_idx_to_ifname(radio_idx, radio_ifname, radio_ifname_size))
         {
             LOGE("%s: cannot get radio ifname for idx %d", __func__,
                     radio_idx);
@@ -1612,104 +1307,327 @@ exit:
 
 bool vif_ifname_to_idx(const char *ifname, INT *outSsidIndex)
 {
-    unsigned int i;
-    INT ret;
-    wifi_hal_capability_t cap;
-    wifi_interface_name_idex_map_t *map;
-
-    memset(&cap, 0, sizeof(cap));
-
-    ret = wifi_getHalCapability(&cap);
-    if (ret != RETURN_OK)
+    if (!topology_vif_ifname_to_idx(ifname, outSsidIndex))
     {
-        LOGE("%s: failed to get HAL capabilities", __func__);
+        LOGE("%s: cannot find SSID index for %s", __func__, ifname);
         return false;
     }
 
-    map = cap.wifi_prop.interface_map;
-    for (i = 0; i < MAX_NUM_RADIOS * MAX_NUM_VAP_PER_RADIO; i++)
-    {
-        if (!strcmp(map[i].vap_name, ifname))
-        {
-            *outSsidIndex = map[i].index;
-            return true;
-        }
-    }
-
-    LOGE("%s: cannot find SSID index for %s", __func__, ifname);
-    return false;
+    return true;
 }
 
+/*
+ * Deferred VIF state updates
+ *
+ * A VIF state update is published CONFIG_RDK_VIF_STATE_UPDATE_DELAY seconds
+ * after the last request for that VIF, so a burst of config changes or
+ * external updates publishes the state once. A VIF that keeps being
+ * requested is still updated at most CONFIG_RDK_VIF_STATE_UPDATE_MAX_DELAY
+ * seconds after its first pending request.
+ *
+ * Pending VIFs are kept in a hashed timer wheel driven by one ev_timer that
+ * only runs while something is pending. A deadline beyond the wheel span
+ * just stays in its slot for more rounds.
+ */
+#define VIF_DEFER_SLOTS         64      // Power of two
+#define VIF_DEFER_TICK          0.25    // Seconds
+#define VIF_DEFER_MAX           (MAX_NUM_RADIOS * MAX_NUM_VAP_PER_RADIO)
+#define VIF_DEFER_LOG_INTERVAL  100     // Updates
+
 typedef struct
 {
-    ev_timer        defer_timer;
     INT             ssid_index;
+    bool            pending;
+    ev_tstamp       first;          // First request since the last update
+    ev_tstamp       deadline;
+    unsigned int    requests;       // Requests since the last update
+    unsigned int    slot;
     ds_dlist_node_t node;
-} vif_state_update_entry_t;
+} vif_defer_entry_t;
 
-static ds_dlist_t vif_update_queue;
+static struct
+{
+    bool                init;
+    ev_timer            timer;
+    ds_dlist_t          slots[VIF_DEFER_SLOTS];
+    ev_tstamp           base;       // Time of tick 0
+    uint64_t            tick;       // Next tick to be processed
+    unsigned int        num_pending;
+    vif_defer_entry_t   entries[VIF_DEFER_MAX];
+    uint64_t            requests;
+    uint64_t            updates;
+} vif_defer;
+
+static uint64_t vif_defer_tick_of(ev_tstamp t)
+{
+    if (t <= vif_defer.base) return 0;
+    return (uint64_t)((t - vif_defer.base) / VIF_DEFER_TICK);
+}
 
-static void vif_state_update_task(struct ev_loop *loop, ev_timer *defer_timer, int revents)
+static void vif_defer_insert(vif_defer_entry_t *entry)
 {
-    vif_state_update_entry_t *ptr = (vif_state_update_entry_t *)defer_timer;
+    uint64_t tick = vif_defer_tick_of(entry->deadline);
 
-    LOGI("%s: deferred update, index=%d", __func__, ptr->ssid_index);
-    vif_state_update(ptr->ssid_index);
+    // First tick at or after the deadline
+    if (vif_defer.base + tick * VIF_DEFER_TICK < entry->deadline) tick++;
 
-    ds_dlist_remove(&vif_update_queue, ptr);
-    ev_timer_stop(wifihal_evloop, &ptr->defer_timer);
-    FREE(ptr);
+    // Never behind the wheel position, the entry would wait a full round
+    if (tick < vif_defer.tick) tick = vif_defer.tick;
+    entry->slot = tick & (VIF_DEFER_SLOTS - 1);
+    ds_dlist_insert_tail(&vif_defer.slots[entry->slot], entry);
+}
+
+static void vif_defer_task(struct ev_loop *loop, ev_timer *timer, int revents)
+{
+    vif_defer_entry_t *entry;
+    ds_dlist_iter_t iter;
+    ds_dlist_t *slot;
+    ev_tstamp now = ev_now(loop);
+    uint64_t last = vif_defer_tick_of(now);
+
+    for (; vif_defer.tick <= last && vif_defer.num_pending > 0; vif_defer.tick++)
+    {
+        slot = &vif_defer.slots[vif_defer.tick & (VIF_DEFER_SLOTS - 1)];
+        for (entry = ds_dlist_ifirst(&iter, slot); entry != NULL; entry = ds_dlist_inext(&iter))
+        {
+            if (entry->deadline > now) continue;
+
+            ds_dlist_iremove(&iter);
+            entry->pending = false;
+            vif_defer.num_pending--;
+            vif_defer.updates++;
+
+            LOGI("%s: deferred update, index=%d requests=%u", __func__,
+                 entry->ssid_index, entry->requests);
+            vif_state_update(entry->ssid_index);
+
+            if (vif_defer.updates % VIF_DEFER_LOG_INTERVAL == 0)
+            {
+                LOGI("%s: %llu VIF state requests coalesced into %llu updates", __func__,
+                     (unsigned long long)vif_defer.requests,
+                     (unsigned long long)vif_defer.updates);
+            }
+        }
+    }
+
+    if (vif_defer.num_pending == 0)
+    {
+        ev_timer_stop(loop, timer);
+    }
 }
 
 void vif_state_update_deferred(INT ssid_index)
 {
-    static bool vif_update_init_done = false;
+    vif_defer_entry_t *entry;
+    ev_tstamp now;
+    ev_tstamp deadline;
+    int i;
 
     LOGT("%s: enter, index=%d delay=%d", __func__, ssid_index, CONFIG_RDK_VIF_STATE_UPDATE_DELAY);
 
-    if (!vif_update_init_done)
+    if (ssid_index < 0 || ssid_index >= VIF_DEFER_MAX)
     {
-        LOGT("%s: initialise update queue", __func__);
-        ds_dlist_init(&vif_update_queue, vif_state_update_entry_t, node);
-        vif_update_init_done = true;
+        LOGW("%s: index=%d out of range, updating now", __func__, ssid_index);
+        vif_state_update(ssid_index);
+        return;
     }
 
-    bool found = false;
-    ds_dlist_iter_t iter;
-    vif_state_update_entry_t *ptr = ds_dlist_ifirst(&iter, &vif_update_queue);
-    while (ptr)
+    if (!vif_defer.init)
     {
-        if (ssid_index == ptr->ssid_index)
+        LOGT("%s: initialise update wheel", __func__);
+        for (i = 0; i < VIF_DEFER_SLOTS; i++)
         {
-            found = true;
-            break;
+            ds_dlist_init(&vif_defer.slots[i], vif_defer_entry_t, node);
         }
-        ptr = ds_dlist_inext(&iter);
+        ev_timer_init(&vif_defer.timer, vif_defer_task, VIF_DEFER_TICK, VIF_DEFER_TICK);
+        vif_defer.init = true;
     }
-    if (found)
-    {
-        ev_timer_stop(wifihal_evloop, &ptr->defer_timer);
 
-        LOGI("%s: enforced update, index=%d", __func__, ssid_index);
-        vif_state_update(ptr->ssid_index);
+    now = ev_now(wifihal_evloop);
+    entry = &vif_defer.entries[ssid_index];
+    vif_defer.requests++;
 
-        LOGT("%s: reset existing update request, index=%d", __func__, ssid_index);
-        ev_timer_set(&ptr->defer_timer, CONFIG_RDK_VIF_STATE_UPDATE_DELAY, 0);
-        ev_timer_start(wifihal_evloop, &ptr->defer_timer);
+    if (vif_defer.num_pending == 0)
+    {
+        // The wheel is empty, restart it at the current time
+        vif_defer.base = now;
+        vif_defer.tick = 0;
+    }
+
+    if (!entry->pending)
+    {
+        entry->ssid_index = ssid_index;
+        entry->pending = true;
+        entry->first = now;
+        entry->requests = 0;
+        vif_defer.num_pending++;
     }
     else
     {
-        LOGT("%s: setup new update request, index=%d", __func__, ssid_index);
-        ptr = (vif_state_update_entry_t *)CALLOC(1, sizeof(*ptr));
-        ptr->ssid_index = ssid_index;
-        ds_dlist_insert_tail(&vif_update_queue, ptr);
+        ds_dlist_remove(&vif_defer.slots[entry->slot], entry);
+        LOGT("%s: coalesced with pending update, index=%d", __func__, ssid_index);
+    }
+
+    deadline = now + CONFIG_RDK_VIF_STATE_UPDATE_DELAY;
+    if (deadline > entry->first + CONFIG_RDK_VIF_STATE_UPDATE_MAX_DELAY)
+    {
+        deadline = entry->first + CONFIG_RDK_VIF_STATE_UPDATE_MAX_DELAY;
+    }
+    entry->deadline = deadline;
+    entry->requests++;
+    vif_defer_insert(entry);
 
-        ev_timer_init(&ptr->defer_timer, vif_state_update_task, CONFIG_RDK_VIF_STATE_UPDATE_DELAY, 0);
-        ev_timer_start(wifihal_evloop, &ptr->defer_timer);
+    if (!ev_is_active(&vif_defer.timer))
+    {
+        ev_timer_again(wifihal_evloop, &vif_defer.timer);
     }
+
     LOGT("%s: done, index=%d", __func__, ssid_index);
 }
 
+/*
+ * VAP changes are not pushed with one wifi_createVAP() per VAP. Changes for
+ * a radio that arrive within CONFIG_RDK_VIF_APPLY_BATCH_MS are collected in
+ * a per-radio map and applied with a single wifi_createVAP() call, so a bulk
+ * reconfiguration restarts the radio's VAPs once. If the batched call fails
+ * every VAP is retried on its own. The VIF state update of the batched VAPs
+ * is requested once they are applied.
+ */
+typedef struct
+{
+    wifi_vap_info_map_t     map;
+    ev_timer                timer;
+    bool                    timer_init;
+} vif_apply_batch_t;
+
+static vif_apply_batch_t vif_apply_batch[MAX_NUM_RADIOS];
+
+static void vif_apply_state_update(INT ssid_index)
+{
+    if (CONFIG_RDK_VIF_STATE_UPDATE_DELAY > 0)
+    {
+        vif_state_update_deferred(ssid_index);
+    }
+    else
+    {
+        LOGI("%s: instant update, index=%d", __func__, ssid_index);
+        vif_state_update(ssid_index);
+    }
+}
+
+static void vif_apply_batch_flush(UINT radio_index)
+{
+    vif_apply_batch_t *batch;
+    wifi_vap_info_map_t single;
+    UINT i;
+
+    if (radio_index >= MAX_NUM_RADIOS) return;
+    batch = &vif_apply_batch[radio_index];
+
+    if (batch->timer_init)
+    {
+        ev_timer_stop(wifihal_evloop, &batch->timer);
+    }
+    if (batch->map.num_vaps == 0) return;
+
+    LOGI("%s: applying %u VAP(s) on radio index %u", __func__, batch->map.num_vaps, radio_index);
+
+    if (wifi_createVAP(radio_index, &batch->map) != RETURN_OK)
+    {
+        LOGW("%s: batched apply failed on radio index %u, applying VAPs one by one",
+             __func__, radio_index);
+
+        for (i = 0; i < batch->map.num_vaps; i++)
+        {
+            memset(&single, 0, sizeof(single));
+            single.num_vaps = 1;
+            memcpy(&single.vap_array[0], &batch->map.vap_array[i], sizeof(wifi_vap_info_t));
+            if (wifi_createVAP(radio_index, &single) != RETURN_OK)
+            {
+                LOGW("Failed to apply SSID settings for index=%d", batch->map.vap_array[i].vap_index);
+            }
+        }
+    }
+    topology_invalidate();
+
+    // The state updates may look VAPs up again, so empty the batch first
+    memcpy(&single, &batch->map, sizeof(single));
+    memset(&batch->map, 0, sizeof(batch->map));
+
+    for (i = 0; i < single.num_vaps; i++)
+    {
+        vif_apply_state_update(single.vap_array[i].vap_index);
+    }
+}
+
+static void vif_apply_batch_task(struct ev_loop *loop, ev_timer *timer, int revents)
+{
+    vif_apply_batch_t *batch = (vif_apply_batch_t *)timer->data;
+
+    vif_apply_batch_flush((UINT)(batch - vif_apply_batch));
+}
+
+/* Overlay the pending, not yet applied settings of a VAP onto vap_info */
+static void vif_apply_batch_get(wifi_vap_info_t *vap_info)
+{
+    vif_apply_batch_t *batch;
+    UINT i;
+
+    if (vap_info->radio_index >= MAX_NUM_RADIOS) return;
+    batch = &vif_apply_batch[vap_info->radio_index];
+
+    for (i = 0; i < batch->map.num_vaps; i++)
+    {
+        if (batch->map.vap_array[i].vap_index == vap_info->vap_index)
+        {
+            memcpy(vap_info, &batch->map.vap_array[i], sizeof(*vap_info));
+            return;
+        }
+    }
+}
+
+/*
+ * Queue vap_info for a batched apply. Returns false if batching is disabled
+ * or not possible, the caller then applies the VAP right away.
+ */
+static bool vif_apply_batch_add(const wifi_vap_info_t *vap_info)
+{
+    vif_apply_batch_t *batch;
+    UINT i;
+
+    if (CONFIG_RDK_VIF_APPLY_BATCH_MS <= 0) return false;
+    if (vap_info->radio_index >= MAX_NUM_RADIOS) return false;
+    batch = &vif_apply_batch[vap_info->radio_index];
+
+    for (i = 0; i < batch->map.num_vaps; i++)
+    {
+        if (batch->map.vap_array[i].vap_index == vap_info->vap_index) break;
+    }
+    if (i == batch->map.num_vaps)
+    {
+        if (batch->map.num_vaps >= ARRAY_SIZE(batch->map.vap_array)) return false;
+        batch->map.num_vaps++;
+    }
+    memcpy(&batch->map.vap_array[i], vap_info, sizeof(*vap_info));
+
+    if (!batch->timer_init)
+    {
+        ev_timer_init(&batch->timer, vif_apply_batch_task, 0, 0);
+        batch->timer.data = batch;
+        batch->timer_init = true;
+    }
+    if (!ev_is_active(&batch->timer))
+    {
+        ev_timer_set(&batch->timer, CONFIG_RDK_VIF_APPLY_BATCH_MS / 1000.0, 0);
+        ev_timer_start(wifihal_evloop, &batch->timer);
+    }
+
+    LOGD("%s: queued index=%d on radio index %u (%u pending)", __func__,
+         vap_info->vap_index, vap_info->radio_index, batch->map.num_vaps);
+
+    return true;
+}
+
 bool vif_sta_config_set2(
         const struct schema_Wifi_VIF_Config *vconf,
         const struct schema_Wifi_Radio_Config *rconf,
@@ -1800,6 +1718,9 @@ bool vif_sta_config_set2(
 
     if (trigger_reconfig)
     {
+        // Keep the order of changes on the radio
+        vif_apply_batch_flush(vap_info->radio_index);
+
         memset(&vap_info_map_desired, 0, sizeof(vap_info_map_desired));
         vap_info_map_desired.num_vaps = 1;
         memcpy(&vap_info_map_desired.vap_array[0], vap_info, sizeof(wifi_vap_info_t));
@@ -1808,6 +1729,7 @@ bool vif_sta_config_set2(
         {
             LOGW("Failed to apply SSID settings for index=%d", ssid_index);
         }
+        topology_invalidate();
     }
 
     if (CONFIG_RDK_VIF_STATE_UPDATE_DELAY > 0)
@@ -1872,6 +1794,9 @@ bool target_vif_config_set2(
     }
     LOGT("Enter: %s (ssidx=%d)", __func__, ssid_index);
 
+    // Make sure the state following a config change is always reported
+    radio_state_shadow_invalidate(vconf->if_name);
+
     if (!ssid_index_to_vap_info((UINT)ssid_index, &vap_info_map_current, &vap_info)) return false;
 
     if (vap_info->vap_mode == wifi_vap_mode_sta)
@@ -1879,6 +1804,9 @@ bool target_vif_config_set2(
         return vif_sta_config_set2(vconf, rconf, cconfs, changed, num_cconfs);
     }
 
+    // Build on top of changes that are still waiting to be applied
+    vif_apply_batch_get(vap_info);
+
     if (changed->enabled)
     {
         vap_info->u.bss_info.enabled = vconf->enabled;
@@ -1982,6 +1910,12 @@ bool target_vif_config_set2(
         }
     }
 
+    if (trigger_reconfig && vif_apply_batch_add(vap_info))
+    {
+        // The state is updated once the batch is applied
+        return true;
+    }
+
     if (trigger_reconfig)
     {
         memset(&vap_info_map_desired, 0, sizeof(vap_info_map_desired));
@@ -1991,6 +1925,7 @@ bool target_vif_config_set2(
         {
             LOGW("Failed to apply SSID settings for index=%d", ssid_index);
         }
+        topology_invalidate();
     }
 
     if (CONFIG_RDK_VIF_STATE_UPDATE_DELAY > 0)
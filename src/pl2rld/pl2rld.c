@@ -71,6 +71,10 @@ typedef struct
     char                name[PL2RL_NAME_LEN];
     bool                registered;
 
+    // Receive buffer, may hold a partial message between wakeups
+    char                rbuf[PL2RLD_CLIENTS_BUF];
+    size_t              rlen;
+
     ds_dlist_node_t     dsl_node;
 } pclient_t;
 
@@ -93,8 +97,9 @@ bool            pl2rld_client_add(int fd);
 void            pl2rld_client_remove(pclient_t *pc);
 void            pl2rld_client_cleanup(void);
 void            pl2rld_client_recv(pclient_t *pc);
+bool            pl2rld_client_recv_msg(pclient_t *pc, pl2rl_msg_t *msg);
 void            pl2rld_client_recv_reg(pclient_t *pc, pl2rl_msg_t *msg);
-void            pl2rld_client_recv_log(pclient_t *pc, pl2rl_msg_t *msg, char *text);
+bool            pl2rld_client_recv_log(pclient_t *pc, pl2rl_msg_t *msg, char *text);
 void            pl2rld_client_accept_cb(struct ev_loop *loop, ev_io *evio, int revents);
 void            pl2rld_client_evio_cb(struct ev_loop *loop, ev_io *evio, int revents);
 
@@ -192,74 +197,108 @@ void pl2rld_client_evio_cb(struct ev_loop *loop, ev_io *evio, int revents)
     return;
 }
 
+/*
+ * Read everything that is available into the client buffer and dispatch
+ * all complete messages. A trailing partial message is kept in the buffer
+ * and completed on the next wakeup.
+ */
 void pl2rld_client_recv(pclient_t *pc)
 {
     pl2rl_msg_hdr_t     *hdr;
-    pl2rl_msg_t         *msg;
-    char                buf[PL2RLD_CLIENTS_BUF];
-    char                *text;
-    int                 hdr_len = sizeof(pl2rl_msg_hdr_t);
-    int                 rlen;
-    int                 ret;
+    size_t              hdr_len = sizeof(pl2rl_msg_hdr_t);
+    size_t              off;
+    ssize_t             ret;
 
-    // Read in header
-    ret = read(pc->fd, buf, hdr_len);
+    ret = read(pc->fd, pc->rbuf + pc->rlen, sizeof(pc->rbuf) - pc->rlen);
     if (ret < 0)
     {
-        if (errno == EAGAIN) {
+        if (errno == EAGAIN || errno == EINTR) {
             return;
         }
         LOGE("[fd %d] Error reading from client", pc->fd);
         pl2rld_client_remove(pc);
         return;
     }
-    else if (ret != hdr_len) {
-        LOGE("[fd %d] Malformed packet received", pc->fd);
+    else if (ret == 0)
+    {
+        LOGI("[fd %d] Client closed connection", pc->fd);
         pl2rld_client_remove(pc);
         return;
     }
+    pc->rlen += ret;
 
-    // Validate message type
-    hdr = (pl2rl_msg_hdr_t *)buf;
-    if (hdr->msg_type >= PL2RL_MSG_TYPE_MAX)
+    off = 0;
+    while (pc->rlen - off >= hdr_len)
     {
-        LOGE("[fd %d] Invalid message type received", pc->fd);
-        pl2rld_client_remove(pc);
-        return;
+        hdr = (pl2rl_msg_hdr_t *)(pc->rbuf + off);
+
+        // Validate header
+        if (hdr->msg_type >= PL2RL_MSG_TYPE_MAX)
+        {
+            LOGE("[fd %d] Invalid message type received", pc->fd);
+            pl2rld_client_remove(pc);
+            return;
+        }
+        if (hdr->length < hdr_len || hdr->length > sizeof(pc->rbuf))
+        {
+            LOGE("[fd %d] Malformed packet received, length %u", pc->fd, hdr->length);
+            pl2rld_client_remove(pc);
+            return;
+        }
+
+        // Wait for the rest of the message
+        if (pc->rlen - off < hdr->length) break;
+
+        if (!pl2rld_client_recv_msg(pc, (pl2rl_msg_t *)hdr))
+        {
+            // Client was removed
+            return;
+        }
+        off += hdr->length;
     }
 
-    // Read in rest of message
-    rlen = hdr->length - hdr_len;
-    ret = read(pc->fd, buf+hdr_len, rlen);
-    if (ret < 0)
+    // Move leftover partial message to the start of the buffer
+    if (off > 0)
     {
-        LOGE("[fd %d] Error reading data from client", pc->fd);
-        pl2rld_client_remove(pc);
-        return;
-    }
-    else if (ret != rlen) {
-        LOGE("[fd %d] Malformed data received", pc->fd);
-        pl2rld_client_remove(pc);
-        return;
+        pc->rlen -= off;
+        memmove(pc->rbuf, pc->rbuf + off, pc->rlen);
     }
 
-    // Handle message
-    msg = (pl2rl_msg_t *)buf;
+    return;
+}
+
+bool pl2rld_client_recv_msg(pclient_t *pc, pl2rl_msg_t *msg)
+{
+    size_t              hdr_len = sizeof(pl2rl_msg_hdr_t);
+    char                *text;
+
     switch (msg->hdr.msg_type)
     {
     case PL2RL_MSG_TYPE_REGISTER:
+        if (msg->hdr.length < hdr_len + sizeof(pl2rl_msg_reg_data_t))
+        {
+            LOGE("[fd %d] Malformed REGISTER message received", pc->fd);
+            pl2rld_client_remove(pc);
+            return false;
+        }
         pl2rld_client_recv_reg(pc, msg);
         break;
 
     case PL2RL_MSG_TYPE_LOG:
-        // Set text pointer
         hdr_len += sizeof(pl2rl_msg_log_data_t);
-        text = (char *)buf + hdr_len;
-        pl2rld_client_recv_log(pc, msg, text);
-        break;
+        if (msg->hdr.length < hdr_len ||
+            msg->data.log.text_len > msg->hdr.length - hdr_len)
+        {
+            LOGE("[fd %d] Malformed LOG message received", pc->fd);
+            pl2rld_client_remove(pc);
+            return false;
+        }
+        // Set text pointer
+        text = (char *)msg + hdr_len;
+        return pl2rld_client_recv_log(pc, msg, text);
     }
 
-    return;
+    return true;
 }
 
 void pl2rld_client_recv_reg(pclient_t *pc, pl2rl_msg_t *msg)
@@ -274,7 +313,7 @@ void pl2rld_client_recv_reg(pclient_t *pc, pl2rl_msg_t *msg)
     return;
 }
 
-void pl2rld_client_recv_log(pclient_t *pc, pl2rl_msg_t *msg, char *text)
+bool pl2rld_client_recv_log(pclient_t *pc, pl2rl_msg_t *msg, char *text)
 {
     uint32_t            rdk_level = RDK_LOG_DEBUG;
     char                *sev;
@@ -284,7 +323,7 @@ void pl2rld_client_recv_log(pclient_t *pc, pl2rl_msg_t *msg, char *text)
     {
         LOGE("[fd %d] Received LOG message before registration", pc->fd);
         pl2rld_client_remove(pc);
-        return;
+        return false;
     }
 
     LOGT("[fd %d] Received LOG, sev %u, module %u, len %u, \"%.*s\"",
@@ -343,7 +382,7 @@ void pl2rld_client_recv_log(pclient_t *pc, pl2rl_msg_t *msg, char *text)
             msg->data.log.text_len,
             text);
 
-    return;
+    return true;
 }
 
 bool pl2rld_client_listener_init(const char *spath)
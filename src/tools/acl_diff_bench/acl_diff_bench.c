@@ -0,0 +1,171 @@
+/*
+Copyright (c) 2017, Plume Design Inc. All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+   1. Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+   2. Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+   3. Neither the name of the Plume Design Inc. nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL Plume Design Inc. BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+/*
+ * acl_diff_bench - cost of applying VAP ACL changes against the wifi_hal mock
+ *
+ * Applies a sequence of ACLs of the given sizes to one VAP through
+ * acl_hal_apply_list(): the initial list, the same list again, the list
+ * with a tenth and with half of its entries replaced, and an empty list.
+ * After each step the ACL read back from the HAL must match the applied
+ * list.
+ *
+ *     acl_diff_bench <ssid_index> [entries...]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "log.h"
+#include "target.h"
+#include "target_internal.h"
+
+static int          bench_failed;
+
+#define BENCH_CHECK(cond)                                                   \
+    do {                                                                    \
+        if (!(cond))                                                        \
+        {                                                                   \
+            fprintf(stderr, "%s:%d: check failed: %s\n",                    \
+                    __FILE__, __LINE__, #cond);                             \
+            bench_failed++;                                                 \
+        }                                                                   \
+    } while (0)
+
+static uint64_t bench_now_usec(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static int bench_mac_cmp(const void *a, const void *b)
+{
+    return memcmp(a, b, sizeof(mac_address_t));
+}
+
+// Entries first to first + num - 1 of the MAC range
+static void bench_list(mac_address_t *list, UINT first, UINT num)
+{
+    UINT i;
+
+    for (i = 0; i < num; i++)
+    {
+        list[i][0] = 0x02;
+        list[i][1] = 0xcc;
+        list[i][2] = 0x00;
+        list[i][3] = ((first + i) >> 16) & 0xff;
+        list[i][4] = ((first + i) >> 8) & 0xff;
+        list[i][5] = (first + i) & 0xff;
+    }
+}
+
+// Apply the list and check what the HAL has afterwards, returns the time taken
+static uint64_t bench_apply(INT ssid_index, mac_address_t *list, UINT num)
+{
+    mac_address_t *acl = NULL;
+    UINT acl_num = 0;
+    uint64_t start;
+    uint64_t usec;
+
+    start = bench_now_usec();
+    BENCH_CHECK(acl_hal_apply_list(ssid_index, "bench", true, list, num));
+    usec = bench_now_usec() - start;
+
+    BENCH_CHECK(acl_hal_get(ssid_index, &acl, &acl_num));
+    BENCH_CHECK(acl_num == num);
+    if (acl_num == num && num > 0)
+    {
+        qsort(acl, acl_num, sizeof(mac_address_t), bench_mac_cmp);
+        BENCH_CHECK(memcmp(acl, list, num * sizeof(mac_address_t)) == 0);
+    }
+    free(acl);
+
+    return usec;
+}
+
+static void bench_run(INT ssid_index, UINT num)
+{
+    mac_address_t *list;
+    uint64_t initial;
+    uint64_t unchanged;
+    uint64_t tenth;
+    uint64_t half;
+    uint64_t empty;
+
+    list = calloc(num + 1, sizeof(mac_address_t));
+
+    bench_apply(ssid_index, NULL, 0);
+
+    bench_list(list, 0, num);
+    initial = bench_apply(ssid_index, list, num);
+    unchanged = bench_apply(ssid_index, list, num);
+
+    bench_list(list, num / 10, num);
+    tenth = bench_apply(ssid_index, list, num);
+
+    bench_list(list, num / 10 + num / 2, num);
+    half = bench_apply(ssid_index, list, num);
+
+    empty = bench_apply(ssid_index, NULL, 0);
+
+    printf("%6u entries: initial %.2f ms, unchanged %.2f ms, 10%% replaced %.2f ms, "
+           "50%% replaced %.2f ms, emptied %.2f ms\n",
+           num, initial / 1000.0, unchanged / 1000.0, tenth / 1000.0,
+           half / 1000.0, empty / 1000.0);
+
+    free(list);
+}
+
+int main(int argc, char *argv[])
+{
+    static const UINT default_entries[] = { 1000, 5000 };
+    INT ssid_index;
+    int i;
+
+    if (argc < 2)
+    {
+        fprintf(stderr, "usage: %s <ssid_index> [entries...]\n", argv[0]);
+        return 2;
+    }
+    ssid_index = atoi(argv[1]);
+
+    if (argc > 2)
+    {
+        for (i = 2; i < argc; i++) bench_run(ssid_index, strtoul(argv[i], NULL, 0));
+    }
+    else
+    {
+        for (i = 0; i < (int)ARRAY_SIZE(default_entries); i++) bench_run(ssid_index, default_entries[i]);
+    }
+
+    printf("acl_diff_bench: %d failure(s)\n", bench_failed);
+
+    return bench_failed ? 1 : 0;
+}
@@ -0,0 +1,268 @@
+/*
+Copyright (c) 2017, Plume Design Inc. All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+   1. Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+   2. Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+   3. Neither the name of the Plume Design Inc. nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL Plume Design Inc. BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+/*
+ * bsal_ies_test - off-target check of the association request IE parser
+ *
+ * Runs bsal_parse_assoc_ies() on a known capability set, on every truncation
+ * of it, on zero-length and short elements, and on random buffers. Every
+ * buffer is placed right in front of an inaccessible page, so a read past
+ * its end crashes the test instead of going unnoticed.
+ *
+ *     bsal_ies_test [iterations] [seed]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#include "log.h"
+#include "target.h"
+#include "target_internal.h"
+#include "bm_ieee80211.h"
+
+#define TEST_BUF_MAX            512
+#define TEST_ITERATIONS         1000000
+
+static uint8_t     *test_guard;
+static size_t       test_page;
+static int          test_failed;
+
+#define TEST_CHECK(cond)                                                    \
+    do {                                                                    \
+        if (!(cond))                                                        \
+        {                                                                   \
+            fprintf(stderr, "%s:%d: check failed: %s\n",                    \
+                    __FILE__, __LINE__, #cond);                             \
+            test_failed++;                                                  \
+        }                                                                   \
+    } while (0)
+
+/*
+ * HT, VHT, Extended Capabilities (BTM), RM Enabled Capabilities, Power
+ * Capability and HE Capabilities of a 2x2 160 MHz client
+ */
+static const uint8_t test_ies[] =
+{
+    WLAN_EID_HT_CAP, 26,
+        0x02, 0x00, 0x00, 0xff, 0xff, 0x00, 0x00, 0x00, 0x00, 0x00,
+        0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+        0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    WLAN_EID_VHT_CAP, 12,
+        0x00, 0x00, 0x00, 0x00, 0xfa, 0xff, 0x00, 0x00, 0xfa, 0xff,
+        0x00, 0x00,
+    WLAN_EID_EXT_CAPAB, 3,
+        0x00, 0x00, 0x08,
+    WLAN_EID_RRM_ENABLED_CAPABILITIES, 5,
+        0x33, 0x00, 0x00, 0x00, 0x04,
+    WLAN_EID_PWR_CAPABILITY, 2,
+        0x00, 0x14,
+    WLAN_EID_EXTENSION, 22, WLAN_EID_EXT_HE_CAPABILITIES,
+        0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+        0x0e, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+        0xfa, 0xff, 0xfa, 0xff,
+};
+
+// Element IDs the parser looks at, used to bias the random buffers
+static const uint8_t test_eids[] =
+{
+    WLAN_EID_HT_CAP,
+    WLAN_EID_VHT_CAP,
+    WLAN_EID_EXT_CAPAB,
+    WLAN_EID_RRM_ENABLED_CAPABILITIES,
+    WLAN_EID_PWR_CAPABILITY,
+    WLAN_EID_EXTENSION,
+    WLAN_EID_EXT_HE_CAPABILITIES,
+};
+
+/*****************************************************************************/
+
+static bool test_guard_init(void)
+{
+    test_page = (size_t)sysconf(_SC_PAGESIZE);
+    test_guard = mmap(NULL, 2 * test_page, PROT_READ | PROT_WRITE,
+                      MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (test_guard == MAP_FAILED) return false;
+
+    return mprotect(test_guard + test_page, test_page, PROT_NONE) == 0;
+}
+
+static void test_parse(bsal_client_info_t *info, const uint8_t *ies, size_t len)
+{
+    // The last byte of the buffer is the last accessible byte
+    uint8_t *buf = test_guard + test_page - len;
+
+    memcpy(buf, ies, len);
+    memset(info, 0xa5, sizeof(*info));
+    bsal_parse_assoc_ies(info, len > 0 ? buf : NULL, len);
+}
+
+static void test_known(void)
+{
+    bsal_client_info_t info;
+
+    test_parse(&info, test_ies, sizeof(test_ies));
+
+    TEST_CHECK(info.is_BTM_supported);
+    TEST_CHECK(info.is_RRM_supported);
+    TEST_CHECK(info.rrm_caps.link_meas);
+    TEST_CHECK(info.rrm_caps.ftm_range_rpt);
+    TEST_CHECK(info.datarate_info.max_chwidth == 3);
+    TEST_CHECK(info.datarate_info.max_streams == 2);
+    TEST_CHECK(info.datarate_info.max_MCS == 11);
+    TEST_CHECK(info.datarate_info.max_txpower == 0x14);
+}
+
+static void test_truncated(void)
+{
+    bsal_client_info_t info;
+    size_t len;
+
+    for (len = 0; len <= sizeof(test_ies); len++)
+    {
+        test_parse(&info, test_ies, len);
+    }
+
+    // Nothing at all: a legacy client
+    test_parse(&info, test_ies, 0);
+    TEST_CHECK(!info.is_BTM_supported);
+    TEST_CHECK(!info.is_RRM_supported);
+    TEST_CHECK(info.datarate_info.max_streams == 0);
+}
+
+static void test_short_elements(void)
+{
+    bsal_client_info_t info;
+    uint8_t ies[TEST_BUF_MAX];
+    size_t i;
+    size_t n;
+    uint8_t len;
+
+    // Zero-length extension element, and one with only the extension ID
+    ies[0] = WLAN_EID_EXTENSION;
+    ies[1] = 0;
+    test_parse(&info, ies, 2);
+
+    ies[1] = 1;
+    ies[2] = WLAN_EID_EXT_HE_CAPABILITIES;
+    test_parse(&info, ies, 3);
+    TEST_CHECK(info.datarate_info.max_streams == 0);
+
+    // Every handled element with every length up to one past its minimum,
+    // the element ending the buffer
+    for (i = 0; i < sizeof(test_eids); i++)
+    {
+        for (len = 0; len <= 32; len++)
+        {
+            n = 0;
+            ies[n++] = test_eids[i];
+            ies[n++] = len;
+            memset(&ies[n], 0xff, len);
+            n += len;
+            test_parse(&info, ies, n);
+
+            // Length running past the end of the buffer
+            test_parse(&info, ies, n - (len > 0 ? 1 : 0));
+        }
+    }
+
+    // Same for the HE Capabilities extension element
+    for (len = 1; len <= 32; len++)
+    {
+        n = 0;
+        ies[n++] = WLAN_EID_EXTENSION;
+        ies[n++] = len;
+        ies[n++] = WLAN_EID_EXT_HE_CAPABILITIES;
+        memset(&ies[n], 0xff, len - 1);
+        n += len - 1;
+        test_parse(&info, ies, n);
+        test_parse(&info, ies, n - 1);
+    }
+}
+
+static void test_random(unsigned long iterations)
+{
+    bsal_client_info_t info;
+    uint8_t ies[TEST_BUF_MAX];
+    unsigned long k;
+    size_t len;
+    size_t i;
+
+    for (k = 0; k < iterations; k++)
+    {
+        len = (size_t)rand() % sizeof(ies);
+        for (i = 0; i < len; i++)
+        {
+            int r = rand();
+
+            // Favor element IDs and short lengths the parser cares about
+            if (r & 1)
+            {
+                ies[i] = test_eids[(r >> 1) % sizeof(test_eids)];
+            }
+            else if (r & 2)
+            {
+                ies[i] = (r >> 2) % 32;
+            }
+            else
+            {
+                ies[i] = r >> 2;
+            }
+        }
+
+        test_parse(&info, ies, len);
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    unsigned long iterations = TEST_ITERATIONS;
+    unsigned int seed = 1;
+
+    if (argc > 1) iterations = strtoul(argv[1], NULL, 0);
+    if (argc > 2) seed = (unsigned int)strtoul(argv[2], NULL, 0);
+
+    if (!test_guard_init())
+    {
+        fprintf(stderr, "bsal_ies_test: cannot set up the guard page\n");
+        return 2;
+    }
+
+    srand(seed);
+
+    test_known();
+    test_truncated();
+    test_short_elements();
+    test_random(iterations);
+
+    printf("bsal_ies_test: %lu random buffers (seed %u), %d failure(s)\n",
+           iterations, seed, test_failed);
+
+    return test_failed ? 1 : 0;
+}
@@ -0,0 +1,258 @@
+/*
+Copyright (c) 2017, Plume Design Inc. All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+   1. Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+   2. Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+   3. Neither the name of the Plume Design Inc. nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL Plume Design Inc. BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+/*
+ * dhcp_lease_bench - lease file processing cost of the DHCPv4 server
+ *
+ * Generates dnsmasq lease files of the given sizes and times the handling
+ * of a lease file change: the initial parse of a new file, a rewrite that
+ * leaves every lease as it was, and a rewrite that renews a single lease.
+ * Every eighth lease has an overlong hostname, fingerprint and client-id,
+ * all of them are expected to be kept. The result of each pass (reported
+ * lease count and number of status updates) is checked along the way.
+ *
+ *     dhcp_lease_bench [passes] [leases...]
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+#include <limits.h>
+
+#include "kconfig.h"
+
+/* Point the DHCP server at the generated lease file */
+static char bench_lease_path[PATH_MAX];
+
+#undef CONFIG_RDK_DHCP_LEASES_PATH
+#define CONFIG_RDK_DHCP_LEASES_PATH bench_lease_path
+
+#include "osn_dhcps.c"
+
+#define BENCH_PASSES            20
+#define BENCH_LEASE_TIME        1700000000
+#define BENCH_LONG_EVERY        8
+
+static int          bench_failed;
+static int          bench_status_calls;
+static int          bench_status_leases;
+
+#define BENCH_CHECK(cond)                                                   \
+    do {                                                                    \
+        if (!(cond))                                                        \
+        {                                                                   \
+            fprintf(stderr, "%s:%d: check failed: %s\n",                    \
+                    __FILE__, __LINE__, #cond);                             \
+            bench_failed++;                                                 \
+        }                                                                   \
+    } while (0)
+
+static uint64_t bench_now_usec(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static void bench_status_fn(osn_dhcp_server_t *ds, struct osn_dhcp_server_status *st)
+{
+    (void)ds;
+
+    bench_status_calls++;
+    bench_status_leases = st->ds_leases_len;
+}
+
+/*
+ * Write a lease file with the given number of leases, lease renewed gets
+ * a later expiry time
+ */
+static bool bench_write(int leases, int renewed, int renew_time)
+{
+    char hostname[128];
+    char fingerprint[512];
+    char cid[800];
+    FILE *f;
+    int i;
+    int k;
+
+    f = fopen(bench_lease_path, "w");
+    if (f == NULL) return false;
+
+    for (i = 0; i < leases; i++)
+    {
+        if (i % BENCH_LONG_EVERY == 0)
+        {
+            // Longer than the lease fields, CID of 255 bytes
+            memset(hostname, 'h', sizeof(hostname) - 1);
+            hostname[sizeof(hostname) - 1] = '\0';
+            for (k = 0; k + 3 < (int)sizeof(fingerprint); k += 3) memcpy(&fingerprint[k], "12,", 3);
+            fingerprint[k - 1] = '\0';
+            for (k = 0; k < 255; k++) sprintf(&cid[k * 3], "%02x:", k);
+            cid[k * 3 - 1] = '\0';
+        }
+        else
+        {
+            snprintf(hostname, sizeof(hostname), "client-%d", i);
+            STRSCPY(fingerprint, "1,33,3,6,15,28,51,58,59");
+            snprintf(cid, sizeof(cid), "01:02:00:00:%02x:%02x:%02x",
+                     (i >> 16) & 0xff, (i >> 8) & 0xff, i & 0xff);
+        }
+
+        fprintf(f, "%d 02:00:00:%02x:%02x:%02x 10.%d.%d.%d %s %s \"%s\" %s\n",
+                BENCH_LEASE_TIME + (i == renewed ? renew_time : 0),
+                (i >> 16) & 0xff, (i >> 8) & 0xff, i & 0xff,
+                (i >> 16) & 0xff, (i >> 8) & 0xff, i & 0xff,
+                hostname, fingerprint, "android-dhcp-13", cid);
+    }
+
+    return fclose(f) == 0;
+}
+
+/*
+ * Handle a lease file change, returns the time spent in microseconds
+ */
+static uint64_t bench_onchange(bool exists)
+{
+    ev_stat w;
+    uint64_t start;
+
+    memset(&w, 0, sizeof(w));
+    w.attr.st_nlink = exists ? 1 : 0;
+
+    bench_status_calls = 0;
+
+    start = bench_now_usec();
+    dhcp_lease_onchange(EV_DEFAULT, &w, 0);
+    return bench_now_usec() - start;
+}
+
+static void bench_check_long(osn_dhcp_server_t *ds)
+{
+    struct osn_dhcp_server_lease *dl;
+    int i;
+
+    // Lease 0 has the overlong fields, leases are ordered by MAC address
+    dl = &ds->ds_status.ds_leases[0];
+    BENCH_CHECK(ds->ds_status.ds_leases_len > 0);
+    BENCH_CHECK(strlen(dl->dl_hostname) == sizeof(dl->dl_hostname) - 1);
+    BENCH_CHECK(strlen(dl->dl_fingerprint) == sizeof(dl->dl_fingerprint) - 1);
+
+    for (i = 1; i < ds->ds_status.ds_leases_len && i < BENCH_LONG_EVERY; i++)
+    {
+        BENCH_CHECK(strncmp(ds->ds_status.ds_leases[i].dl_hostname, "client-", 7) == 0);
+    }
+}
+
+static void bench_run(osn_dhcp_server_t *ds, int leases, int passes)
+{
+    uint64_t initial;
+    uint64_t unchanged = 0;
+    uint64_t renewed = 0;
+    int i;
+
+    if (!bench_write(leases, -1, 0))
+    {
+        fprintf(stderr, "dhcp_lease_bench: cannot write %s\n", bench_lease_path);
+        bench_failed++;
+        return;
+    }
+
+    initial = bench_onchange(true);
+    BENCH_CHECK(bench_status_calls == 1);
+    BENCH_CHECK(bench_status_leases == leases);
+    bench_check_long(ds);
+
+    for (i = 0; i < passes; i++)
+    {
+        bench_write(leases, -1, 0);
+        unchanged += bench_onchange(true);
+        BENCH_CHECK(bench_status_calls == 0);
+    }
+
+    for (i = 0; i < passes; i++)
+    {
+        bench_write(leases, i % leases, 3600 + i);
+        renewed += bench_onchange(true);
+        BENCH_CHECK(bench_status_calls == 1);
+        BENCH_CHECK(bench_status_leases == leases);
+    }
+
+    printf("%6d leases: initial %.2f ms, unchanged %.2f ms, one renewed %.2f ms (avg of %d)\n",
+           leases, initial / 1000.0, unchanged / 1000.0 / passes, renewed / 1000.0 / passes, passes);
+
+    // Lease file removed, start over for the next size
+    bench_onchange(false);
+    BENCH_CHECK(bench_status_calls == 1);
+    BENCH_CHECK(bench_status_leases == 0);
+}
+
+int main(int argc, char *argv[])
+{
+    static const int default_leases[] = { 1000, 5000 };
+    osn_dhcp_server_t *ds;
+    int passes = BENCH_PASSES;
+    int fd;
+    int i;
+
+    if (argc > 1) passes = atoi(argv[1]);
+    if (passes < 1) passes = 1;
+
+    snprintf(bench_lease_path, sizeof(bench_lease_path), "/tmp/dhcp_lease_bench.XXXXXX");
+    fd = mkstemp(bench_lease_path);
+    if (fd < 0)
+    {
+        fprintf(stderr, "dhcp_lease_bench: cannot create the lease file\n");
+        return 2;
+    }
+    close(fd);
+
+    ds = osn_dhcp_server_new("br-home");
+    if (ds == NULL)
+    {
+        unlink(bench_lease_path);
+        return 2;
+    }
+    osn_dhcp_server_status_notify(ds, bench_status_fn);
+
+    if (argc > 2)
+    {
+        for (i = 2; i < argc; i++) bench_run(ds, atoi(argv[i]), passes);
+    }
+    else
+    {
+        for (i = 0; i < (int)ARRAY_SIZE(default_leases); i++) bench_run(ds, default_leases[i], passes);
+    }
+
+    unlink(bench_lease_path);
+
+    printf("dhcp_lease_bench: %d failure(s)\n", bench_failed);
+
+    return bench_failed ? 1 : 0;
+}
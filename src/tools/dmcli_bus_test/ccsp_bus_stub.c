@@ -0,0 +1,203 @@
+/*
+Copyright (c) 2017, Plume Design Inc. All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+   1. Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+   2. Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+   3. Neither the name of the Plume Design Inc. nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL Plume Design Inc. BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+/*
+ * ccsp_bus_stub.c
+ *
+ * Offline CCSP message bus: enough of the registrar and component side of
+ * CcspBaseIf_* to drive dmcli_bus.c without a running CCSP stack.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <ccsp/ansc_platform.h>
+#include <ccsp/ccsp_message_bus.h>
+#include <ccsp/ccsp_base_api.h>
+
+#include "ccsp_bus_stub.h"
+
+#define CCSP_BUS_STUB_FAILURE       190     // Any value other than success
+
+typedef struct
+{
+    char        *comp;
+    char        *name;
+    char        *value;
+} ccsp_bus_stub_param_t;
+
+static ccsp_bus_stub_param_t    stub_params[CCSP_BUS_STUB_MAX_PARAMS];
+static int                      stub_num_params;
+static bool                     stub_up;
+static ccsp_bus_stub_stats_t    stub_stats;
+static int                      stub_handle;
+
+void ccsp_bus_stub_up(bool up)
+{
+    stub_up = up;
+}
+
+bool ccsp_bus_stub_add(const char *comp, const char *name, const char *value)
+{
+    ccsp_bus_stub_param_t *p;
+
+    if (stub_num_params >= CCSP_BUS_STUB_MAX_PARAMS) return false;
+
+    p = &stub_params[stub_num_params++];
+    p->comp = strdup(comp);
+    p->name = strdup(name);
+    p->value = strdup(value);
+
+    return true;
+}
+
+void ccsp_bus_stub_stats(ccsp_bus_stub_stats_t *stats)
+{
+    *stats = stub_stats;
+}
+
+void *Ansc_AllocateMemory_Callback(unsigned long size)
+{
+    return calloc(1, size);
+}
+
+void Ansc_FreeMemory_Callback(void *ptr)
+{
+    free(ptr);
+}
+
+int CCSP_Message_Bus_Init(
+        char *component_id,
+        char *config_file,
+        void **bus_handle,
+        CCSP_MESSAGE_BUS_MALLOC mallocfc,
+        CCSP_MESSAGE_BUS_FREE freefc)
+{
+    stub_stats.inits++;
+    if (!stub_up) return CCSP_BUS_STUB_FAILURE;
+
+    *bus_handle = &stub_handle;
+    return 0;
+}
+
+int CcspBaseIf_discComponentSupportingNamespace(
+        void *bus_handle,
+        const char *dst_component_id,
+        const char *name_space,
+        const char *subsystem_prefix,
+        componentStruct_t ***components,
+        int *size)
+{
+    componentStruct_t *comp;
+    int i;
+
+    stub_stats.discoveries++;
+    *components = NULL;
+    *size = 0;
+
+    if (!stub_up || bus_handle != &stub_handle) return CCSP_BUS_STUB_FAILURE;
+
+    for (i = 0; i < stub_num_params; i++)
+    {
+        if (strncmp(stub_params[i].name, name_space, strlen(name_space)) != 0) continue;
+
+        comp = calloc(1, sizeof(*comp));
+        comp->componentName = strdup(stub_params[i].comp);
+        comp->dbusPath = strdup("/com/cisco/spvtg/ccsp/stub");
+
+        *components = calloc(1, sizeof(**components));
+        (*components)[0] = comp;
+        *size = 1;
+        return CCSP_SUCCESS;
+    }
+
+    return CCSP_BUS_STUB_FAILURE;
+}
+
+void free_componentStruct_t(void *bus_handle, int size, componentStruct_t **val)
+{
+    int i;
+
+    for (i = 0; i < size; i++)
+    {
+        free(val[i]->componentName);
+        free(val[i]->dbusPath);
+        free(val[i]);
+    }
+    free(val);
+}
+
+int CcspBaseIf_getParameterValues(
+        void *bus_handle,
+        const char *dst_component_id,
+        char *dbus_path,
+        char *parameterNames[],
+        int param_size,
+        int *val_size,
+        parameterValStruct_t ***val)
+{
+    parameterValStruct_t *v;
+    int i;
+    int j;
+
+    stub_stats.gets++;
+    stub_stats.params += param_size;
+    *val = NULL;
+    *val_size = 0;
+
+    if (!stub_up || bus_handle != &stub_handle) return CCSP_BUS_STUB_FAILURE;
+
+    *val = calloc(param_size, sizeof(**val));
+    for (i = 0; i < param_size; i++)
+    {
+        for (j = 0; j < stub_num_params; j++)
+        {
+            if (strcmp(stub_params[j].comp, dst_component_id) != 0) continue;
+            if (strcmp(stub_params[j].name, parameterNames[i]) != 0) continue;
+
+            v = calloc(1, sizeof(*v));
+            v->parameterName = strdup(stub_params[j].name);
+            v->parameterValue = strdup(stub_params[j].value);
+            (*val)[(*val_size)++] = v;
+            break;
+        }
+    }
+
+    return CCSP_Message_Bus_OK;
+}
+
+void free_parameterValStruct_t(void *bus_handle, int size, parameterValStruct_t **val)
+{
+    int i;
+
+    for (i = 0; i < size; i++)
+    {
+        free(val[i]->parameterName);
+        free(val[i]->parameterValue);
+        free(val[i]);
+    }
+    free(val);
+}
@@ -0,0 +1,52 @@
+/*
+Copyright (c) 2017, Plume Design Inc. All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+   1. Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+   2. Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+   3. Neither the name of the Plume Design Inc. nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL Plume Design Inc. BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef CCSP_BUS_STUB_H_INCLUDED
+#define CCSP_BUS_STUB_H_INCLUDED
+
+#include <stdbool.h>
+
+/*
+ * Stand-in for the parts of libccsp_common used by the dmcli bus backend.
+ * Parameters are registered with the component that serves them, the
+ * registrar answers namespace lookups from the same table.
+ */
+
+#define CCSP_BUS_STUB_MAX_PARAMS    32
+
+typedef struct
+{
+    unsigned int    inits;          // CCSP_Message_Bus_Init() calls
+    unsigned int    discoveries;    // Namespace lookups at the registrar
+    unsigned int    gets;           // CcspBaseIf_getParameterValues() calls
+    unsigned int    params;         // Parameters requested by those calls
+} ccsp_bus_stub_stats_t;
+
+extern void     ccsp_bus_stub_up(bool up);
+extern bool     ccsp_bus_stub_add(const char *comp, const char *name, const char *value);
+extern void     ccsp_bus_stub_stats(ccsp_bus_stub_stats_t *stats);
+
+#endif /* CCSP_BUS_STUB_H_INCLUDED */
@@ -0,0 +1,158 @@
+/*
+Copyright (c) 2017, Plume Design Inc. All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+   1. Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+   2. Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+   3. Neither the name of the Plume Design Inc. nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL Plume Design Inc. BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+/*
+ * dmcli_bus_test - offline check of the dmcli CCSP bus backend
+ *
+ * Drives dmcli_eRT_getv_multi() against ccsp_bus_stub.c. popen() and time()
+ * are replaced by this file, so the dmcli tool fallbacks are counted rather
+ * than run, and the bus reconnect backoff can be stepped over.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <stdbool.h>
+#include <errno.h>
+#include <time.h>
+
+#include "kconfig.h"
+#include "dmcli.h"
+#include "ccsp_bus_stub.h"
+
+#define TEST_COMP_PAM           "eRT.com.cisco.spvtg.ccsp.pam"
+#define TEST_VALUE_LEN          64
+
+static unsigned int     test_popens;
+static time_t           test_now = 1000;
+static int              test_failed;
+
+#define TEST_CHECK(cond)                                                    \
+    do {                                                                    \
+        if (!(cond))                                                        \
+        {                                                                   \
+            fprintf(stderr, "%s:%d: check failed: %s\n",                    \
+                    __FILE__, __LINE__, #cond);                             \
+            test_failed++;                                                  \
+        }                                                                   \
+    } while (0)
+
+// The dmcli tool is not there, count the attempts to spawn it
+FILE *popen(const char *command, const char *type)
+{
+    test_popens++;
+    errno = ENOENT;
+    return NULL;
+}
+
+time_t time(time_t *t)
+{
+    if (t != NULL) *t = test_now;
+    return test_now;
+}
+
+/*
+ * Same request as osp_unit_cache_fill(): the wanted parameter plus the other
+ * unit parameters as bus only prefetches
+ */
+static int test_unit_fill(int want, bool *valid)
+{
+    static const char *paths[] =
+    {
+        DMCLI_ERT_SERIAL_NUM,
+        DMCLI_ERT_CM_MAC,
+        DMCLI_ERT_MODEL_NUM,
+        DMCLI_ERT_SOFTWARE_VER,
+    };
+    char values[4][TEST_VALUE_LEN];
+    dmcli_param_t params[4];
+    int n;
+    int i;
+
+    for (i = 0; i < 4; i++)
+    {
+        params[i] = (dmcli_param_t) {
+            .path = paths[i],
+            .dest = values[i],
+            .destsz = sizeof(values[i]),
+            .bus_only = (i != want),
+        };
+    }
+
+    n = dmcli_eRT_getv_multi(params, 4);
+    for (i = 0; i < 4; i++) valid[i] = params[i].valid;
+
+    return n;
+}
+
+int main(void)
+{
+    ccsp_bus_stub_stats_t stats;
+    char value[TEST_VALUE_LEN];
+    bool valid[4];
+
+    ccsp_bus_stub_add(TEST_COMP_PAM, DMCLI_ERT_SERIAL_NUM, "SN0123456789");
+    ccsp_bus_stub_add(TEST_COMP_PAM, DMCLI_ERT_CM_MAC, "00:11:22:33:44:55");
+    ccsp_bus_stub_add(TEST_COMP_PAM, DMCLI_ERT_MODEL_NUM, "CGM4331COM");
+    ccsp_bus_stub_add(TEST_COMP_PAM, DMCLI_ERT_SOFTWARE_VER, "rdkb-2024q1");
+
+    // Bus not up yet: only the wanted parameter falls back to the tool
+    ccsp_bus_stub_up(false);
+    TEST_CHECK(test_unit_fill(0, valid) == 0);
+    TEST_CHECK(test_popens == 1);
+
+    // Within the reconnect backoff no new connect attempt is made
+    TEST_CHECK(test_unit_fill(2, valid) == 0);
+    TEST_CHECK(test_popens == 2);
+    ccsp_bus_stub_stats(&stats);
+    TEST_CHECK(stats.inits == 1);
+
+    // Bus up: one lookup and one get for all four, no tool spawned
+    ccsp_bus_stub_up(true);
+    test_now += 60;
+    TEST_CHECK(test_unit_fill(0, valid) == 4);
+    TEST_CHECK(valid[0] && valid[1] && valid[2] && valid[3]);
+    TEST_CHECK(test_popens == 2);
+    ccsp_bus_stub_stats(&stats);
+    TEST_CHECK(stats.inits == 2);
+    TEST_CHECK(stats.discoveries == 1);
+    TEST_CHECK(stats.gets == 1);
+    TEST_CHECK(stats.params == 4);
+
+    // Owner of Device.DeviceInfo. is cached
+    TEST_CHECK(dmcli_eRT_getv(DMCLI_ERT_MODEL_NUM, value, sizeof(value), false));
+    TEST_CHECK(strcmp(value, "CGM4331COM") == 0);
+    ccsp_bus_stub_stats(&stats);
+    TEST_CHECK(stats.discoveries == 1);
+    TEST_CHECK(stats.gets == 2);
+
+    // Unknown to the bus: falls back to the tool
+    TEST_CHECK(!dmcli_eRT_getv("Device.X_TEST.Unknown", value, sizeof(value), false));
+    TEST_CHECK(test_popens == 3);
+
+    printf("dmcli_bus_test: %d failure(s)\n", test_failed);
+
+    return test_failed ? 1 : 0;
+}
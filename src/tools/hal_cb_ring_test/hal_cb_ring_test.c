@@ -0,0 +1,276 @@
+/*
+Copyright (c) 2017, Plume Design Inc. All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+   1. Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+   2. Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+   3. Neither the name of the Plume Design Inc. nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL Plume Design Inc. BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+/*
+ * hal_cb_ring_test - producer thread hammer of the HAL association event ring
+ *
+ * Starts a number of producer threads that push numbered association events
+ * through clients_hal_assocdev_cb(), the callback the HAL calls from its own
+ * threads, while the main thread drains the ring the way the event loop does.
+ * Each event carries its producer and sequence number in the MAC address, so
+ * the consumer can check that no event is lost, duplicated or reordered
+ * within a producer, and that every dropped event is accounted for in the
+ * ring overflow counter. Three passes are run:
+ *
+ *  - fill:  no consumer while producing, the ring must take exactly its depth
+ *  - retry: producers retry a push until it fits, every event must arrive
+ *  - drop:  producers give up on a full ring, arrived + dropped must add up
+ *
+ *     hal_cb_ring_test [producers] [events] [ring_size]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <pthread.h>
+#include <sched.h>
+
+/* The ring and the HAL callback are static, test them in place */
+#include "clients.c"
+
+#define TEST_PRODUCERS          8
+#define TEST_EVENTS             1000000
+#define TEST_PRODUCERS_MAX      255
+
+typedef enum
+{
+    TEST_PASS_FILL,
+    TEST_PASS_RETRY,
+    TEST_PASS_DROP,
+} test_pass_t;
+
+typedef struct
+{
+    pthread_t           thread;
+    unsigned int        id;
+    test_pass_t         pass;
+    uint32_t            events;
+    uint32_t            dropped;        // Pushes that hit a full ring
+    uint32_t            next;           // Next sequence number expected by the consumer
+    uint32_t            received;
+} test_producer_t;
+
+static test_producer_t  test_producers[TEST_PRODUCERS_MAX];
+static unsigned int     test_producers_num = TEST_PRODUCERS;
+static unsigned int     test_running;
+static int              test_failed;
+
+#define TEST_CHECK(cond)                                                    \
+    do {                                                                    \
+        if (!(cond))                                                        \
+        {                                                                   \
+            fprintf(stderr, "%s:%d: check failed: %s\n",                    \
+                    __FILE__, __LINE__, #cond);                             \
+            test_failed++;                                                  \
+        }                                                                   \
+    } while (0)
+
+/*****************************************************************************/
+
+static void *test_producer_run(void *arg)
+{
+    test_producer_t *producer = arg;
+#ifdef WIFI_HAL_VERSION_3_PHASE2
+    wifi_associated_dev3_t sta;
+#else
+    wifi_associated_dev_t sta;
+#endif
+    uint32_t seq;
+
+    memset(&sta, 0, sizeof(sta));
+    sta.cli_MACAddress[0] = 0x02;
+    sta.cli_MACAddress[1] = (unsigned char)producer->id;
+    sta.cli_Active = true;
+
+    for (seq = 0; seq < producer->events; seq++)
+    {
+        sta.cli_MACAddress[2] = (unsigned char)(seq >> 24);
+        sta.cli_MACAddress[3] = (unsigned char)(seq >> 16);
+        sta.cli_MACAddress[4] = (unsigned char)(seq >> 8);
+        sta.cli_MACAddress[5] = (unsigned char)seq;
+
+        while (clients_hal_assocdev_cb(producer->id, &sta) != RETURN_OK)
+        {
+            producer->dropped++;
+            if (producer->pass != TEST_PASS_RETRY) break;
+            sched_yield();
+        }
+    }
+
+    __atomic_sub_fetch(&test_running, 1, __ATOMIC_RELEASE);
+
+    return NULL;
+}
+
+static void test_consume(hal_cb_entry_t *cbe)
+{
+    test_producer_t *producer;
+    uint32_t seq;
+
+    if (cbe->ssid_index < 0 || (unsigned int)cbe->ssid_index >= test_producers_num
+            || cbe->sta.cli_MACAddress[1] != cbe->ssid_index)
+    {
+        TEST_CHECK(!"event from an unknown producer");
+        return;
+    }
+    producer = &test_producers[cbe->ssid_index];
+
+    seq = (uint32_t)cbe->sta.cli_MACAddress[2] << 24
+        | (uint32_t)cbe->sta.cli_MACAddress[3] << 16
+        | (uint32_t)cbe->sta.cli_MACAddress[4] << 8
+        | (uint32_t)cbe->sta.cli_MACAddress[5];
+
+    // Dropped events leave gaps, but never go back
+    if (seq < producer->next || (producer->pass == TEST_PASS_RETRY && seq != producer->next))
+    {
+        fprintf(stderr, "producer %u: got event %u, expected %u\n",
+                producer->id, seq, producer->next);
+        test_failed++;
+    }
+
+    producer->next = seq + 1;
+    producer->received++;
+}
+
+static uint32_t test_drain(void)
+{
+    hal_cb_entry_t cbe;
+    uint32_t n = 0;
+
+    while (hal_cb_ring_pop(&hal_cb_ring, &cbe))
+    {
+        test_consume(&cbe);
+        n++;
+    }
+
+    return n;
+}
+
+static void test_pass(test_pass_t pass, const char *name, uint32_t events, size_t ring_size)
+{
+    test_producer_t *producer;
+    uint64_t dropped = 0;
+    uint64_t received = 0;
+    uint64_t total;
+    unsigned int i;
+
+    FREE(hal_cb_ring.slots);
+    hal_cb_ring_init(&hal_cb_ring, ring_size);
+
+    memset(test_producers, 0, sizeof(test_producers));
+    total = (uint64_t)(events / test_producers_num) * test_producers_num;
+    __atomic_store_n(&test_running, test_producers_num, __ATOMIC_RELEASE);
+
+    for (i = 0; i < test_producers_num; i++)
+    {
+        producer = &test_producers[i];
+        producer->id = i;
+        producer->pass = pass;
+        producer->events = events / test_producers_num;
+        if (pthread_create(&producer->thread, NULL, test_producer_run, producer) != 0)
+        {
+            fprintf(stderr, "hal_cb_ring_test: cannot start producer %u\n", i);
+            exit(2);
+        }
+    }
+
+    // Consume while the producers run, except when filling up the ring
+    while (__atomic_load_n(&test_running, __ATOMIC_ACQUIRE) > 0)
+    {
+        if (pass == TEST_PASS_FILL || test_drain() == 0) sched_yield();
+    }
+
+    for (i = 0; i < test_producers_num; i++)
+    {
+        pthread_join(test_producers[i].thread, NULL);
+    }
+    test_drain();
+
+    for (i = 0; i < test_producers_num; i++)
+    {
+        producer = &test_producers[i];
+        dropped += producer->dropped;
+        received += producer->received;
+
+        if (pass == TEST_PASS_RETRY)
+        {
+            // Failed attempts were retried, nothing may be missing
+            TEST_CHECK(producer->received == producer->events);
+            TEST_CHECK(producer->next == producer->events);
+        }
+        else
+        {
+            TEST_CHECK(producer->received + producer->dropped == producer->events);
+        }
+    }
+
+    TEST_CHECK(hal_cb_ring.overflows == dropped);
+    TEST_CHECK(hal_cb_ring.high_water <= hal_cb_ring.mask + 1);
+    TEST_CHECK(hal_cb_ring.head == hal_cb_ring.tail);
+
+    if (pass == TEST_PASS_FILL)
+    {
+        // Nothing was consumed, the ring took as much as it holds
+        TEST_CHECK(received == MIN(total, hal_cb_ring.mask + 1));
+        TEST_CHECK(hal_cb_ring.high_water == received);
+    }
+    else if (pass == TEST_PASS_RETRY)
+    {
+        TEST_CHECK(received == total);
+    }
+
+    printf("%-6s %u producers, depth %zu: %llu received, %llu refused, high-water %u\n",
+           name, test_producers_num, hal_cb_ring.mask + 1,
+           (unsigned long long)received, (unsigned long long)dropped,
+           hal_cb_ring.high_water);
+}
+
+int main(int argc, char *argv[])
+{
+    uint32_t events = TEST_EVENTS;
+    size_t ring_size = CONFIG_RDK_CLIENTS_HAL_CB_RING_SIZE;
+
+    if (argc > 1) test_producers_num = (unsigned int)strtoul(argv[1], NULL, 0);
+    if (argc > 2) events = (uint32_t)strtoul(argv[2], NULL, 0);
+    if (argc > 3) ring_size = strtoul(argv[3], NULL, 0);
+
+    if (test_producers_num < 1 || test_producers_num > TEST_PRODUCERS_MAX)
+    {
+        fprintf(stderr, "hal_cb_ring_test: 1 to %d producers\n", TEST_PRODUCERS_MAX);
+        return 2;
+    }
+
+    test_pass(TEST_PASS_FILL, "fill", events, ring_size);
+    test_pass(TEST_PASS_RETRY, "retry", events, ring_size);
+    test_pass(TEST_PASS_DROP, "drop", events, ring_size);
+
+    FREE(hal_cb_ring.slots);
+
+    printf("hal_cb_ring_test: %d failure(s)\n", test_failed);
+
+    return test_failed ? 1 : 0;
+}
@@ -0,0 +1,297 @@
+/*
+Copyright (c) 2017, Plume Design Inc. All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+   1. Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+   2. Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+   3. Neither the name of the Plume Design Inc. nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL Plume Design Inc. BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+/*
+ * scan_dedup_bench - cost of neighbor deduplication of scan results
+ *
+ * Generates scan results of the given sizes, in which every AP is reported
+ * with two SSIDs, some APs are also seen on a second channel and a sixteenth
+ * of the results are on a channel that was not scanned, then times
+ * stats_scan_extract_neighbors_from_ssids() on them. The reported neighbors
+ * are checked against a straightforward pairwise comparison of the results,
+ * which is timed as well for reference.
+ *
+ *     scan_dedup_bench [passes] [results...]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/* Neighbor deduplication is static, benchmark it in place */
+#include "stats.c"
+
+#define BENCH_PASSES            20
+#define BENCH_OFFCHAN           165     // Not in bench_chan_list
+#define BENCH_OFFCHAN_EVERY     16
+#define BENCH_MULTICHAN_EVERY   8
+
+static uint32_t     bench_chan_list[] = { 1, 6, 11, 36, 40, 44, 48, 149 };
+static int          bench_failed;
+
+#define BENCH_CHECK(cond)                                                   \
+    do {                                                                    \
+        if (!(cond))                                                        \
+        {                                                                   \
+            fprintf(stderr, "%s:%d: check failed: %s\n",                    \
+                    __FILE__, __LINE__, #cond);                             \
+            bench_failed++;                                                 \
+        }                                                                   \
+    } while (0)
+
+typedef struct
+{
+    uint64_t        min;
+    uint64_t        max;
+    uint64_t        total;
+} bench_time_t;
+
+static uint64_t bench_now_usec(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static void bench_time_add(bench_time_t *t, int pass, uint64_t usec)
+{
+    if (pass == 0 || usec < t->min) t->min = usec;
+    if (usec > t->max) t->max = usec;
+    t->total += usec;
+}
+
+/*
+ * Results of qty / 2 APs, each reported twice with a different SSID, in a
+ * shuffled order. Every eighth AP is reported on the next channel as well
+ * instead of a second SSID, every sixteenth result is off-channel.
+ */
+static void bench_results(dpp_neighbor_record_t *results, uint32_t qty)
+{
+    dpp_neighbor_record_t tmp;
+    dpp_neighbor_record_t *r;
+    uint32_t ap;
+    uint32_t chan;
+    uint32_t i;
+    uint32_t j;
+
+    for (i = 0; i < qty; i++)
+    {
+        r = &results[i];
+        ap = i / 2;
+        chan = ap % ARRAY_SIZE(bench_chan_list);
+
+        if (i % 2 == 1 && ap % BENCH_MULTICHAN_EVERY == 0)
+        {
+            chan = (chan + 1) % ARRAY_SIZE(bench_chan_list);
+        }
+
+        memset(r, 0, sizeof(*r));
+        r->type = RADIO_TYPE_5G;
+        snprintf(r->bssid, sizeof(r->bssid), "02:cc:%02x:%02x:%02x:%02x",
+                 (ap >> 24) & 0xff, (ap >> 16) & 0xff, (ap >> 8) & 0xff, ap & 0xff);
+        snprintf(r->ssid, sizeof(r->ssid), "bench-%u-%u", ap, i % 2);
+        r->chan = bench_chan_list[chan];
+        r->sig = 30 + (int32_t)(i % 40);
+        r->lastseen = 1;
+
+        if (i % BENCH_OFFCHAN_EVERY == BENCH_OFFCHAN_EVERY - 1) r->chan = BENCH_OFFCHAN;
+    }
+
+    for (i = qty - 1; i > 0; i--)
+    {
+        j = (uint32_t)rand() % (i + 1);
+        tmp = results[i];
+        results[i] = results[j];
+        results[j] = tmp;
+    }
+}
+
+/*
+ * Reference: the first result of each (channel, BSSID) pair on a scanned
+ * channel is kept, found by comparing every result with every earlier one
+ */
+static uint32_t bench_reference(const dpp_neighbor_record_t *results, uint32_t qty, bool *keep)
+{
+    uint32_t kept = 0;
+    uint32_t i;
+    uint32_t j;
+    uint32_t c;
+
+    for (i = 0; i < qty; i++)
+    {
+        keep[i] = false;
+
+        for (c = 0; c < ARRAY_SIZE(bench_chan_list); c++)
+        {
+            if (results[i].chan == bench_chan_list[c]) break;
+        }
+        if (c == ARRAY_SIZE(bench_chan_list)) continue;
+
+        for (j = 0; j < i; j++)
+        {
+            if (keep[j] && results[j].chan == results[i].chan
+                    && !strcmp(results[j].bssid, results[i].bssid))
+            {
+                break;
+            }
+        }
+        if (j < i) continue;
+
+        keep[i] = true;
+        kept++;
+    }
+
+    return kept;
+}
+
+static void bench_check(const dpp_neighbor_record_t *results, uint32_t qty,
+                        const bool *keep, dpp_neighbor_list_t *list)
+{
+    dpp_neighbor_record_list_t *neighbor;
+    uint32_t i = 0;
+
+    ds_dlist_foreach(list, neighbor)
+    {
+        while (i < qty && !keep[i]) i++;
+        if (i == qty)
+        {
+            BENCH_CHECK(!"more neighbors than expected");
+            return;
+        }
+
+        if (strcmp(neighbor->entry.bssid, results[i].bssid)
+                || strcmp(neighbor->entry.ssid, results[i].ssid)
+                || neighbor->entry.chan != results[i].chan)
+        {
+            fprintf(stderr, "neighbor %s/%s on %u, expected %s/%s on %u\n",
+                    neighbor->entry.bssid, neighbor->entry.ssid, neighbor->entry.chan,
+                    results[i].bssid, results[i].ssid, results[i].chan);
+            bench_failed++;
+            return;
+        }
+        i++;
+    }
+
+    while (i < qty && !keep[i]) i++;
+    BENCH_CHECK(i == qty);
+}
+
+static void bench_list_free(dpp_neighbor_list_t *list)
+{
+    dpp_neighbor_record_list_t *neighbor;
+
+    while ((neighbor = ds_dlist_remove_head(list)) != NULL)
+    {
+        dpp_neighbor_record_free(neighbor);
+    }
+}
+
+static void bench_run(uint32_t qty, int passes)
+{
+    dpp_neighbor_list_t list = DS_DLIST_INIT(dpp_neighbor_record_list_t, node);
+    stats_scan_dedup_stats_t before;
+    stats_scan_dedup_stats_t after;
+    dpp_neighbor_record_t *results;
+    dpp_neighbor_record_t *work;
+    bench_time_t dedup = { 0 };
+    bench_time_t ref = { 0 };
+    uint32_t expected = 0;
+    uint64_t start;
+    bool *keep;
+    int pass;
+
+    if (qty == 0) return;
+
+    results = CALLOC(qty, sizeof(*results));
+    work = CALLOC(qty, sizeof(*work));
+    keep = CALLOC(qty, sizeof(*keep));
+
+    for (pass = 0; pass < passes; pass++)
+    {
+        bench_results(results, qty);
+
+        start = bench_now_usec();
+        expected = bench_reference(results, qty, keep);
+        bench_time_add(&ref, pass, bench_now_usec() - start);
+
+        // The results are modified in place, keep the originals for checking
+        memcpy(work, results, qty * sizeof(*work));
+
+        stats_scan_dedup_stats_get(&before);
+        start = bench_now_usec();
+        BENCH_CHECK(stats_scan_extract_neighbors_from_ssids(
+                RADIO_TYPE_5G, bench_chan_list, ARRAY_SIZE(bench_chan_list),
+                RADIO_SCAN_TYPE_FULL, work, qty, &list));
+        bench_time_add(&dedup, pass, bench_now_usec() - start);
+        stats_scan_dedup_stats_get(&after);
+
+        bench_check(results, qty, keep, &list);
+        BENCH_CHECK(after.neighbors - before.neighbors == expected);
+        BENCH_CHECK(after.raw - before.raw == qty);
+        BENCH_CHECK(after.offchan + after.duplicates + after.neighbors
+                    - before.offchan - before.duplicates - before.neighbors == qty);
+
+        bench_list_free(&list);
+    }
+
+    printf("%5u results, %4u neighbors: dedup min %llu us, avg %llu us, max %llu us; "
+           "pairwise avg %llu us\n", qty, expected,
+           (unsigned long long)dedup.min,
+           (unsigned long long)(dedup.total / passes),
+           (unsigned long long)dedup.max,
+           (unsigned long long)(ref.total / passes));
+
+    FREE(keep);
+    FREE(work);
+    FREE(results);
+}
+
+int main(int argc, char *argv[])
+{
+    static const uint32_t default_results[] = { 1000, 5000 };
+    int passes = BENCH_PASSES;
+    int i;
+
+    if (argc > 1) passes = atoi(argv[1]);
+    if (passes < 1) passes = 1;
+
+    srand(1);
+
+    if (argc > 2)
+    {
+        for (i = 2; i < argc; i++) bench_run((uint32_t)strtoul(argv[i], NULL, 0), passes);
+    }
+    else
+    {
+        for (i = 0; i < (int)ARRAY_SIZE(default_results); i++) bench_run(default_results[i], passes);
+    }
+
+    printf("scan_dedup_bench: %d failure(s)\n", bench_failed);
+
+    return bench_failed ? 1 : 0;
+}
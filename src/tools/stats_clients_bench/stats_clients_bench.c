@@ -0,0 +1,167 @@
+/*
+Copyright (c) 2017, Plume Design Inc. All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+   1. Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+   2. Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+   3. Neither the name of the Plume Design Inc. nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL Plume Design Inc. BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+/*
+ * stats_clients_bench - client stats poll latency against the wifi_hal mock
+ *
+ * Polls the client stats of one radio through target_stats_clients_get()
+ * and reports the time per poll, separately for polls served from the
+ * associated device list (bulk) and polls that called the HAL once per
+ * client. Until the collection path is probed on a client with traffic,
+ * polls take the per-client path. The first poll also builds the topology
+ * cache and is reported on its own, see README.md.
+ *
+ *     stats_clients_bench <radio_ifname> [polls]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "log.h"
+#include "ds_dlist.h"
+#include "target.h"
+#include "target_internal.h"
+
+#define BENCH_POLLS             20
+
+typedef struct
+{
+    int             status;
+    unsigned int    clients;
+    bool            bulk;           // Records without rx counters
+} bench_result_t;
+
+typedef struct
+{
+    const char     *name;
+    unsigned int    polls;
+    uint64_t        min;
+    uint64_t        max;
+    uint64_t        total;
+} bench_path_t;
+
+static uint64_t bench_now_usec(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static bool bench_clients_cb(ds_dlist_t *client_list, void *ctx, int status)
+{
+    bench_result_t *result = ctx;
+    target_client_record_t *record;
+
+    result->status = status;
+    result->clients = 0;
+    result->bulk = false;
+
+    while ((record = ds_dlist_remove_head(client_list)) != NULL)
+    {
+        result->clients++;
+        result->bulk = record->rx_counters_na;
+        target_client_record_free(record);
+    }
+
+    return true;
+}
+
+static bool bench_poll(radio_entry_t *radio, bench_result_t *result, uint64_t *usec)
+{
+    ds_dlist_t client_list = DS_DLIST_INIT(target_client_record_t, node);
+    uint64_t start;
+
+    start = bench_now_usec();
+    target_stats_clients_get(radio, NULL, bench_clients_cb, &client_list, result);
+    *usec = bench_now_usec() - start;
+
+    return result->status;
+}
+
+static void bench_path_add(bench_path_t *path, uint64_t usec)
+{
+    if (path->polls == 0 || usec < path->min) path->min = usec;
+    if (usec > path->max) path->max = usec;
+    path->total += usec;
+    path->polls++;
+}
+
+static void bench_path_print(bench_path_t *path, unsigned int clients)
+{
+    if (path->polls == 0) return;
+
+    printf("%-11s %3u polls, %u clients, min %.2f ms, avg %.2f ms, max %.2f ms\n",
+           path->name, path->polls, clients,
+           path->min / 1000.0, path->total / 1000.0 / path->polls, path->max / 1000.0);
+}
+
+int main(int argc, char *argv[])
+{
+    radio_entry_t radio;
+    bench_result_t result;
+    bench_path_t bulk = { .name = "bulk:" };
+    bench_path_t per_client = { .name = "per-client:" };
+    unsigned int polls = BENCH_POLLS;
+    uint64_t usec;
+    unsigned int i;
+
+    if (argc < 2)
+    {
+        fprintf(stderr, "usage: %s <radio_ifname> [polls]\n", argv[0]);
+        return 2;
+    }
+    if (argc > 2) polls = strtoul(argv[2], NULL, 0);
+    if (polls < 2) polls = 2;
+
+    memset(&radio, 0, sizeof(radio));
+    STRSCPY(radio.phy_name, argv[1]);
+    STRSCPY(radio.if_name, argv[1]);
+
+    for (i = 0; i < polls; i++)
+    {
+        if (!bench_poll(&radio, &result, &usec))
+        {
+            fprintf(stderr, "stats_clients_bench: client stats poll of %s failed\n", argv[1]);
+            return 1;
+        }
+
+        if (i == 0)
+        {
+            printf("first poll: %u clients, %.2f ms\n", result.clients, usec / 1000.0);
+            continue;
+        }
+
+        bench_path_add(result.bulk ? &bulk : &per_client, usec);
+    }
+
+    bench_path_print(&per_client, result.clients);
+    bench_path_print(&bulk, result.clients);
+
+    return 0;
+}
@@ -0,0 +1,249 @@
+/*
+Copyright (c) 2017, Plume Design Inc. All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+   1. Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+   2. Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+   3. Neither the name of the Plume Design Inc. nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL Plume Design Inc. BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+/*
+ * stats_delta_test - off-target check of the counter delta engine
+ *
+ * Runs stats_counter_delta() on synthetic counter sequences: steady
+ * advances, 32-bit wraps, driver restarts, learning the width of an AUTO
+ * counter, and backward steps around the 2^31 boundary that separates a
+ * wrap from a restart. The anomaly counters reported by
+ * stats_delta_stats_get() are checked along the way.
+ *
+ *     stats_delta_test
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "log.h"
+#include "target.h"
+#include "target_internal.h"
+
+static int          test_failed;
+
+#define TEST_CHECK(cond)                                                    \
+    do {                                                                    \
+        if (!(cond))                                                        \
+        {                                                                   \
+            fprintf(stderr, "%s:%d: check failed: %s\n",                    \
+                    __FILE__, __LINE__, #cond);                             \
+            test_failed++;                                                  \
+        }                                                                   \
+    } while (0)
+
+/*****************************************************************************/
+
+// Anomaly counters since the previous call
+static stats_delta_stats_t test_stats_diff(void)
+{
+    static stats_delta_stats_t last;
+    stats_delta_stats_t now;
+    stats_delta_stats_t diff;
+
+    stats_delta_stats_get(&now);
+    diff.wraps = now.wraps - last.wraps;
+    diff.resets = now.resets - last.resets;
+    diff.reinits = now.reinits - last.reinits;
+    diff.learned_64 = now.learned_64 - last.learned_64;
+    last = now;
+
+    return diff;
+}
+
+static void test_advance(void)
+{
+    stats_counter_width_t widths[] = { STATS_COUNTER_32, STATS_COUNTER_64, STATS_COUNTER_AUTO };
+    stats_counter_width_t width;
+    stats_delta_stats_t diff;
+    uint64_t delta;
+    size_t i;
+
+    for (i = 0; i < sizeof(widths) / sizeof(widths[0]); i++)
+    {
+        width = widths[i];
+        TEST_CHECK(stats_counter_delta(1000, 1500, &width, &delta) == STATS_DELTA_OK);
+        TEST_CHECK(delta == 500);
+        TEST_CHECK(stats_counter_delta(1500, 1500, &width, &delta) == STATS_DELTA_OK);
+        TEST_CHECK(delta == 0);
+        TEST_CHECK(width == widths[i]);
+    }
+
+    diff = test_stats_diff();
+    TEST_CHECK(diff.wraps == 0 && diff.resets == 0 && diff.learned_64 == 0);
+}
+
+static void test_wrap_32(void)
+{
+    stats_counter_width_t width;
+    stats_delta_stats_t diff;
+    uint64_t delta;
+
+    // Known 32-bit counter crossing 2^32
+    width = STATS_COUNTER_32;
+    TEST_CHECK(stats_counter_delta(0xffffff00, 0x10, &width, &delta) == STATS_DELTA_WRAP);
+    TEST_CHECK(delta == 0x110);
+
+    // Bits above 32 in the HAL field are ignored for a 32-bit counter
+    TEST_CHECK(stats_counter_delta(0x1ffffff00ULL, 0x10, &width, &delta) == STATS_DELTA_WRAP);
+    TEST_CHECK(delta == 0x110);
+
+    // Right at the top of the range
+    TEST_CHECK(stats_counter_delta(UINT32_MAX, 0, &width, &delta) == STATS_DELTA_WRAP);
+    TEST_CHECK(delta == 1);
+
+    // Unknown width that never exceeded 32 bits is guessed to wrap as well
+    width = STATS_COUNTER_AUTO;
+    TEST_CHECK(stats_counter_delta(0xfffff000, 0x1000, &width, &delta) == STATS_DELTA_WRAP);
+    TEST_CHECK(delta == 0x2000);
+    TEST_CHECK(width == STATS_COUNTER_AUTO);
+
+    diff = test_stats_diff();
+    TEST_CHECK(diff.wraps == 4);
+    TEST_CHECK(diff.resets == 0);
+}
+
+static void test_reset(void)
+{
+    stats_counter_width_t width;
+    stats_delta_stats_t diff;
+    uint64_t delta;
+
+    // A 64-bit counter never wraps, going backwards is a restart
+    width = STATS_COUNTER_64;
+    TEST_CHECK(stats_counter_delta(0xffffff00, 0x10, &width, &delta) == STATS_DELTA_RESET);
+    TEST_CHECK(delta == 0x10);
+    TEST_CHECK(stats_counter_delta(0x500000000ULL, 0x20, &width, &delta) == STATS_DELTA_RESET);
+    TEST_CHECK(delta == 0x20);
+
+    // 32-bit counter restarted from a low value, too far back to be a wrap
+    width = STATS_COUNTER_32;
+    TEST_CHECK(stats_counter_delta(5000, 100, &width, &delta) == STATS_DELTA_RESET);
+    TEST_CHECK(delta == 100);
+
+    // Same for a counter of unknown width
+    width = STATS_COUNTER_AUTO;
+    TEST_CHECK(stats_counter_delta(5000, 100, &width, &delta) == STATS_DELTA_RESET);
+    TEST_CHECK(delta == 100);
+    TEST_CHECK(width == STATS_COUNTER_AUTO);
+
+    // Reassociation discards the baseline, counted separately
+    stats_counter_reinit();
+
+    diff = test_stats_diff();
+    TEST_CHECK(diff.resets == 4);
+    TEST_CHECK(diff.wraps == 0);
+    TEST_CHECK(diff.reinits == 1);
+}
+
+static void test_learn_64(void)
+{
+    stats_counter_width_t width = STATS_COUNTER_AUTO;
+    stats_delta_stats_t diff;
+    uint64_t delta;
+
+    // Below 32 bits the width stays unknown
+    TEST_CHECK(stats_counter_delta(0x10, 0xfffffff0, &width, &delta) == STATS_DELTA_OK);
+    TEST_CHECK(width == STATS_COUNTER_AUTO);
+
+    // Crossing 2^32 without wrapping proves a 64-bit counter
+    TEST_CHECK(stats_counter_delta(0xfffffff0, 0x100000010ULL, &width, &delta) == STATS_DELTA_OK);
+    TEST_CHECK(delta == 0x20);
+    TEST_CHECK(width == STATS_COUNTER_64);
+
+    // From now on a backward step that looks like a wrap is a restart
+    TEST_CHECK(stats_counter_delta(0xffffff00, 0x10, &width, &delta) == STATS_DELTA_RESET);
+    TEST_CHECK(delta == 0x10);
+    TEST_CHECK(width == STATS_COUNTER_64);
+
+    // A high old value alone is enough to learn the width
+    width = STATS_COUNTER_AUTO;
+    TEST_CHECK(stats_counter_delta(0x100000000ULL, 0x10, &width, &delta) == STATS_DELTA_RESET);
+    TEST_CHECK(width == STATS_COUNTER_64);
+
+    diff = test_stats_diff();
+    TEST_CHECK(diff.learned_64 == 2);
+    TEST_CHECK(diff.resets == 2);
+    TEST_CHECK(diff.wraps == 0);
+}
+
+static void test_half_range(void)
+{
+    stats_counter_width_t width;
+    stats_delta_stats_t diff;
+    uint64_t delta;
+
+    /*
+     * A backward step is a wrap only if the wrapped delta is below 2^31,
+     * i.e. at most UINT32_MAX / 2
+     */
+    width = STATS_COUNTER_32;
+    TEST_CHECK(stats_counter_delta(0x80000001, 0, &width, &delta) == STATS_DELTA_WRAP);
+    TEST_CHECK(delta == 0x7fffffff);
+
+    TEST_CHECK(stats_counter_delta(0x80000000, 0, &width, &delta) == STATS_DELTA_RESET);
+    TEST_CHECK(delta == 0);
+
+    TEST_CHECK(stats_counter_delta(0x7fffffff, 0, &width, &delta) == STATS_DELTA_RESET);
+    TEST_CHECK(delta == 0);
+
+    // Same boundary, the new value past zero
+    TEST_CHECK(stats_counter_delta(0xc0000000, 0x3fffffff, &width, &delta) == STATS_DELTA_WRAP);
+    TEST_CHECK(delta == 0x7fffffff);
+
+    TEST_CHECK(stats_counter_delta(0xc0000000, 0x40000000, &width, &delta) == STATS_DELTA_RESET);
+    TEST_CHECK(delta == 0x40000000);
+
+    // A forward step of 2^31 or more is taken as is
+    TEST_CHECK(stats_counter_delta(0, 0x80000000, &width, &delta) == STATS_DELTA_OK);
+    TEST_CHECK(delta == 0x80000000);
+
+    // Unknown width behaves the same while below 32 bits
+    width = STATS_COUNTER_AUTO;
+    TEST_CHECK(stats_counter_delta(0x80000001, 0, &width, &delta) == STATS_DELTA_WRAP);
+    TEST_CHECK(stats_counter_delta(0x80000000, 0, &width, &delta) == STATS_DELTA_RESET);
+    TEST_CHECK(width == STATS_COUNTER_AUTO);
+
+    diff = test_stats_diff();
+    TEST_CHECK(diff.wraps == 3);
+    TEST_CHECK(diff.resets == 4);
+}
+
+int main(void)
+{
+    test_stats_diff();
+
+    test_advance();
+    test_wrap_32();
+    test_reset();
+    test_learn_64();
+    test_half_range();
+
+    printf("stats_delta_test: %d failure(s)\n", test_failed);
+
+    return test_failed ? 1 : 0;
+}
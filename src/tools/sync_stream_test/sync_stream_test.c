@@ -0,0 +1,384 @@
+/*
+Copyright (c) 2017, Plume Design Inc. All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+   1. Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+   2. Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+   3. Neither the name of the Plume Design Inc. nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL Plume Design Inc. BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+/*
+ * sync_stream_test - MeshAgent socket framing and back-pressure harness
+ *
+ * Connects the MeshAgent sync client of sync.c to one end of a socketpair
+ * with small socket buffers and plays the MeshAgent on the other end:
+ *
+ *  - rx: a stream of messages, some with an invalid type, is written in
+ *        random chunk sizes with the event loop run in between, so that
+ *        messages arrive split and several at a time. Message payloads are
+ *        filled so that reading at any offset but a message boundary gives
+ *        an invalid type, so the received and malformed counters can only
+ *        come out right if every message boundary was found.
+ *  - tx: numbered messages are sent while the peer does not read, until
+ *        the send queue is full, then while the peer reads in random
+ *        chunks. Every accepted message must arrive once, whole and in
+ *        order, and every refused one must be counted as dropped.
+ *  - disconnect: the peer closes with messages queued and a partial
+ *        message received, both must be discarded and counted.
+ *
+ *     sync_stream_test [messages] [seed]
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <poll.h>
+
+/* The stream state is static, test it in place */
+#include "sync.c"
+
+#define TEST_MESSAGES           10000
+#define TEST_SOCKBUF            4096
+#define TEST_MALFORMED_EVERY    7
+#define TEST_PAYLOAD_FILL       0x7f
+#define TEST_IDLE_MAX           1000
+
+static int          test_peer = -1;
+static int          test_failed;
+
+#define TEST_CHECK(cond)                                                    \
+    do {                                                                    \
+        if (!(cond))                                                        \
+        {                                                                   \
+            fprintf(stderr, "%s:%d: check failed: %s\n",                    \
+                    __FILE__, __LINE__, #cond);                             \
+            test_failed++;                                                  \
+        }                                                                   \
+    } while (0)
+
+/*****************************************************************************/
+
+static void test_loop_run(void)
+{
+    ev_run(wifihal_evloop, EVRUN_NOWAIT);
+}
+
+// Stands in for sync_task_connect(), with a socketpair instead of MeshAgent
+static bool test_connect(void)
+{
+    int size = TEST_SOCKBUF;
+    int fds[2];
+
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) != 0) return false;
+
+    setsockopt(fds[0], SOL_SOCKET, SO_SNDBUF, &size, sizeof(size));
+    setsockopt(fds[0], SOL_SOCKET, SO_RCVBUF, &size, sizeof(size));
+    setsockopt(fds[1], SOL_SOCKET, SO_SNDBUF, &size, sizeof(size));
+    setsockopt(fds[1], SOL_SOCKET, SO_RCVBUF, &size, sizeof(size));
+    fcntl(fds[1], F_SETFL, O_NONBLOCK);
+
+    ev_io_init(&sync_evio, sync_evio_cb, fds[0], EV_READ);
+    ev_io_start(wifihal_evloop, &sync_evio);
+    sync_fd = fds[0];
+    test_peer = fds[1];
+
+    return true;
+}
+
+static void test_disconnect(void)
+{
+    sync_disconnect();
+    if (test_peer >= 0) close(test_peer);
+    test_peer = -1;
+}
+
+// Writes the whole buffer from the peer, running the loop while it is full
+static void test_peer_write(const void *buf, size_t len)
+{
+    const uint8_t *p = buf;
+    ssize_t ret;
+
+    while (len > 0)
+    {
+        ret = send(test_peer, p, len, MSG_NOSIGNAL);
+        if (ret < 0)
+        {
+            if (errno != EAGAIN && errno != EWOULDBLOCK) return;
+            test_loop_run();
+            continue;
+        }
+        p += ret;
+        len -= ret;
+    }
+}
+
+static void test_msg_fill(MeshSync *mp, int type)
+{
+    memset(mp, TEST_PAYLOAD_FILL, sizeof(*mp));
+    mp->msgType = type;
+}
+
+/*****************************************************************************/
+
+static void test_rx(unsigned long messages)
+{
+    sync_stats_t before = sync_stats;
+    unsigned long malformed = 0;
+    unsigned long n;
+    uint8_t *stream;
+    size_t len = messages * sizeof(MeshSync);
+    size_t off;
+    size_t chunk;
+
+    stream = MALLOC(len);
+    for (n = 0; n < messages; n++)
+    {
+        if (n % TEST_MALFORMED_EVERY == TEST_MALFORMED_EVERY - 1)
+        {
+            test_msg_fill((MeshSync *)stream + n, MESH_SYNC_MSG_TOTAL + (int)n % 16);
+            malformed++;
+        }
+        else
+        {
+            // Handled by logging only in NM
+            test_msg_fill((MeshSync *)stream + n, MESH_DHCP_RESYNC_LEASES);
+        }
+    }
+
+    // From single bytes up to a few messages at once
+    for (off = 0; off < len; off += chunk)
+    {
+        switch (rand() % 4)
+        {
+            case 0:  chunk = 1 + rand() % 8; break;
+            case 1:  chunk = 1 + rand() % sizeof(MeshSync); break;
+            default: chunk = 1 + rand() % (3 * sizeof(MeshSync)); break;
+        }
+        if (chunk > len - off) chunk = len - off;
+
+        test_peer_write(stream + off, chunk);
+        test_loop_run();
+    }
+    test_loop_run();
+
+    TEST_CHECK(sync_fd >= 0);
+    TEST_CHECK(sync_stats.rx_msgs - before.rx_msgs == messages - malformed);
+    TEST_CHECK(sync_stats.rx_malformed - before.rx_malformed == malformed);
+    TEST_CHECK(sync_rx_len == 0);
+
+    printf("rx:         %lu messages (%lu malformed) in random chunks, "
+           "%u received, %u malformed\n", messages, malformed,
+           sync_stats.rx_msgs - before.rx_msgs,
+           sync_stats.rx_malformed - before.rx_malformed);
+
+    FREE(stream);
+}
+
+static void test_tx_msg(MeshSync *mp, uint32_t seq)
+{
+    memset(mp, 0, sizeof(*mp));
+    mp->msgType = MESH_WIFI_RADIO_CHANNEL;
+    mp->data.wifiRadioChannel.index = seq;
+    mp->data.wifiRadioChannel.channel = seq ^ 0xa5a5a5a5;
+}
+
+/*
+ * Reads whatever the peer has, checking each complete message against the
+ * next accepted sequence number. Returns the number of messages read.
+ */
+static unsigned long test_peer_read(uint8_t *buf, size_t *buf_len, size_t max,
+                                    const bool *accepted, uint32_t *next)
+{
+    unsigned long n = 0;
+    MeshSync msg;
+    ssize_t ret;
+
+    ret = recv(test_peer, buf + *buf_len, max, 0);
+    if (ret <= 0) return 0;
+    *buf_len += ret;
+
+    while (*buf_len >= sizeof(msg))
+    {
+        memcpy(&msg, buf, sizeof(msg));
+        *buf_len -= sizeof(msg);
+        memmove(buf, buf + sizeof(msg), *buf_len);
+
+        // Refused messages leave gaps
+        while (!accepted[*next]) (*next)++;
+
+        if (msg.msgType != MESH_WIFI_RADIO_CHANNEL
+                || (uint32_t)msg.data.wifiRadioChannel.index != *next
+                || (uint32_t)msg.data.wifiRadioChannel.channel != (*next ^ 0xa5a5a5a5))
+        {
+            fprintf(stderr, "tx: got message %u, expected %u\n",
+                    (uint32_t)msg.data.wifiRadioChannel.index, *next);
+            test_failed++;
+        }
+        (*next)++;
+        n++;
+    }
+
+    return n;
+}
+
+static void test_tx(unsigned long messages)
+{
+    sync_stats_t before = sync_stats;
+    uint8_t buf[4 * sizeof(MeshSync)];
+    size_t buf_len = 0;
+    unsigned long sent = 0;
+    unsigned long refused = 0;
+    unsigned long received = 0;
+    unsigned long idle;
+    unsigned long n;
+    uint32_t next = 0;
+    bool *accepted;
+    MeshSync msg;
+
+    accepted = CALLOC(messages + 1, sizeof(*accepted));
+    accepted[messages] = true;
+
+    // Peer not reading: the socket fills up, then the queue
+    for (n = 0; n < messages && sync_stats.tx_dropped == before.tx_dropped; n++)
+    {
+        test_tx_msg(&msg, n);
+        accepted[n] = sync_send_msg(&msg);
+        if (accepted[n]) sent++; else refused++;
+        test_loop_run();
+    }
+
+    TEST_CHECK(sync_tx_depth == SYNC_TX_QUEUE);
+    TEST_CHECK(sync_stats.tx_depth_max == SYNC_TX_QUEUE);
+    TEST_CHECK(sync_evio.events & EV_WRITE);
+    TEST_CHECK(refused == 1);
+
+    // Peer reading in random chunks while more messages are sent
+    for (; n < messages; n++)
+    {
+        test_tx_msg(&msg, n);
+        accepted[n] = sync_send_msg(&msg);
+        if (accepted[n]) sent++; else refused++;
+
+        if (rand() % 2)
+        {
+            received += test_peer_read(buf, &buf_len, 1 + rand() % (sizeof(buf) - buf_len),
+                                       accepted, &next);
+        }
+        test_loop_run();
+    }
+
+    // Drain the rest
+    for (idle = 0; received < sent && idle < TEST_IDLE_MAX; idle++)
+    {
+        n = test_peer_read(buf, &buf_len, sizeof(buf) - buf_len, accepted, &next);
+        if (n > 0) idle = 0;
+        received += n;
+        test_loop_run();
+    }
+
+    TEST_CHECK(received == sent);
+    TEST_CHECK(buf_len == 0);
+    TEST_CHECK(sync_tx_depth == 0);
+    TEST_CHECK(!(sync_evio.events & EV_WRITE));
+    TEST_CHECK(sync_stats.tx_msgs - before.tx_msgs == sent);
+    TEST_CHECK(sync_stats.tx_dropped - before.tx_dropped == refused);
+    TEST_CHECK(sync_stats.tx_queued - before.tx_queued > 0);
+
+    printf("tx:         %lu messages, %lu received in order, %lu refused, "
+           "%u queued, max depth %u\n", messages, received, refused,
+           sync_stats.tx_queued - before.tx_queued, sync_stats.tx_depth_max);
+
+    FREE(accepted);
+}
+
+static void test_lost_connection(void)
+{
+    sync_stats_t before = sync_stats;
+    unsigned int depth;
+    MeshSync msg;
+    uint32_t n;
+
+    // Fill the queue and leave half a message in the receive buffer
+    for (n = 0; sync_tx_depth < SYNC_TX_QUEUE / 2; n++)
+    {
+        test_tx_msg(&msg, n);
+        TEST_CHECK(sync_send_msg(&msg));
+    }
+    depth = sync_tx_depth;
+
+    test_msg_fill(&msg, MESH_DHCP_RESYNC_LEASES);
+    test_peer_write(&msg, sizeof(msg) / 2);
+    test_loop_run();
+    TEST_CHECK(sync_rx_len == sizeof(msg) / 2);
+
+    close(test_peer);
+    test_peer = -1;
+    test_loop_run();
+
+    TEST_CHECK(sync_fd < 0);
+    TEST_CHECK(sync_rx_len == 0);
+    TEST_CHECK(sync_tx_depth == 0);
+    TEST_CHECK(ds_dlist_is_empty(&sync_tx_queue));
+    TEST_CHECK(sync_stats.tx_dropped - before.tx_dropped == depth);
+    TEST_CHECK(sync_stats.rx_msgs == before.rx_msgs);
+
+    // Sending while disconnected fails right away
+    TEST_CHECK(!sync_send_msg(&msg));
+
+    // Don't let the reconnect timer go looking for MeshAgent
+    ev_timer_stop(EV_DEFAULT_ &sync_timer);
+
+    printf("disconnect: %u queued messages and a partial message dropped\n", depth);
+}
+
+int main(int argc, char *argv[])
+{
+    unsigned long messages = TEST_MESSAGES;
+    unsigned int seed = 1;
+
+    if (argc > 1) messages = strtoul(argv[1], NULL, 0);
+    if (argc > 2) seed = (unsigned int)strtoul(argv[2], NULL, 0);
+
+    if (messages < 2 * SYNC_TX_QUEUE)
+    {
+        fprintf(stderr, "sync_stream_test: at least %d messages\n", 2 * SYNC_TX_QUEUE);
+        return 2;
+    }
+
+    srand(seed);
+    wifihal_evloop = EV_DEFAULT;
+    sync_mgr = SYNC_MGR_NM;
+
+    if (!test_connect())
+    {
+        fprintf(stderr, "sync_stream_test: cannot create the socketpair\n");
+        return 2;
+    }
+
+    test_rx(messages);
+    test_tx(messages);
+    test_lost_connection();
+    test_disconnect();
+
+    printf("sync_stream_test: seed %u, %d failure(s)\n", seed, test_failed);
+
+    return test_failed ? 1 : 0;
+}
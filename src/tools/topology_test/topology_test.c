@@ -0,0 +1,342 @@
+/*
+Copyright (c) 2017, Plume Design Inc. All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+   1. Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+   2. Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+   3. Neither the name of the Plume Design Inc. nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL Plume Design Inc. BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+/*
+ * topology_test - off-target check of the radio/VAP topology cache
+ *
+ * Runs the topology lookups of topology.c against the wifi_hal mock with a
+ * three-radio scenario. The scenario makes the first HAL capability query
+ * and the first VAP map query fail, so the cache is exercised while the HAL
+ * is not ready yet and with a partial VAP map. Once the cache is complete,
+ * repeated lookups (including of unknown names) must not reach the HAL at
+ * all, and topology_invalidate() must trigger exactly one rebuild. Finally
+ * a few threads run lookups while the cache is invalidated under them.
+ *
+ *     topology_test [lookups]
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#include "log.h"
+#include "util.h"
+#include "target.h"
+#include "target_internal.h"
+#include "wifi_hal_mock.h"
+
+#define TEST_LOOKUPS            100000
+#define TEST_THREADS            4
+
+static const char test_scenario[] =
+    "radio 0 wifi0 2.4G 6\n"
+    "radio 1 wifi1 5G 44\n"
+    "radio 2 wifi2 6G 37\n"
+    "vap 0 0 ath0 home\n"
+    "vap 1 1 ath1 home\n"
+    "vap 16 2 ath16 home\n"
+    "vap 12 0 ath12 bhaul\n"
+    "vap 13 1 ath13 bhaul\n"
+    "fail wifi_getHalCapability 1\n"
+    "fail wifi_getRadioVapInfoMap 1\n";
+
+typedef struct
+{
+    const char         *ifname;
+    INT                 ssid_index;
+    INT                 radio_index;
+    INT                 vap_pos;
+} test_vap_t;
+
+static const test_vap_t test_vaps[] =
+{
+    { "ath0",   0,  0, 0 },
+    { "ath1",   1,  1, 0 },
+    { "ath16",  16, 2, 0 },
+    { "ath12",  12, 0, 1 },
+    { "ath13",  13, 1, 1 },
+};
+
+static const char  *test_radios[] = { "wifi0", "wifi1", "wifi2" };
+
+static unsigned long test_lookups = TEST_LOOKUPS;
+static bool          test_stop;
+static int          test_failed;
+
+#define TEST_CHECK(cond)                                                    \
+    do {                                                                    \
+        if (!(cond))                                                        \
+        {                                                                   \
+            fprintf(stderr, "%s:%d: check failed: %s\n",                    \
+                    __FILE__, __LINE__, #cond);                             \
+            __atomic_add_fetch(&test_failed, 1, __ATOMIC_RELAXED);          \
+        }                                                                   \
+    } while (0)
+
+/*****************************************************************************/
+
+static unsigned long test_hal_calls(void)
+{
+    return __atomic_load_n(&g_mock.num_calls, __ATOMIC_RELAXED);
+}
+
+static bool test_scenario_write(char *path, size_t path_size)
+{
+    int fd;
+
+    snprintf(path, path_size, "/tmp/topology_test.XXXXXX");
+    fd = mkstemp(path);
+    if (fd < 0) return false;
+
+    if (write(fd, test_scenario, sizeof(test_scenario) - 1) != (ssize_t)(sizeof(test_scenario) - 1))
+    {
+        close(fd);
+        unlink(path);
+        return false;
+    }
+    close(fd);
+
+    return setenv(MOCK_SCENARIO_ENV, path, 1) == 0;
+}
+
+// Checks every known mapping, returns false on the first mismatch
+static bool test_lookup_all(void)
+{
+    char radio_ifname[32];
+    INT radio_index;
+    INT ssid_index;
+    INT vap_pos;
+    size_t i;
+
+    for (i = 0; i < ARRAY_SIZE(test_radios); i++)
+    {
+        if (!topology_radio_ifname_to_idx(test_radios[i], &radio_index)) return false;
+        if (radio_index != (INT)i) return false;
+        if (!topology_radio_idx_to_ifname(i, radio_ifname, sizeof(radio_ifname))) return false;
+        if (strcmp(radio_ifname, test_radios[i])) return false;
+    }
+
+    for (i = 0; i < ARRAY_SIZE(test_vaps); i++)
+    {
+        if (!topology_vif_ifname_to_idx(test_vaps[i].ifname, &ssid_index)) return false;
+        if (ssid_index != test_vaps[i].ssid_index) return false;
+        if (!topology_ssid_index_to_radio(test_vaps[i].ssid_index, &radio_index, &vap_pos)) return false;
+        if (radio_index != test_vaps[i].radio_index || vap_pos != test_vaps[i].vap_pos) return false;
+    }
+
+    return true;
+}
+
+static void test_hal_not_ready(void)
+{
+    topology_stats_t stats;
+    INT radio_index;
+
+    // Capability query fails, nothing is cached and the next lookup retries
+    TEST_CHECK(!topology_radio_ifname_to_idx("wifi1", &radio_index));
+
+    topology_stats_get(&stats);
+    TEST_CHECK(stats.misses == 1);
+    TEST_CHECK(stats.hits == 0);
+}
+
+static void test_partial_map(void)
+{
+    topology_stats_t stats;
+    INT radio_index = -1;
+    INT ssid_index = -1;
+    INT vap_pos = -1;
+
+    // VAP map of radio 0 fails, names are cached nevertheless
+    TEST_CHECK(topology_radio_ifname_to_idx("wifi1", &radio_index));
+    TEST_CHECK(radio_index == 1);
+    TEST_CHECK(topology_vif_ifname_to_idx("ath12", &ssid_index));
+    TEST_CHECK(ssid_index == 12);
+
+    // Radio 1 VAPs are known, radio 0 VAPs need a rebuild
+    TEST_CHECK(topology_ssid_index_to_radio(13, &radio_index, &vap_pos));
+    TEST_CHECK(radio_index == 1 && vap_pos == 1);
+
+    topology_stats_get(&stats);
+    TEST_CHECK(stats.misses == 2);
+    TEST_CHECK(stats.invalidations == 0);
+
+    TEST_CHECK(topology_ssid_index_to_radio(12, &radio_index, &vap_pos));
+    TEST_CHECK(radio_index == 0 && vap_pos == 1);
+
+    topology_stats_get(&stats);
+    TEST_CHECK(stats.misses == 3);
+    TEST_CHECK(stats.invalidations == 1);
+
+    TEST_CHECK(test_lookup_all());
+}
+
+static void test_cached(void)
+{
+    topology_stats_t before;
+    topology_stats_t after;
+    char radio_ifname[32];
+    unsigned long calls;
+    unsigned long n;
+    INT radio_index;
+    INT ssid_index;
+
+    topology_stats_get(&before);
+    calls = test_hal_calls();
+
+    for (n = 0; n < test_lookups; n++)
+    {
+        if (!test_lookup_all())
+        {
+            TEST_CHECK(!"cached lookup mismatch");
+            break;
+        }
+    }
+
+    // Unknown entries of a complete cache don't trigger a rebuild either
+    TEST_CHECK(!topology_radio_ifname_to_idx("wifi9", &radio_index));
+    TEST_CHECK(!topology_radio_idx_to_ifname(3, radio_ifname, sizeof(radio_ifname)));
+    TEST_CHECK(!topology_radio_idx_to_ifname(-1, radio_ifname, sizeof(radio_ifname)));
+    TEST_CHECK(!topology_vif_ifname_to_idx("ath99", &ssid_index));
+    TEST_CHECK(!topology_ssid_index_to_radio(7, NULL, NULL));
+    TEST_CHECK(!topology_ssid_index_to_radio(-1, NULL, NULL));
+    TEST_CHECK(!topology_ssid_index_to_radio(100000, NULL, NULL));
+
+    // Optional outputs and a short ifname buffer
+    TEST_CHECK(topology_ssid_index_to_radio(16, NULL, NULL));
+    TEST_CHECK(topology_radio_idx_to_ifname(2, radio_ifname, 4));
+    TEST_CHECK(!strcmp(radio_ifname, "wif"));
+
+    topology_stats_get(&after);
+    TEST_CHECK(test_hal_calls() == calls);
+    TEST_CHECK(after.misses == before.misses);
+    TEST_CHECK(after.invalidations == before.invalidations);
+    TEST_CHECK(after.hits > before.hits);
+
+    printf("cached:     %lu lookup rounds, %lu HAL calls\n", n, test_hal_calls() - calls);
+}
+
+static void test_invalidate(void)
+{
+    topology_stats_t before;
+    topology_stats_t after;
+    unsigned long calls;
+
+    topology_stats_get(&before);
+    calls = test_hal_calls();
+
+    // Back to back invalidations rebuild once
+    topology_invalidate();
+    topology_invalidate();
+    TEST_CHECK(test_lookup_all());
+    TEST_CHECK(test_lookup_all());
+
+    topology_stats_get(&after);
+    TEST_CHECK(after.invalidations == before.invalidations + 1);
+    TEST_CHECK(after.misses == before.misses + 1);
+    TEST_CHECK(test_hal_calls() > calls);
+
+    printf("invalidate: rebuild took %lu HAL calls\n", test_hal_calls() - calls);
+}
+
+static void *test_thread_run(void *arg)
+{
+    (void)arg;
+
+    while (!__atomic_load_n(&test_stop, __ATOMIC_RELAXED))
+    {
+        if (!test_lookup_all())
+        {
+            TEST_CHECK(!"concurrent lookup mismatch");
+            break;
+        }
+    }
+
+    return NULL;
+}
+
+static void test_concurrent(void)
+{
+    pthread_t threads[TEST_THREADS];
+    topology_stats_t stats;
+    unsigned long n;
+    int i;
+
+    __atomic_store_n(&test_stop, false, __ATOMIC_RELAXED);
+    for (i = 0; i < TEST_THREADS; i++)
+    {
+        if (pthread_create(&threads[i], NULL, test_thread_run, NULL) != 0)
+        {
+            fprintf(stderr, "topology_test: cannot start lookup thread\n");
+            exit(2);
+        }
+    }
+
+    for (n = 0; n < test_lookups / 100; n++)
+    {
+        topology_invalidate();
+        usleep(100);
+    }
+
+    __atomic_store_n(&test_stop, true, __ATOMIC_RELAXED);
+    for (i = 0; i < TEST_THREADS; i++)
+    {
+        pthread_join(threads[i], NULL);
+    }
+
+    topology_stats_get(&stats);
+    printf("concurrent: %d threads, %lu invalidations, %llu hits, %llu misses\n",
+           TEST_THREADS, n, (unsigned long long)stats.hits,
+           (unsigned long long)stats.misses);
+}
+
+int main(int argc, char *argv[])
+{
+    char path[64];
+
+    if (argc > 1) test_lookups = strtoul(argv[1], NULL, 0);
+
+    if (!test_scenario_write(path, sizeof(path)))
+    {
+        fprintf(stderr, "topology_test: cannot write the mock scenario\n");
+        return 2;
+    }
+
+    test_hal_not_ready();
+    test_partial_map();
+    test_cached();
+    test_invalidate();
+    test_concurrent();
+
+    unlink(path);
+
+    printf("topology_test: %d failure(s)\n", test_failed);
+
+    return test_failed ? 1 : 0;
+}
@@ -0,0 +1,506 @@
+/*
+Copyright (c) 2017, Plume Design Inc. All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+   1. Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+   2. Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+   3. Neither the name of the Plume Design Inc. nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL Plume Design Inc. BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+/*
+ * mock_scenario.c
+ *
+ * Scenario loading, simulated latency and HAL event injection for the
+ * libhal_wifi stand-in.
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <unistd.h>
+#include <time.h>
+
+#include "wifi_hal_mock.h"
+
+mock_state_t g_mock =
+{
+    .loaded = false,
+    .lock = PTHREAD_MUTEX_INITIALIZER,
+};
+
+wifi_newApAssociatedDevice_callback     mock_assoc_cb = NULL;
+wifi_apDisassociatedDevice_callback     mock_disassoc_cb = NULL;
+wifi_chan_eventCB_t                     mock_chan_cb = NULL;
+
+static pthread_once_t   mock_once = PTHREAD_ONCE_INIT;
+static pthread_t        mock_event_thread;
+static bool             mock_event_thread_started = false;
+
+static const UINT mock_channels_2g[] = { 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11 };
+static const UINT mock_channels_5g[] = { 36, 40, 44, 48, 52, 56, 60, 64, 100, 104, 108, 112,
+                                         116, 120, 124, 128, 132, 136, 140, 144, 149, 153,
+                                         157, 161, 165 };
+static const UINT mock_channels_6g[] = { 1, 5, 9, 13, 17, 21, 25, 29, 33, 37, 41, 45, 49, 53,
+                                         57, 61, 65, 69, 73, 77, 81, 85, 89, 93 };
+
+/*****************************************************************************/
+
+uint64_t mock_now_usec(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static void mock_radio_set_channels(mock_radio_t *radio)
+{
+    const UINT *list;
+    size_t n;
+
+    switch (radio->band)
+    {
+        case WIFI_FREQUENCY_5_BAND:
+            list = mock_channels_5g;
+            n = sizeof(mock_channels_5g) / sizeof(mock_channels_5g[0]);
+            break;
+        case WIFI_FREQUENCY_6_BAND:
+            list = mock_channels_6g;
+            n = sizeof(mock_channels_6g) / sizeof(mock_channels_6g[0]);
+            break;
+        default:
+            list = mock_channels_2g;
+            n = sizeof(mock_channels_2g) / sizeof(mock_channels_2g[0]);
+            break;
+    }
+
+    memcpy(radio->channels, list, n * sizeof(*list));
+    radio->num_channels = n;
+}
+
+static bool mock_parse_band(const char *s, wifi_freq_bands_t *band)
+{
+    if (!strcmp(s, "2.4G") || !strcmp(s, "2.4")) *band = WIFI_FREQUENCY_2_4_BAND;
+    else if (!strcmp(s, "5G") || !strcmp(s, "5")) *band = WIFI_FREQUENCY_5_BAND;
+    else if (!strcmp(s, "6G") || !strcmp(s, "6")) *band = WIFI_FREQUENCY_6_BAND;
+    else return false;
+
+    return true;
+}
+
+static void mock_add_radio(INT index, const char *ifname, wifi_freq_bands_t band, UINT channel)
+{
+    mock_radio_t *radio;
+
+    if (g_mock.num_radios >= MOCK_MAX_RADIOS) return;
+
+    radio = &g_mock.radios[g_mock.num_radios++];
+    memset(radio, 0, sizeof(*radio));
+    radio->index = index;
+    snprintf(radio->ifname, sizeof(radio->ifname), "%s", ifname);
+    radio->band = band;
+    radio->channel = channel;
+    mock_radio_set_channels(radio);
+}
+
+static void mock_add_vap(INT ssid_index, INT radio_index, const char *ifname, const char *ssid)
+{
+    mock_vap_t *vap;
+
+    if (g_mock.num_vaps >= MOCK_MAX_VAPS) return;
+
+    vap = &g_mock.vaps[g_mock.num_vaps++];
+    memset(vap, 0, sizeof(*vap));
+    vap->ssid_index = ssid_index;
+    vap->radio_index = radio_index;
+    vap->enabled = true;
+    snprintf(vap->ifname, sizeof(vap->ifname), "%s", ifname);
+    snprintf(vap->ssid, sizeof(vap->ssid), "%s", ssid);
+}
+
+/*
+ * Default population used when no scenario file is present: two radios
+ * with a home and a backhaul VAP each, no clients
+ */
+static void mock_load_defaults(void)
+{
+    mock_add_radio(0, "wifi0", WIFI_FREQUENCY_2_4_BAND, 6);
+    mock_add_radio(1, "wifi1", WIFI_FREQUENCY_5_BAND, 44);
+    mock_add_vap(0, 0, "ath0", "mock-home");
+    mock_add_vap(1, 1, "ath1", "mock-home");
+    mock_add_vap(12, 0, "ath12", "mock-bhaul");
+    mock_add_vap(13, 1, "ath13", "mock-bhaul");
+}
+
+static bool mock_parse_line(char *line, int lineno)
+{
+    char *argv[8];
+    int argc = 0;
+    char *save = NULL;
+    char *tok;
+    mock_vap_t *vap;
+    mock_radio_t *radio;
+    wifi_freq_bands_t band;
+
+    for (tok = strtok_r(line, " \t\r\n", &save);
+         tok != NULL && argc < (int)(sizeof(argv) / sizeof(argv[0]));
+         tok = strtok_r(NULL, " \t\r\n", &save))
+    {
+        if (*tok == '#') break;
+        argv[argc++] = tok;
+    }
+
+    if (argc == 0) return true;
+
+    if (!strcmp(argv[0], "radio") && argc >= 5)
+    {
+        // radio <index> <ifname> <2.4G|5G|6G> <channel>
+        if (!mock_parse_band(argv[3], &band)) goto error;
+        mock_add_radio(atoi(argv[1]), argv[2], band, atoi(argv[4]));
+    }
+    else if (!strcmp(argv[0], "vap") && argc >= 5)
+    {
+        // vap <ssid_index> <radio_index> <ifname> <ssid> [disabled]
+        mock_add_vap(atoi(argv[1]), atoi(argv[2]), argv[3], argv[4]);
+        if (argc >= 6 && !strcmp(argv[5], "disabled"))
+        {
+            g_mock.vaps[g_mock.num_vaps - 1].enabled = false;
+        }
+    }
+    else if (!strcmp(argv[0], "clients") && argc >= 3)
+    {
+        // clients <ssid_index> <associated> [pool]
+        vap = mock_vap_get(atoi(argv[1]));
+        if (vap == NULL) goto error;
+        vap->num_clients = strtoul(argv[2], NULL, 0);
+        vap->max_clients = argc >= 4 ? strtoul(argv[3], NULL, 0) : vap->num_clients;
+        if (vap->max_clients < vap->num_clients) vap->max_clients = vap->num_clients;
+    }
+    else if (!strcmp(argv[0], "neighbors") && argc >= 3)
+    {
+        // neighbors <radio_index> <count>
+        radio = mock_radio_get(atoi(argv[1]));
+        if (radio == NULL) goto error;
+        radio->num_neighbors = strtoul(argv[2], NULL, 0);
+    }
+    else if (!strcmp(argv[0], "latency") && argc >= 3)
+    {
+        // latency <function|*> <usec>
+        if (g_mock.num_latency >= MOCK_MAX_LATENCY) goto error;
+        snprintf(g_mock.latency[g_mock.num_latency].func,
+                 sizeof(g_mock.latency[0].func), "%s", argv[1]);
+        g_mock.latency[g_mock.num_latency].usec = strtoul(argv[2], NULL, 0);
+        g_mock.num_latency++;
+    }
+    else if (!strcmp(argv[0], "fail") && argc >= 3)
+    {
+        // fail <function> <count>
+        if (g_mock.num_fail >= MOCK_MAX_FAIL) goto error;
+        snprintf(g_mock.fail[g_mock.num_fail].func,
+                 sizeof(g_mock.fail[0].func), "%s", argv[1]);
+        g_mock.fail[g_mock.num_fail].count = strtoul(argv[2], NULL, 0);
+        g_mock.num_fail++;
+    }
+    else if (!strcmp(argv[0], "list_counters") && argc >= 2)
+    {
+        // list_counters <on|off>
+        if (!strcmp(argv[1], "on")) g_mock.no_list_counters = false;
+        else if (!strcmp(argv[1], "off")) g_mock.no_list_counters = true;
+        else goto error;
+    }
+    else if (!strcmp(argv[0], "event") && argc >= 5)
+    {
+        // event <assoc|disassoc|chan> <index> <count> <interval_ms>
+        mock_event_t *ev;
+
+        if (g_mock.num_events >= MOCK_MAX_EVENTS) goto error;
+        ev = &g_mock.events[g_mock.num_events];
+
+        if (!strcmp(argv[1], "assoc")) ev->type = MOCK_EVENT_ASSOC;
+        else if (!strcmp(argv[1], "disassoc")) ev->type = MOCK_EVENT_DISASSOC;
+        else if (!strcmp(argv[1], "chan")) ev->type = MOCK_EVENT_CHAN;
+        else goto error;
+
+        ev->index = atoi(argv[2]);
+        ev->count = strtoul(argv[3], NULL, 0);
+        ev->interval_ms = strtoul(argv[4], NULL, 0);
+        g_mock.num_events++;
+    }
+    else
+    {
+        goto error;
+    }
+
+    return true;
+
+error:
+    MOCK_LOG("scenario line %d: invalid or unsupported entry '%s'", lineno, argv[0]);
+    return false;
+}
+
+static void mock_load(void)
+{
+    const char *path;
+    char line[256];
+    int lineno = 0;
+    FILE *f;
+
+    g_mock.start_usec = mock_now_usec();
+
+    path = getenv(MOCK_SCENARIO_ENV);
+    if (path == NULL) path = MOCK_SCENARIO_DEFAULT;
+
+    f = fopen(path, "r");
+    if (f == NULL)
+    {
+        MOCK_LOG("no scenario at %s, using default population", path);
+        mock_load_defaults();
+    }
+    else
+    {
+        while (fgets(line, sizeof(line), f) != NULL)
+        {
+            mock_parse_line(line, ++lineno);
+        }
+        fclose(f);
+
+        if (g_mock.num_radios == 0) mock_load_defaults();
+    }
+
+    MOCK_LOG("loaded %u radios, %u VAPs, %u latency rules, %u events",
+             g_mock.num_radios, g_mock.num_vaps, g_mock.num_latency, g_mock.num_events);
+
+    g_mock.loaded = true;
+}
+
+void mock_init(void)
+{
+    pthread_once(&mock_once, mock_load);
+}
+
+/*****************************************************************************/
+
+void mock_delay(const char *func)
+{
+    unsigned int usec = 0;
+    UINT i;
+
+    __atomic_add_fetch(&g_mock.num_calls, 1, __ATOMIC_RELAXED);
+
+    for (i = 0; i < g_mock.num_latency; i++)
+    {
+        if (!strcmp(g_mock.latency[i].func, func))
+        {
+            usec = g_mock.latency[i].usec;
+            break;
+        }
+        if (!strcmp(g_mock.latency[i].func, "*"))
+        {
+            usec = g_mock.latency[i].usec;
+        }
+    }
+
+    if (usec > 0) usleep(usec);
+}
+
+/* Consumes one injected failure of the given HAL function, if any is left */
+bool mock_fail(const char *func)
+{
+    bool fail = false;
+    UINT i;
+
+    pthread_mutex_lock(&g_mock.lock);
+    for (i = 0; i < g_mock.num_fail; i++)
+    {
+        if (g_mock.fail[i].count > 0 && !strcmp(g_mock.fail[i].func, func))
+        {
+            g_mock.fail[i].count--;
+            fail = true;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&g_mock.lock);
+
+    return fail;
+}
+
+mock_radio_t *mock_radio_get(INT radio_index)
+{
+    UINT i;
+
+    for (i = 0; i < g_mock.num_radios; i++)
+    {
+        if (g_mock.radios[i].index == radio_index) return &g_mock.radios[i];
+    }
+    return NULL;
+}
+
+mock_vap_t *mock_vap_get(INT ssid_index)
+{
+    UINT i;
+
+    for (i = 0; i < g_mock.num_vaps; i++)
+    {
+        if (g_mock.vaps[i].ssid_index == ssid_index) return &g_mock.vaps[i];
+    }
+    return NULL;
+}
+
+/*
+ * Client MACs are derived from the SSID index and the client number, so
+ * the same client keeps its address across calls and events
+ */
+void mock_client_mac(INT ssid_index, UINT n, mac_address_t mac)
+{
+    mac[0] = 0x02;  // Locally administered
+    mac[1] = 0xaa;
+    mac[2] = (UCHAR)ssid_index;
+    mac[3] = (UCHAR)(n >> 16);
+    mac[4] = (UCHAR)(n >> 8);
+    mac[5] = (UCHAR)n;
+}
+
+/*****************************************************************************/
+
+static void mock_event_fire(mock_event_t *ev, UINT seq)
+{
+    mock_vap_t *vap;
+    UINT n;
+
+    switch (ev->type)
+    {
+        case MOCK_EVENT_ASSOC:
+        case MOCK_EVENT_DISASSOC:
+        {
+#ifdef WIFI_HAL_VERSION_3_PHASE2
+            wifi_associated_dev3_t sta;
+#else
+            wifi_associated_dev_t sta;
+#endif
+            char mac[18];
+
+            vap = mock_vap_get(ev->index);
+            if (vap == NULL) return;
+
+            // Roam through the whole client pool
+            n = vap->max_clients > 0 ? seq % vap->max_clients : seq;
+
+            memset(&sta, 0, sizeof(sta));
+            mock_client_mac(vap->ssid_index, n, sta.cli_MACAddress);
+
+            if (ev->type == MOCK_EVENT_ASSOC)
+            {
+                sta.cli_Active = true;
+                if (mock_assoc_cb != NULL) mock_assoc_cb(vap->ssid_index, &sta);
+            }
+            else
+            {
+                snprintf(mac, sizeof(mac), "%02x:%02x:%02x:%02x:%02x:%02x",
+                         sta.cli_MACAddress[0], sta.cli_MACAddress[1], sta.cli_MACAddress[2],
+                         sta.cli_MACAddress[3], sta.cli_MACAddress[4], sta.cli_MACAddress[5]);
+                if (mock_disassoc_cb != NULL) mock_disassoc_cb(vap->ssid_index, mac, 0);
+            }
+            break;
+        }
+
+        case MOCK_EVENT_CHAN:
+        {
+            mock_radio_t *radio = mock_radio_get(ev->index);
+
+            if (radio == NULL || radio->num_channels == 0) return;
+
+            radio->channel = radio->channels[seq % radio->num_channels];
+            if (mock_chan_cb != NULL)
+            {
+                mock_chan_cb(radio->index, WIFI_EVENT_CHANNELS_CHANGED, radio->channel);
+            }
+            break;
+        }
+    }
+}
+
+/*
+ * Fires all scripted events in time order from a dedicated thread, the
+ * same way a vendor HAL delivers callbacks
+ */
+static void *mock_event_thread_fn(void *arg)
+{
+    uint64_t next[MOCK_MAX_EVENTS];
+    UINT fired[MOCK_MAX_EVENTS];
+    uint64_t now;
+    uint64_t wake;
+    bool pending;
+    UINT i;
+
+    (void)arg;
+
+    now = mock_now_usec();
+    for (i = 0; i < g_mock.num_events; i++)
+    {
+        next[i] = now + (uint64_t)g_mock.events[i].interval_ms * 1000;
+        fired[i] = 0;
+    }
+
+    for (;;)
+    {
+        pending = false;
+        wake = UINT64_MAX;
+        now = mock_now_usec();
+
+        for (i = 0; i < g_mock.num_events; i++)
+        {
+            mock_event_t *ev = &g_mock.events[i];
+
+            if (ev->count != 0 && fired[i] >= ev->count) continue;
+            pending = true;
+
+            if (next[i] <= now)
+            {
+                mock_event_fire(ev, fired[i]++);
+                next[i] += (uint64_t)ev->interval_ms * 1000;
+            }
+            if (next[i] < wake) wake = next[i];
+        }
+
+        if (!pending) break;
+
+        now = mock_now_usec();
+        if (wake > now) usleep(wake - now);
+    }
+
+    MOCK_LOG("all scripted events delivered");
+    return NULL;
+}
+
+void mock_events_start(void)
+{
+    pthread_mutex_lock(&g_mock.lock);
+    if (!mock_event_thread_started && g_mock.num_events > 0)
+    {
+        if (pthread_create(&mock_event_thread, NULL, mock_event_thread_fn, NULL) == 0)
+        {
+            pthread_detach(mock_event_thread);
+            mock_event_thread_started = true;
+        }
+    }
+    pthread_mutex_unlock(&g_mock.lock);
+}
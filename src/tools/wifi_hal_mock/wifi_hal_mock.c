@@ -0,0 +1,925 @@
+/*
+Copyright (c) 2017, Plume Design Inc. All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+   1. Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+   2. Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+   3. Neither the name of the Plume Design Inc. nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL Plume Design Inc. BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+/*
+ * wifi_hal_mock.c
+ *
+ * libhal_wifi entry points used by the RDK target layer, answered from the
+ * scenario loaded by mock_scenario.c. Only the structure fields the target
+ * layer reads are filled in.
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+#include "wifi_hal_mock.h"
+
+#define MOCK_MAC_FMT    "%02x:%02x:%02x:%02x:%02x:%02x"
+#define MOCK_MAC_ARG(m) (m)[0], (m)[1], (m)[2], (m)[3], (m)[4], (m)[5]
+
+static mac_address_t    mock_acl[MOCK_MAX_VAPS][MOCK_MAX_ACL];
+static UINT             mock_acl_num[MOCK_MAX_VAPS];
+
+/*
+ * Counters grow linearly with time since the scenario was loaded, scaled
+ * per client, so consecutive stats polls produce sensible deltas
+ */
+static uint64_t mock_counter(UINT n, uint64_t rate)
+{
+    uint64_t secs = (mock_now_usec() - g_mock.start_usec) / 1000000;
+
+    return secs * rate * (n + 1);
+}
+
+static int mock_vap_slot(mock_vap_t *vap)
+{
+    return (int)(vap - g_mock.vaps);
+}
+
+static mock_vap_t *mock_vap_by_mac(INT ssid_index, const mac_address_t mac, UINT *n)
+{
+    mock_vap_t *vap = mock_vap_get(ssid_index);
+    mac_address_t cmac;
+    UINT i;
+
+    if (vap == NULL) return NULL;
+
+    for (i = 0; i < vap->num_clients; i++)
+    {
+        mock_client_mac(ssid_index, i, cmac);
+        if (!memcmp(cmac, mac, sizeof(cmac)))
+        {
+            if (n != NULL) *n = i;
+            return vap;
+        }
+    }
+    return NULL;
+}
+
+/*****************************************************************************
+ * Topology
+ *****************************************************************************/
+
+INT wifi_getHalCapability(wifi_hal_capability_t *cap)
+{
+    UINT i;
+
+    MOCK_ENTER();
+    if (mock_fail(__func__)) return RETURN_ERR;
+
+    memset(cap, 0, sizeof(*cap));
+    cap->version.major = 3;
+    cap->version.minor = 0;
+    cap->wifi_prop.numRadios = g_mock.num_radios;
+
+    for (i = 0; i < g_mock.num_radios; i++)
+    {
+        cap->wifi_prop.radiocap[i].index = g_mock.radios[i].index;
+        cap->wifi_prop.radiocap[i].zeroDFSSupported = false;
+    }
+
+    for (i = 0; i < g_mock.num_vaps; i++)
+    {
+        cap->wifi_prop.interface_map[i].index = g_mock.vaps[i].ssid_index;
+        cap->wifi_prop.interface_map[i].rdk_radio_index = g_mock.vaps[i].radio_index;
+        snprintf(cap->wifi_prop.interface_map[i].vap_name,
+                 sizeof(cap->wifi_prop.interface_map[i].vap_name), "%s", g_mock.vaps[i].ifname);
+    }
+
+    return RETURN_OK;
+}
+
+INT wifi_getRadioNumberOfEntries(ULONG *output)
+{
+    MOCK_ENTER();
+
+    *output = g_mock.num_radios;
+    return RETURN_OK;
+}
+
+INT wifi_getSSIDNumberOfEntries(ULONG *output)
+{
+    MOCK_ENTER();
+
+    *output = g_mock.num_vaps;
+    return RETURN_OK;
+}
+
+INT wifi_getRadioIfName(INT radioIndex, CHAR *output_string)
+{
+    mock_radio_t *radio;
+
+    MOCK_ENTER();
+    if (mock_fail(__func__)) return RETURN_ERR;
+
+    radio = mock_radio_get(radioIndex);
+    if (radio == NULL) return RETURN_ERR;
+
+    strcpy(output_string, radio->ifname);
+    return RETURN_OK;
+}
+
+INT wifi_getRadioOperatingFrequencyBand(INT radioIndex, CHAR *output_string)
+{
+    mock_radio_t *radio;
+
+    MOCK_ENTER();
+
+    radio = mock_radio_get(radioIndex);
+    if (radio == NULL) return RETURN_ERR;
+
+    switch (radio->band)
+    {
+        case WIFI_FREQUENCY_5_BAND: strcpy(output_string, "5GHz"); break;
+        case WIFI_FREQUENCY_6_BAND: strcpy(output_string, "6GHz"); break;
+        default:                    strcpy(output_string, "2.4GHz"); break;
+    }
+    return RETURN_OK;
+}
+
+INT wifi_getSSIDRadioIndex(INT ssidIndex, INT *radioIndex)
+{
+    mock_vap_t *vap;
+
+    MOCK_ENTER();
+
+    vap = mock_vap_get(ssidIndex);
+    if (vap == NULL) return RETURN_ERR;
+
+    *radioIndex = vap->radio_index;
+    return RETURN_OK;
+}
+
+INT wifi_getApName(INT apIndex, CHAR *output_string)
+{
+    mock_vap_t *vap;
+
+    MOCK_ENTER();
+
+    vap = mock_vap_get(apIndex);
+    if (vap == NULL) return RETURN_ERR;
+
+    strcpy(output_string, vap->ifname);
+    return RETURN_OK;
+}
+
+INT wifi_getSSIDName(INT apIndex, CHAR *output_string)
+{
+    mock_vap_t *vap;
+
+    MOCK_ENTER();
+
+    vap = mock_vap_get(apIndex);
+    if (vap == NULL) return RETURN_ERR;
+
+    strcpy(output_string, vap->ssid);
+    return RETURN_OK;
+}
+
+INT wifi_getSSIDNameStatus(INT apIndex, CHAR *output_string)
+{
+    return wifi_getSSIDName(apIndex, output_string);
+}
+
+INT wifi_getSSIDEnable(INT ssidIndex, BOOL *output_bool)
+{
+    mock_vap_t *vap;
+
+    MOCK_ENTER();
+
+    vap = mock_vap_get(ssidIndex);
+    if (vap == NULL) return RETURN_ERR;
+
+    *output_bool = vap->enabled;
+    return RETURN_OK;
+}
+
+INT wifi_getRadioVapInfoMap(wifi_radio_index_t index, wifi_vap_info_map_t *map)
+{
+    wifi_vap_info_t *vap_info;
+    UINT i;
+
+    MOCK_ENTER();
+    if (mock_fail(__func__)) return RETURN_ERR;
+
+    if (mock_radio_get(index) == NULL) return RETURN_ERR;
+
+    memset(map, 0, sizeof(*map));
+    for (i = 0; i < g_mock.num_vaps && map->num_vaps < MAX_NUM_VAP_PER_RADIO; i++)
+    {
+        mock_vap_t *vap = &g_mock.vaps[i];
+
+        if (vap->radio_index != (INT)index) continue;
+
+        vap_info = &map->vap_array[map->num_vaps++];
+        vap_info->vap_index = vap->ssid_index;
+        vap_info->radio_index = vap->radio_index;
+        vap_info->vap_mode = wifi_vap_mode_ap;
+        snprintf(vap_info->vap_name, sizeof(vap_info->vap_name), "%s", vap->ifname);
+        snprintf(vap_info->u.bss_info.ssid, sizeof(vap_info->u.bss_info.ssid), "%s", vap->ssid);
+        vap_info->u.bss_info.enabled = vap->enabled;
+        vap_info->u.bss_info.showSsid = true;
+    }
+
+    return RETURN_OK;
+}
+
+INT wifi_createVAP(wifi_radio_index_t index, wifi_vap_info_map_t *map)
+{
+    UINT i;
+
+    MOCK_ENTER();
+
+    if (mock_radio_get(index) == NULL) return RETURN_ERR;
+
+    pthread_mutex_lock(&g_mock.lock);
+    for (i = 0; i < map->num_vaps; i++)
+    {
+        wifi_vap_info_t *vap_info = &map->vap_array[i];
+        mock_vap_t *vap = mock_vap_get(vap_info->vap_index);
+
+        if (vap == NULL) continue;
+
+        vap->enabled = vap_info->u.bss_info.enabled;
+        snprintf(vap->ssid, sizeof(vap->ssid), "%s", vap_info->u.bss_info.ssid);
+    }
+    pthread_mutex_unlock(&g_mock.lock);
+
+    return RETURN_OK;
+}
+
+INT wifi_getRadioOperatingParameters(wifi_radio_index_t index, wifi_radio_operationParam_t *operationParam)
+{
+    mock_radio_t *radio;
+
+    MOCK_ENTER();
+
+    radio = mock_radio_get(index);
+    if (radio == NULL) return RETURN_ERR;
+
+    memset(operationParam, 0, sizeof(*operationParam));
+    operationParam->enable = true;
+    operationParam->band = radio->band;
+    operationParam->channel = radio->channel;
+    operationParam->countryCode = wifi_countrycode_US;
+
+    if (radio->band == WIFI_FREQUENCY_2_4_BAND)
+    {
+        operationParam->channelWidth = WIFI_CHANNELBANDWIDTH_20MHZ;
+        operationParam->variant = WIFI_80211_VARIANT_N | WIFI_80211_VARIANT_AX;
+    }
+    else
+    {
+        operationParam->channelWidth = WIFI_CHANNELBANDWIDTH_80MHZ;
+        operationParam->variant = WIFI_80211_VARIANT_AC | WIFI_80211_VARIANT_AX;
+    }
+
+    return RETURN_OK;
+}
+
+/*****************************************************************************
+ * Radio control
+ *****************************************************************************/
+
+INT wifi_getRadioChannels(INT radioIndex, wifi_channelMap_t *output_map, INT output_map_size)
+{
+    mock_radio_t *radio;
+    INT i;
+
+    MOCK_ENTER();
+
+    radio = mock_radio_get(radioIndex);
+    if (radio == NULL) return RETURN_ERR;
+
+    memset(output_map, 0, sizeof(*output_map) * output_map_size);
+    for (i = 0; i < output_map_size && i < (INT)radio->num_channels; i++)
+    {
+        output_map[i].ch_number = radio->channels[i];
+        output_map[i].ch_state = CHAN_STATE_AVAILABLE;
+    }
+    return RETURN_OK;
+}
+
+INT wifi_getRadioPossibleChannels(INT radioIndex, CHAR *output_string)
+{
+    mock_radio_t *radio;
+    UINT i;
+
+    MOCK_ENTER();
+
+    radio = mock_radio_get(radioIndex);
+    if (radio == NULL) return RETURN_ERR;
+
+    output_string[0] = '\0';
+    for (i = 0; i < radio->num_channels; i++)
+    {
+        sprintf(output_string + strlen(output_string), "%s%u", i ? "," : "", radio->channels[i]);
+    }
+    return RETURN_OK;
+}
+
+INT wifi_pushRadioChannel2(INT radioIndex, UINT channel, UINT channel_width_MHz, UINT csa_beacon_count)
+{
+    mock_radio_t *radio;
+
+    (void)channel_width_MHz;
+    (void)csa_beacon_count;
+
+    MOCK_ENTER();
+
+    radio = mock_radio_get(radioIndex);
+    if (radio == NULL) return RETURN_ERR;
+
+    radio->channel = channel;
+    if (mock_chan_cb != NULL) mock_chan_cb(radioIndex, WIFI_EVENT_CHANNELS_CHANGED, channel);
+    return RETURN_OK;
+}
+
+INT wifi_getRadioTransmitPower(INT radioIndex, ULONG *output_ulong)
+{
+    MOCK_ENTER();
+
+    if (mock_radio_get(radioIndex) == NULL) return RETURN_ERR;
+
+    *output_ulong = 20;
+    return RETURN_OK;
+}
+
+INT wifi_setRadioEnable(INT radioIndex, BOOL enable)
+{
+    (void)enable;
+
+    MOCK_ENTER();
+
+    return mock_radio_get(radioIndex) != NULL ? RETURN_OK : RETURN_ERR;
+}
+
+INT wifi_setRadioStatsEnable(INT radioIndex, BOOL enable)
+{
+    (void)enable;
+
+    MOCK_ENTER();
+
+    return mock_radio_get(radioIndex) != NULL ? RETURN_OK : RETURN_ERR;
+}
+
+INT wifi_getZeroDFSState(wifi_radio_index_t radioIndex, BOOL *enable, BOOL *precac)
+{
+    MOCK_ENTER();
+
+    if (mock_radio_get(radioIndex) == NULL) return RETURN_ERR;
+
+    *enable = false;
+    *precac = false;
+    return RETURN_OK;
+}
+
+INT wifi_setZeroDFSState(wifi_radio_index_t radioIndex, BOOL enable, BOOL precac)
+{
+    (void)enable;
+    (void)precac;
+
+    MOCK_ENTER();
+
+    return mock_radio_get(radioIndex) != NULL ? RETURN_OK : RETURN_ERR;
+}
+
+/*****************************************************************************
+ * Clients and statistics
+ *****************************************************************************/
+
+INT wifi_getApAssociatedDeviceDiagnosticResult3(
+        INT apIndex,
+        wifi_associated_dev3_t **associated_dev_array,
+        UINT *output_array_size)
+{
+    wifi_associated_dev3_t *devs;
+    mock_vap_t *vap;
+    UINT i;
+
+    MOCK_ENTER();
+
+    *associated_dev_array = NULL;
+    *output_array_size = 0;
+
+    vap = mock_vap_get(apIndex);
+    if (vap == NULL) return RETURN_ERR;
+    if (vap->num_clients == 0) return RETURN_OK;
+
+    // Caller releases the array with free()
+    devs = calloc(vap->num_clients, sizeof(*devs));
+    if (devs == NULL) return RETURN_ERR;
+
+    for (i = 0; i < vap->num_clients; i++)
+    {
+        mock_client_mac(apIndex, i, devs[i].cli_MACAddress);
+        devs[i].cli_Active = true;
+        devs[i].cli_SNR = 20 + (i % 40);
+        devs[i].cli_LastDataDownlinkRate = 866000;
+        devs[i].cli_LastDataUplinkRate = 433000;
+        if (g_mock.no_list_counters) continue;
+
+        devs[i].cli_BytesSent = mock_counter(i, 125000);
+        devs[i].cli_BytesReceived = mock_counter(i, 25000);
+        devs[i].cli_PacketsSent = mock_counter(i, 100);
+        devs[i].cli_PacketsReceived = mock_counter(i, 20);
+        devs[i].cli_RetransCount = mock_counter(i, 2);
+        devs[i].cli_ErrorsSent = 0;
+    }
+
+    *associated_dev_array = devs;
+    *output_array_size = vap->num_clients;
+    return RETURN_OK;
+}
+
+INT wifi_getApAssociatedDeviceStats(
+        INT apIndex,
+        mac_address_t *clientMacAddress,
+        wifi_associated_dev_stats_t *associated_dev_stats,
+        ULLONG *handle)
+{
+    UINT n;
+
+    MOCK_ENTER();
+
+    if (mock_vap_by_mac(apIndex, *clientMacAddress, &n) == NULL) return RETURN_ERR;
+
+    memset(associated_dev_stats, 0, sizeof(*associated_dev_stats));
+    associated_dev_stats->cli_tx_bytes = mock_counter(n, 125000);
+    associated_dev_stats->cli_rx_bytes = mock_counter(n, 25000);
+    associated_dev_stats->cli_tx_frames = mock_counter(n, 100);
+    associated_dev_stats->cli_rx_frames = mock_counter(n, 20);
+    associated_dev_stats->cli_tx_retries = mock_counter(n, 2);
+    associated_dev_stats->cli_rx_retries = mock_counter(n, 1);
+    associated_dev_stats->cli_tx_errors = 0;
+    associated_dev_stats->cli_rx_errors = 0;
+    associated_dev_stats->cli_tx_rate = 866;
+    associated_dev_stats->cli_rx_rate = 433;
+
+    *handle = ((ULLONG)apIndex << 32) | n;
+    return RETURN_OK;
+}
+
+INT wifi_getApSecurityModeEnabled(INT apIndex, CHAR *output)
+{
+    MOCK_ENTER();
+
+    if (mock_vap_get(apIndex) == NULL) return RETURN_ERR;
+
+    strcpy(output, "WPA2-Personal");
+    return RETURN_OK;
+}
+
+INT wifi_getRadioChannelStats(INT radioIndex, wifi_channelStats_t *input_output_channelStats_array, INT array_size)
+{
+    wifi_channelStats_t *ch;
+    mock_radio_t *radio;
+    uint64_t elapsed;
+    INT i;
+
+    MOCK_ENTER();
+
+    radio = mock_radio_get(radioIndex);
+    if (radio == NULL) return RETURN_ERR;
+
+    // Survey counters are cumulative, in microseconds of air time
+    elapsed = mock_now_usec() - g_mock.start_usec;
+
+    for (i = 0; i < array_size; i++)
+    {
+        ch = &input_output_channelStats_array[i];
+        if (!ch->ch_in_pool) continue;
+
+        ch->ch_noise = -95;
+        ch->ch_utilization_total = elapsed;
+        ch->ch_utilization_busy = elapsed / 4;
+        ch->ch_utilization_busy_tx = elapsed / 10;
+        ch->ch_utilization_busy_rx = elapsed / 10;
+        ch->ch_utilization_busy_self = elapsed / 20;
+        ch->ch_utilization_busy_ext = (ch->ch_number == (INT)radio->channel) ? 0 : elapsed / 50;
+    }
+    return RETURN_OK;
+}
+
+/*****************************************************************************
+ * Neighbor scan
+ *****************************************************************************/
+
+INT wifi_startNeighborScan(INT apIndex, wifi_neighborScanMode_t scan_mode, INT dwell_time, UINT chan_num, UINT *chan_list)
+{
+    (void)scan_mode;
+    (void)dwell_time;
+    (void)chan_num;
+    (void)chan_list;
+
+    MOCK_ENTER();
+
+    return mock_vap_get(apIndex) != NULL ? RETURN_OK : RETURN_ERR;
+}
+
+#ifdef WIFI_HAL_VERSION_3_PHASE2
+INT wifi_getNeighboringWiFiStatus(INT radio_index, BOOL scan, wifi_neighbor_ap2_t **neighbor_ap_array, UINT *output_array_size)
+#else
+INT wifi_getNeighboringWiFiStatus(INT radio_index, wifi_neighbor_ap2_t **neighbor_ap_array, UINT *output_array_size)
+#endif
+{
+    wifi_neighbor_ap2_t *aps;
+    mock_radio_t *radio;
+    UINT i;
+
+#ifdef WIFI_HAL_VERSION_3_PHASE2
+    (void)scan;
+#endif
+
+    MOCK_ENTER();
+
+    *neighbor_ap_array = NULL;
+    *output_array_size = 0;
+
+    radio = mock_radio_get(radio_index);
+    if (radio == NULL) return RETURN_ERR;
+    if (radio->num_neighbors == 0) return RETURN_OK;
+
+    // Caller releases the array with free()
+    aps = calloc(radio->num_neighbors, sizeof(*aps));
+    if (aps == NULL) return RETURN_ERR;
+
+    for (i = 0; i < radio->num_neighbors; i++)
+    {
+        snprintf(aps[i].ap_SSID, sizeof(aps[i].ap_SSID), "mock-nbr-%u", i);
+        snprintf(aps[i].ap_BSSID, sizeof(aps[i].ap_BSSID), "02:bb:%02x:%02x:%02x:%02x",
+                 radio->index & 0xff, (i >> 16) & 0xff, (i >> 8) & 0xff, i & 0xff);
+        aps[i].ap_Channel = radio->channels[i % radio->num_channels];
+        aps[i].ap_SignalStrength = -40 - (INT)(i % 50);
+        snprintf(aps[i].ap_OperatingChannelBandwidth, sizeof(aps[i].ap_OperatingChannelBandwidth),
+                 "%s", radio->band == WIFI_FREQUENCY_2_4_BAND ? "20MHz" : "80MHz");
+    }
+
+    *neighbor_ap_array = aps;
+    *output_array_size = radio->num_neighbors;
+    return RETURN_OK;
+}
+
+/*****************************************************************************
+ * ACL
+ *****************************************************************************/
+
+INT wifi_getApAclDeviceNum(INT apIndex, UINT *output_uint)
+{
+    mock_vap_t *vap;
+
+    MOCK_ENTER();
+
+    vap = mock_vap_get(apIndex);
+    if (vap == NULL) return RETURN_ERR;
+
+    *output_uint = mock_acl_num[mock_vap_slot(vap)];
+    return RETURN_OK;
+}
+
+#ifdef WIFI_HAL_VERSION_3_PHASE2
+INT wifi_getApAclDevices(INT apIndex, mac_address_t *macArray, UINT maxArraySize, UINT *output_numEntries)
+{
+    mock_vap_t *vap;
+    UINT num;
+
+    MOCK_ENTER();
+
+    vap = mock_vap_get(apIndex);
+    if (vap == NULL) return RETURN_ERR;
+
+    num = mock_acl_num[mock_vap_slot(vap)];
+    if (num > maxArraySize) num = maxArraySize;
+
+    memcpy(macArray, mock_acl[mock_vap_slot(vap)], num * sizeof(mac_address_t));
+    *output_numEntries = num;
+    return RETURN_OK;
+}
+
+INT wifi_addApAclDevice(INT apIndex, mac_address_t DeviceMacAddress)
+{
+    mock_vap_t *vap;
+    int slot;
+
+    MOCK_ENTER();
+
+    vap = mock_vap_get(apIndex);
+    if (vap == NULL) return RETURN_ERR;
+
+    slot = mock_vap_slot(vap);
+    if (mock_acl_num[slot] >= MOCK_MAX_ACL) return RETURN_ERR;
+
+    memcpy(mock_acl[slot][mock_acl_num[slot]++], DeviceMacAddress, sizeof(mac_address_t));
+    return RETURN_OK;
+}
+
+INT wifi_delApAclDevice(INT apIndex, mac_address_t DeviceMacAddress)
+{
+    mock_vap_t *vap;
+    UINT i;
+    int slot;
+
+    MOCK_ENTER();
+
+    vap = mock_vap_get(apIndex);
+    if (vap == NULL) return RETURN_ERR;
+
+    slot = mock_vap_slot(vap);
+    for (i = 0; i < mock_acl_num[slot]; i++)
+    {
+        if (memcmp(mock_acl[slot][i], DeviceMacAddress, sizeof(mac_address_t))) continue;
+
+        memmove(mock_acl[slot][i], mock_acl[slot][i + 1],
+                (mock_acl_num[slot] - i - 1) * sizeof(mac_address_t));
+        mock_acl_num[slot]--;
+        return RETURN_OK;
+    }
+    return RETURN_ERR;
+}
+#else
+static bool mock_acl_parse(const CHAR *str, mac_address_t mac)
+{
+    unsigned int b[6];
+    int i;
+
+    if (sscanf(str, "%x:%x:%x:%x:%x:%x", &b[0], &b[1], &b[2], &b[3], &b[4], &b[5]) != 6)
+    {
+        return false;
+    }
+    for (i = 0; i < 6; i++) mac[i] = (UCHAR)b[i];
+    return true;
+}
+
+INT wifi_getApAclDevices(INT apIndex, CHAR *macArray, UINT buf_size)
+{
+    mock_vap_t *vap;
+    char entry[20];
+    size_t len = 0;
+    UINT i;
+    int slot;
+
+    MOCK_ENTER();
+
+    vap = mock_vap_get(apIndex);
+    if (vap == NULL) return RETURN_ERR;
+
+    // Legacy format: newline separated MAC addresses
+    slot = mock_vap_slot(vap);
+    macArray[0] = '\0';
+    for (i = 0; i < mock_acl_num[slot]; i++)
+    {
+        snprintf(entry, sizeof(entry), MOCK_MAC_FMT "\n", MOCK_MAC_ARG(mock_acl[slot][i]));
+        if (len + strlen(entry) + 1 > buf_size) return RETURN_ERR;
+        strcpy(macArray + len, entry);
+        len += strlen(entry);
+    }
+    return RETURN_OK;
+}
+
+INT wifi_addApAclDevice(INT apIndex, CHAR *DeviceMacAddress)
+{
+    mock_vap_t *vap;
+    int slot;
+
+    MOCK_ENTER();
+
+    vap = mock_vap_get(apIndex);
+    if (vap == NULL) return RETURN_ERR;
+
+    slot = mock_vap_slot(vap);
+    if (mock_acl_num[slot] >= MOCK_MAX_ACL) return RETURN_ERR;
+    if (!mock_acl_parse(DeviceMacAddress, mock_acl[slot][mock_acl_num[slot]])) return RETURN_ERR;
+
+    mock_acl_num[slot]++;
+    return RETURN_OK;
+}
+
+INT wifi_delApAclDevice(INT apIndex, CHAR *DeviceMacAddress)
+{
+    mac_address_t mac;
+    mock_vap_t *vap;
+    UINT i;
+    int slot;
+
+    MOCK_ENTER();
+
+    vap = mock_vap_get(apIndex);
+    if (vap == NULL) return RETURN_ERR;
+    if (!mock_acl_parse(DeviceMacAddress, mac)) return RETURN_ERR;
+
+    slot = mock_vap_slot(vap);
+    for (i = 0; i < mock_acl_num[slot]; i++)
+    {
+        if (memcmp(mock_acl[slot][i], mac, sizeof(mac))) continue;
+
+        memmove(mock_acl[slot][i], mock_acl[slot][i + 1],
+                (mock_acl_num[slot] - i - 1) * sizeof(mac_address_t));
+        mock_acl_num[slot]--;
+        return RETURN_OK;
+    }
+    return RETURN_ERR;
+}
+#endif
+
+INT wifi_delApAclDevices(INT apIndex)
+{
+    mock_vap_t *vap;
+
+    MOCK_ENTER();
+
+    vap = mock_vap_get(apIndex);
+    if (vap == NULL) return RETURN_ERR;
+
+    mock_acl_num[mock_vap_slot(vap)] = 0;
+    return RETURN_OK;
+}
+
+/*****************************************************************************
+ * Callbacks
+ *****************************************************************************/
+
+void wifi_newApAssociatedDevice_callback_register(wifi_newApAssociatedDevice_callback callback_proc)
+{
+    mock_init();
+    mock_assoc_cb = callback_proc;
+    mock_events_start();
+}
+
+void wifi_apDisassociatedDevice_callback_register(wifi_apDisassociatedDevice_callback callback_proc)
+{
+    mock_init();
+    mock_disassoc_cb = callback_proc;
+    mock_events_start();
+}
+
+INT wifi_chan_eventRegister(wifi_chan_eventCB_t event_cb)
+{
+    mock_init();
+    mock_chan_cb = event_cb;
+    mock_events_start();
+    return RETURN_OK;
+}
+
+/*****************************************************************************
+ * Steering
+ *
+ * Accepted and discarded; no steering events are generated.
+ *****************************************************************************/
+
+INT wifi_steering_eventRegister(wifi_steering_eventCB_t event_cb)
+{
+    (void)event_cb;
+
+    MOCK_ENTER();
+
+    return RETURN_OK;
+}
+
+void wifi_steering_eventUnregister(void)
+{
+}
+
+#ifdef WIFI_HAL_VERSION_3_PHASE2
+INT wifi_steering_setGroup(UINT steeringgroupIndex, UINT numElements, wifi_steering_apConfig_t *cfgArray)
+{
+    (void)steeringgroupIndex;
+    (void)numElements;
+    (void)cfgArray;
+
+    MOCK_ENTER();
+
+    return RETURN_OK;
+}
+#else
+INT wifi_steering_setGroup(UINT steeringgroupIndex, wifi_steering_apConfig_t *cfg_2, wifi_steering_apConfig_t *cfg_5)
+{
+    (void)steeringgroupIndex;
+    (void)cfg_2;
+    (void)cfg_5;
+
+    MOCK_ENTER();
+
+    return RETURN_OK;
+}
+#endif
+
+INT wifi_steering_clientSet(UINT steeringgroupIndex, INT apIndex, mac_address_t client_mac,
+                            wifi_steering_clientConfig_t *config)
+{
+    (void)steeringgroupIndex;
+    (void)client_mac;
+    (void)config;
+
+    MOCK_ENTER();
+
+    return mock_vap_get(apIndex) != NULL ? RETURN_OK : RETURN_ERR;
+}
+
+INT wifi_steering_clientRemove(UINT steeringgroupIndex, INT apIndex, mac_address_t client_mac)
+{
+    (void)steeringgroupIndex;
+    (void)client_mac;
+
+    MOCK_ENTER();
+
+    return mock_vap_get(apIndex) != NULL ? RETURN_OK : RETURN_ERR;
+}
+
+INT wifi_steering_clientMeasure(UINT steeringgroupIndex, INT apIndex, mac_address_t client_mac)
+{
+    (void)steeringgroupIndex;
+    (void)client_mac;
+
+    MOCK_ENTER();
+
+    return mock_vap_get(apIndex) != NULL ? RETURN_OK : RETURN_ERR;
+}
+
+INT wifi_steering_clientDisconnect(UINT steeringgroupIndex, INT apIndex, mac_address_t client_mac,
+                                   wifi_disconnectType_t type, UINT reason)
+{
+    (void)steeringgroupIndex;
+    (void)client_mac;
+    (void)type;
+    (void)reason;
+
+    MOCK_ENTER();
+
+    return mock_vap_get(apIndex) != NULL ? RETURN_OK : RETURN_ERR;
+}
+
+INT wifi_setBTMRequest(UINT apIndex, mac_address_t peerMac, wifi_BTMRequest_t *request)
+{
+    (void)peerMac;
+    (void)request;
+
+    MOCK_ENTER();
+
+    return mock_vap_get(apIndex) != NULL ? RETURN_OK : RETURN_ERR;
+}
+
+INT wifi_setRMBeaconRequest(UINT apIndex, mac_address_t peer, wifi_BeaconRequest_t *in_request, UCHAR *out_DialogToken)
+{
+    static UCHAR token;
+
+    (void)peer;
+    (void)in_request;
+
+    MOCK_ENTER();
+
+    if (mock_vap_get(apIndex) == NULL) return RETURN_ERR;
+
+    *out_DialogToken = ++token;
+    return RETURN_OK;
+}
+
+INT wifi_setNeighborReports(UINT apIndex, UINT numNeighborReports, wifi_NeighborReport_t *neighborReports)
+{
+    (void)numNeighborReports;
+    (void)neighborReports;
+
+    MOCK_ENTER();
+
+    return mock_vap_get(apIndex) != NULL ? RETURN_OK : RETURN_ERR;
+}
+
+INT wifi_getAssociationReqIEs(UINT apIndex, const mac_address_t *clientMacAddress,
+                              CHAR *req_ies, UINT req_ies_size, UINT *req_ies_len)
+{
+    (void)clientMacAddress;
+    (void)req_ies;
+    (void)req_ies_size;
+
+    MOCK_ENTER();
+
+    if (mock_vap_get(apIndex) == NULL) return RETURN_ERR;
+
+    *req_ies_len = 0;
+    return RETURN_OK;
+}
@@ -0,0 +1,152 @@
+/*
+Copyright (c) 2017, Plume Design Inc. All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+   1. Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+   2. Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+   3. Neither the name of the Plume Design Inc. nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL Plume Design Inc. BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef WIFI_HAL_MOCK_H_INCLUDED
+#define WIFI_HAL_MOCK_H_INCLUDED
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <pthread.h>
+
+#include "ccsp/wifi_hal.h"
+
+/*
+ * Stand-in for libhal_wifi. The simulated device (radios, VAPs, clients,
+ * neighbors, per-call latency and injected HAL events) is described by a
+ * scenario file, see README.md.
+ */
+
+#define MOCK_SCENARIO_ENV           "WIFI_HAL_MOCK_SCENARIO"
+#define MOCK_SCENARIO_DEFAULT       "/tmp/wifi_hal_mock.conf"
+
+#define MOCK_MAX_RADIOS             MAX_NUM_RADIOS
+#define MOCK_MAX_VAPS               (MAX_NUM_RADIOS * MAX_NUM_VAP_PER_RADIO)
+#define MOCK_MAX_LATENCY            32
+#define MOCK_MAX_FAIL               16
+#define MOCK_MAX_EVENTS             32
+#define MOCK_MAX_CHANNELS           64
+#define MOCK_MAX_ACL                8192
+#define MOCK_IFNAME_LEN             32
+
+#define MOCK_LOG(fmt, ...) \
+    fprintf(stderr, "wifi_hal_mock: " fmt "\n", ##__VA_ARGS__)
+
+typedef enum
+{
+    MOCK_EVENT_ASSOC = 0,
+    MOCK_EVENT_DISASSOC,
+    MOCK_EVENT_CHAN,
+} mock_event_type_t;
+
+typedef struct
+{
+    INT                 index;
+    char                ifname[MOCK_IFNAME_LEN];
+    wifi_freq_bands_t   band;
+    UINT                channel;
+    UINT                num_channels;
+    UINT                channels[MOCK_MAX_CHANNELS];
+    UINT                num_neighbors;
+} mock_radio_t;
+
+typedef struct
+{
+    INT                 ssid_index;
+    INT                 radio_index;
+    char                ifname[MOCK_IFNAME_LEN];
+    char                ssid[33];
+    bool                enabled;
+    UINT                num_clients;    // Currently associated clients
+    UINT                max_clients;    // Client MAC pool size
+} mock_vap_t;
+
+typedef struct
+{
+    char                func[64];       // HAL function name or "*"
+    unsigned int        usec;
+} mock_latency_t;
+
+typedef struct
+{
+    char                func[64];       // HAL function name
+    UINT                count;          // Remaining calls to fail
+} mock_fail_t;
+
+typedef struct
+{
+    mock_event_type_t   type;
+    INT                 index;          // SSID index or radio index
+    UINT                count;          // Number of events, 0 = forever
+    UINT                interval_ms;
+} mock_event_t;
+
+typedef struct
+{
+    bool                loaded;
+    pthread_mutex_t     lock;
+
+    UINT                num_radios;
+    mock_radio_t        radios[MOCK_MAX_RADIOS];
+
+    UINT                num_vaps;
+    mock_vap_t          vaps[MOCK_MAX_VAPS];
+
+    UINT                num_latency;
+    mock_latency_t      latency[MOCK_MAX_LATENCY];
+
+    UINT                num_fail;
+    mock_fail_t         fail[MOCK_MAX_FAIL];
+
+    UINT                num_events;
+    mock_event_t        events[MOCK_MAX_EVENTS];
+
+    bool                no_list_counters;   // Associated device list without counters
+
+    uint64_t            start_usec;     // Used to derive monotonic counters
+    unsigned long       num_calls;      // HAL calls made so far
+} mock_state_t;
+
+extern mock_state_t g_mock;
+
+void            mock_init(void);
+void            mock_delay(const char *func);
+bool            mock_fail(const char *func);
+uint64_t        mock_now_usec(void);
+mock_radio_t   *mock_radio_get(INT radio_index);
+mock_vap_t     *mock_vap_get(INT ssid_index);
+void            mock_client_mac(INT ssid_index, UINT n, mac_address_t mac);
+void            mock_events_start(void);
+
+/* Registered HAL callbacks, invoked from the event thread */
+extern wifi_newApAssociatedDevice_callback      mock_assoc_cb;
+extern wifi_apDisassociatedDevice_callback      mock_disassoc_cb;
+extern wifi_chan_eventCB_t                      mock_chan_cb;
+
+/* Every HAL entry point starts with this */
+#define MOCK_ENTER()    do { mock_init(); mock_delay(__func__); } while (0)
+
+#endif /* WIFI_HAL_MOCK_H_INCLUDED */